@@ -28,6 +28,11 @@ public:
     tMilliseconds       getElapsedMilliseconds( tTimePoint last );
 
     void                handleInputs( const std::array<tKey, N_KEY>& keys, const tMouse& mouse );
+    void                move( const glm::vec3& axes, const glm::vec2& look, float milliseconds );
+    void                lookAt( const glm::vec3& position, const glm::vec3& target );
+    void                place( const glm::vec3& position, float pitch, float yaw );
+
+    static glm::vec3    getMoveAxes( const std::array<tKey, N_KEY>& keys );
     /* Setters */
     void                setFov( float fov );
     void                setAspect( float aspect );
@@ -44,6 +49,8 @@ public:
     const float         getAspect( void ) const { return (aspect); };
     const float         getNear( void ) const { return (near); };
     const float         getFar( void ) const { return (far); };
+    const float         getPitch( void ) const { return (pitch); };
+    const float         getYaw( void ) const { return (yaw); };
 
     float               speed;
     float               speedmod;
@@ -65,6 +72,7 @@ private:
     float       pitch;
     float       yaw;
 
-    void                handleKeys( const std::array<tKey, N_KEY>& keys );
-    void                handleMouse( const tMouse& mouse, float sensitivity = 0.1f );
+    void                handleKeys( const glm::vec3& axes, float milliseconds );
+    void                handleMouse( const glm::vec2& look, float sensitivity = 0.1f );
+    void                updateView( void );
 };
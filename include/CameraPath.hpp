@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "Exception.hpp"
+
+typedef struct  sCameraKey {
+    float       time;       // seconds
+    glm::vec3   position;
+    glm::vec3   target;     // point the camera looks at
+}               tCameraKey;
+
+/*  A scripted camera movement for the offline renders. The file has one key per line:
+        time px py pz tx ty tz
+    (empty lines and lines starting with # are skipped), the keys are interpolated with a
+    Catmull-Rom spline so the camera moves smoothly through them.
+*/
+class CameraPath {
+
+public:
+    CameraPath( const std::string& filename );
+    ~CameraPath( void );
+
+    void                sample( float time, glm::vec3& position, glm::vec3& target ) const;
+    float               getDuration( void ) const { return (keys.back().time); };
+
+private:
+    std::vector<tCameraKey> keys;
+
+};
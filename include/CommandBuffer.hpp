@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "Exception.hpp"
+#include "UniformId.hpp"
+
+enum class eCommand {
+    bindTexture,
+    bindVertexArray,
+    drawElements,       // GL_TRIANGLES, GL_UNSIGNED_INT indices
+    drawArrays,         // GL_TRIANGLES
+    uniformInt,
+    uniformFloat,
+    uniformVec3,
+    uniformMat4,
+    updateBuffer        // uniform blocks
+};
+
+typedef struct  sCommand {
+    eCommand    type;
+    GLenum      target;     // texture or buffer target
+    GLuint      object;     // texture, vertex array or buffer
+    GLuint      unit;       // texture unit
+    tUniformId  name;       // uniform
+    size_t      count;      // vertices, or bytes of an updateBuffer
+    size_t      data;       // offset of the uniform value or of the buffer content, see getData
+    size_t      offset;     // in the buffer of an updateBuffer
+}               tCommand;
+
+/*  Draw commands recorded without touching OpenGL, so that several threads can each build the
+    list of a pass at the same time, the GL thread replays them (see GlBackend). The uniforms are
+    set by name (hashed, see UniformId) on the program the pass binds when replaying, so a list
+    does not depend on the program (the depth of the models is drawn with the same list in every
+    shadow cascade). reset() keeps the memory, a list rebuilt every frame stops allocating.
+*/
+class CommandBuffer {
+
+public:
+    CommandBuffer( void );
+    ~CommandBuffer( void );
+
+    void                bindTexture( GLuint unit, GLenum target, GLuint texture );
+    void                bindVertexArray( GLuint vao );
+    void                drawElements( size_t count );
+    void                drawArrays( size_t count );
+    void                setUniform( const tUniformName& name, int i );
+    void                setUniform( const tUniformName& name, float f );
+    void                setUniform( const tUniformName& name, const glm::vec3& v );
+    void                setUniform( const tUniformName& name, const glm::mat4& m );
+    void                updateBuffer( GLenum target, GLuint buffer, size_t offset, const void* data, size_t size );
+
+    void                reset( void );
+    void                dump( std::ostream& os ) const;
+
+    const std::vector<tCommand>&    getCommands( void ) const { return (commands); };
+    const void*                     getData( size_t offset ) const { return (data.data() + offset); };
+
+private:
+    std::vector<tCommand>                   commands;
+    std::vector<unsigned char>              data;
+
+    void                push( eCommand type, GLenum target, GLuint object, GLuint unit, tUniformId name, size_t count, size_t data, size_t offset );
+    size_t              store( const void* value, size_t size );
+
+};
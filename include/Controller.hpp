@@ -7,13 +7,17 @@
 #include <iostream>
 #include <string>
 #include <array>
+#include <algorithm>
+#include <vector>
 #include <chrono>
 
 #include "Exception.hpp"
+#include "SpscQueue.hpp"
 #include <glm/glm.hpp>
 
 #define N_KEY GLFW_KEY_LAST + 1
 #define N_MOUSE_BUTTON GLFW_MOUSE_BUTTON_LAST + 1
+#define CONTROLLER_EVENT_QUEUE 256
 
 typedef std::chrono::duration<double,std::milli> tMilliseconds;
 typedef std::chrono::steady_clock::time_point tTimePoint;
@@ -35,12 +39,31 @@ typedef struct  sKey {
     tTimePoint          stamp = std::chrono::steady_clock::now();
 }               tKey;
 
+enum class eInputEvent {
+    key,
+    button,
+    cursor
+};
+
+typedef struct  sInputEvent {
+    eInputEvent         type;
+    int                 code;       // key or mouse button
+    short               pressed;
+    glm::dvec2          pos;        // cursor events only
+}               tInputEvent;
+
 typedef struct  sMouse {
     glm::dvec2                          pos;
     glm::dvec2                          prevPos;
     std::array<short, N_MOUSE_BUTTON>   button;
 }               tMouse;
 
+/*  The GLFW callbacks push the input events in a lock-free queue that update() drains once per
+    frame, so only the keys that changed are updated, plus the few keys with a registered mode
+    (their state also depends on time). When the queue overflows, the state is polled again.
+    A key in eKeyMode::press pressed and released between two updates is latched: its value stays
+    1 for one frame, so that the press is not lost.
+*/
 class Controller {
 
 public:
@@ -58,18 +81,27 @@ public:
     const std::array<tKey, N_KEY>&  getKeys( void ) const { return (key); };
 
 private:
-    GLFWwindow*             window;
-    std::array<tKey, N_KEY> key;
-    tTimePoint              ref;
-    tMouse                  mouse;
-
-    void            mouseHandler( void );
-    void            keyHandler( void );
-    void            keyUpdate( int k );
-    void            keyToggle( int k, short value );
-    void            keyCooldown( int k, short value );
-    void            keyInstant( int k, short value );
-    void            keyCycle( int k, short value );
-    tMilliseconds   getElapsedMilliseconds( tTimePoint prev );
+    GLFWwindow*                 window;
+    std::array<tKey, N_KEY>     key;
+    std::array<short, N_KEY>    pressed;    // physical state of the keys
+    std::array<short, N_KEY>    latched;    // pressed since the last update (eKeyMode::press)
+    std::vector<int>            latches;    // the keys latched by the last update
+    std::vector<int>            modal;      // keys that are not in eKeyMode::press
+    SpscQueue<tInputEvent>      events;
+    bool                        overflow;
+    tTimePoint                  ref;
+    tMouse                      mouse;
+
+    void            push( const tInputEvent& event );
+    void            poll( void );
+    void            keyUpdate( int k, tTimePoint now );
+    void            keyToggle( int k, short value, tTimePoint now );
+    void            keyCooldown( int k, short value, tTimePoint now );
+    void            keyInstant( int k, short value, tTimePoint now );
+    void            keyCycle( int k, short value, tTimePoint now );
+
+    static void     keyCallback( GLFWwindow* window, int key, int scancode, int action, int mods );
+    static void     mouseButtonCallback( GLFWwindow* window, int button, int action, int mods );
+    static void     cursorPosCallback( GLFWwindow* window, double x, double y );
 
 };
@@ -15,6 +15,10 @@
 #include "Raymarched.hpp"
 #include "RaymarchedSurface.hpp"
 #include "Light.hpp"
+#include "Scene.hpp"
+#include "World.hpp"
+
+#define ENV_DEFAULT_SCENE "./resource/scenes/gallery.scene"
 
 typedef struct  s_window {
     GLFWwindow* ptr;
@@ -25,7 +29,7 @@ typedef struct  s_window {
 class Env {
 
 public:
-    Env( void );
+    Env( const std::string& scene = ENV_DEFAULT_SCENE );
     ~Env( void );
 
     const t_window&                     getWindow( void ) const { return (window); };
@@ -37,6 +41,11 @@ public:
     std::vector<Light*>&                getLights( void ) { return (lights); };
     Model*                              getSkybox( void ) { return (skybox); };
     Light*                              getDirectionalLight( void );
+    World*                              getWorld( void ) { return (world); };
+    unsigned int                        getSkyboxTexture( void ) const { return (skyboxTexture); };
+    unsigned int                        getNoiseTexture( void ) const { return (noiseTexture); };
+
+    void                                stream( const glm::vec3& position, const glm::vec3& front, bool wait = false ) { world->update(position, front, wait); };
 
 private:
     t_window                        window;
@@ -49,10 +58,13 @@ private:
     std::vector<RaymarchedSurface*> texturedSurfaces;
     unsigned int                    skyboxTexture;
     unsigned int                    noiseTexture;
+    World*                          world;          // streams the models, surfaces and raymarched objects in the lists above
 
     void        initGlfwEnvironment( const std::string& glVersion = "4.0" );
     void        initGlfwWindow( size_t width, size_t height );
     void        setupController( void );
+    void        loadScene( const std::string& filename );
+    void        release( void );
     // callback to be called each time the window is resized to update the viewport size as well
     static void framebufferSizeCallback( GLFWwindow* window, int width, int height );
 
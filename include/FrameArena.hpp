@@ -0,0 +1,65 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <unordered_set>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+#include "Exception.hpp"
+
+#define FRAME_ARENA_SIZE (1 << 20)      // bytes of the first block, it grows to the peak usage
+
+/*  The memory of the temporaries that only live for a frame, handed out linearly from one block
+    and released all at once by reset() at the end of the frame, freeing does nothing. What does
+    not fit in the block is allocated on the heap until the reset, which then grows the block so
+    that the next frames do not spill again. Used from the GL thread only.
+    Once the scene is loaded a frame should not allocate anything else, test/AllocationTest.cpp
+    counts the heap allocations of the steady frames.
+*/
+class FrameArena {
+
+public:
+    static void*        allocate( size_t size, size_t alignment = alignof(std::max_align_t) );
+    static void         reset( void );
+    static void         print( std::ostream& os );
+
+    static size_t       getUsed( void ) { return (used); };        // by the last frame
+    static size_t       getCapacity( void ) { return (capacity); };
+
+private:
+    static char*                block;
+    static size_t               capacity;
+    static size_t               offset;
+    static size_t               used;
+    static size_t               spilledBytes;
+    static std::vector<void*>   spilled;    // the allocations that did not fit (unaligned), freed by the reset
+
+};
+
+/*  to put the temporaries of the standard containers in the frame arena */
+template <typename T>
+class FrameAllocator {
+
+public:
+    typedef T   value_type;
+
+    FrameAllocator( void ) {};
+    template <typename U>
+    FrameAllocator( const FrameAllocator<U>& ) {};
+
+    T*          allocate( size_t n ) { return (static_cast<T*>(FrameArena::allocate(n * sizeof(T), alignof(T)))); };
+    void        deallocate( T*, size_t ) {};
+
+};
+
+template <typename T, typename U>
+bool    operator==( const FrameAllocator<T>&, const FrameAllocator<U>& ) { return (true); }
+template <typename T, typename U>
+bool    operator!=( const FrameAllocator<T>&, const FrameAllocator<U>& ) { return (false); }
+
+template <typename T>
+using tFrameVector = std::vector<T, FrameAllocator<T>>;
+template <typename T>
+using tFrameSet = std::unordered_set<T, std::hash<T>, std::equal_to<T>, FrameAllocator<T>>;
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+
+#include "Exception.hpp"
+#include "GpuTimer.hpp"
+#include "GlState.hpp"
+
+typedef struct  sFrameResourceDesc {
+    size_t      width;
+    size_t      height;
+    size_t      layers;         // more than one creates a GL_TEXTURE_2D_ARRAY, attached layered
+    GLenum      internalFormat;
+    bool        transient;      // transient resources only live for the frame, and may share memory
+}               tFrameResourceDesc;
+
+typedef struct  sFramePass {
+    std::string                 name;
+    std::vector<std::string>    reads;      // resources sampled by the pass
+    std::vector<std::string>    writes;     // resources attached to the framebuffer of the pass
+    std::function<void(void)>   execute;
+}               tFramePass;
+
+typedef struct  sFrameResource {
+    std::string         name;
+    tFrameResourceDesc  desc;
+    bool                imported;   // owned outside of the graph (the default framebuffer)
+    GLuint              fbo;        // only for imported resources
+    int                 slot;       // physical texture, -1 when unused by the compiled schedule
+    int                 firstUse;
+    int                 lastUse;
+}               tFrameResource;
+
+typedef struct  sFrameStep {
+    size_t              pass;
+    std::vector<size_t> clears;     // transient resources written for the first time this frame
+    std::vector<size_t> barriers;   // resources read after being written by a previous step
+    std::vector<size_t> writes;     // the writes of the pass, resolved once by compile
+    GLuint              fbo;
+    size_t              width;
+    size_t              height;
+}               tFrameStep;
+
+typedef struct  sFrameSlot {
+    std::string         key;        // stable identity of the physical texture across recompilations
+    tFrameResourceDesc  desc;
+}               tFrameSlot;
+
+/*  Passes declare the resources they read and write, the graph decides what actually runs:
+    disabled passes and passes whose outputs are never consumed are culled, transient
+    resources with disjoint lifetimes share the same texture, framebuffers are created from the
+    write sets and the transient resources are cleared on their first write of the frame.
+    Persistent resources keep their content across frames (the passes writing them clear what
+    they re-render), which lets a pass cache its output.
+    The owner evaluates the conditions of the passes and gives them to setEnabled before execute,
+    the schedule is only recompiled when one changed. The resources and passes are named when
+    declared, then referred to by the handles addResource and addPass return. compile() and dump() do not touch OpenGL,
+    so a schedule can be tested headless (see test/FrameGraphTest.cpp).
+*/
+class FrameGraph {
+
+public:
+    FrameGraph( void );
+    ~FrameGraph( void );
+
+    size_t              addResource( const std::string& name, const tFrameResourceDesc& desc );
+    size_t              importResource( const std::string& name, GLuint fbo, size_t width, size_t height );
+    size_t              addPass( const tFramePass& pass );
+    void                setEnabled( size_t pass, bool enabled );
+
+    void                compile( void );
+    void                realize( void );
+    void                execute( void );
+    void                dump( std::ostream& os ) const;
+
+    void                setTimer( GpuTimer* timer ) { gpuTimer = timer; };
+    GLuint              getTexture( size_t resource ) const;
+    void                attachLayer( size_t resource, size_t layer );
+    bool                isCulled( const std::string& name ) const;
+    bool                isCulled( size_t pass ) const { return (pass >= alive.size() || !alive[pass]); };
+
+private:
+    std::vector<tFramePass>                 passes;
+    std::vector<tFrameResource>             resources;
+    std::unordered_map<std::string, size_t> resourceIndex;
+    std::vector<bool>                       enabled;    // condition of each pass, set by its owner
+    std::vector<bool>                       alive;
+    std::vector<tFrameStep>                 steps;
+    std::vector<tFrameSlot>                 slots;
+    std::map<std::string, GLuint>           textures;   // slot key -> texture
+    std::map<std::string, GLuint>           fbos;       // attachments key -> framebuffer
+    bool                                    compiled;
+    size_t                                  currentStep;
+    GpuTimer*                               gpuTimer;
+
+    size_t              getResourceIndex( const std::string& name ) const;
+    void                cullPasses( void );
+    void                computeLifetimes( void );
+    void                aliasResources( void );
+    void                buildSteps( void );
+    GLuint              createTexture( const tFrameResourceDesc& desc );
+    GLuint              createFramebuffer( const tFrameStep& step );
+    void                attach( const tFrameResource& resource, GLenum attachment, int layer );
+
+};
+
+bool                    isDepthFormat( GLenum internalFormat );
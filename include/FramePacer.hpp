@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "Exception.hpp"
+
+#define FRAME_PACER_SPIN 1.5        // milliseconds of a wait that are spun, sleep_for is too coarse for them
+#define FRAME_PACER_LATENCY 4       // frames in flight of the latency queries
+
+typedef std::chrono::duration<double,std::milli> tMilliseconds;
+typedef std::chrono::steady_clock::time_point tTimePoint;
+
+enum class eSyncMode {
+    off,
+    vsync,
+    adaptive    /* vsync, but a late frame tears instead of waiting for the next refresh */
+};
+
+typedef struct  sFrameStats {
+    double      intervalSum;    // milliseconds between the end of two swaps
+    double      intervalSqSum;
+    double      intervalMax;
+    size_t      intervals;
+    double      latencySum;     // milliseconds from the input sampling to the GPU finishing the frame
+    double      latencyMax;
+    size_t      latencies;
+}               tFrameStats;
+
+/*  Paces the interactive loop on a monotonic clock. The frames are presented at a fixed period
+    (the target framerate, or the refresh rate with vsync and no target), waiting with a sleep
+    followed by a short spin so that the deadline is met to a fraction of a millisecond.
+    Normally the wait happens after the swap. In low latency mode it happens before the input
+    sampling instead, as late as the estimated frame cost allows, so the frame shows more recent
+    inputs for the same framerate.
+    The input to photon latency is measured up to the GPU finishing the frame (a timestamp query
+    after the swap, read back FRAME_PACER_LATENCY frames later), the scanout is not included.
+*/
+class FramePacer {
+
+public:
+    FramePacer( float framerate = 60.0f, eSyncMode sync = eSyncMode::off, bool lowLatency = false );
+    ~FramePacer( void );
+
+    void                beginFrame( void );
+    void                endFrame( void );
+    void                reset( void );
+    void                print( std::ostream& os ) const;
+
+    void                setFramerate( float framerate );
+    void                setSyncMode( eSyncMode sync );
+    void                setLowLatency( bool lowLatency ) { this->lowLatency = lowLatency; };
+
+    eSyncMode           getSyncMode( void ) const { return (sync); };
+    bool                isLowLatency( void ) const { return (lowLatency); };
+    double              getLatency( void ) const;
+    double              getJitter( void ) const;
+
+private:
+    float                               framerate;      // 0 is uncapped
+    eSyncMode                           sync;
+    bool                                lowLatency;
+    std::chrono::steady_clock::duration period;         // 0 when nothing limits the framerate
+    tTimePoint                          deadline;       // when the next swap should end
+    tTimePoint                          inputTime;      // when the current frame sampled the inputs
+    tTimePoint                          lastSwap;
+    double                              work;           // smoothed milliseconds from the input sampling to the end of the swap
+    GLuint                              queries[FRAME_PACER_LATENCY];
+    tTimePoint                          inputTimes[FRAME_PACER_LATENCY];
+    bool                                pending[FRAME_PACER_LATENCY];
+    size_t                              frame;
+    GLint64                             gpuReference;   // GL_TIMESTAMP at cpuReference
+    tTimePoint                          cpuReference;
+    tFrameStats                         stats;
+
+    void                updatePeriod( void );
+    void                waitUntil( tTimePoint time );
+    void                calibrate( void );
+    void                readLatency( size_t slot );
+
+};
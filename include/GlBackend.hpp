@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <cstring>
+
+#include "Exception.hpp"
+#include "Shader.hpp"
+#include "CommandBuffer.hpp"
+
+/*  Replays the recorded command buffers on the GL thread */
+class GlBackend {
+
+public:
+    GlBackend( void );
+    ~GlBackend( void );
+
+    void                execute( const CommandBuffer& commands, Shader& program );
+
+};
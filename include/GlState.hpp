@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "Exception.hpp"
+
+#define GL_STATE_TEXTURE_UNITS 16
+#define GL_STATE_UNKNOWN 0xFFFFFFFF     // the next call is always issued
+
+enum class eGlState {
+    program,
+    vertexArray,
+    activeTexture,
+    texture,
+    framebuffer,
+    capability,
+    depthFunc,
+    blendFunc,
+    colorMask,
+    count
+};
+
+typedef struct  sGlStateCounter {
+    size_t      issued;
+    size_t      filtered;
+}               tGlStateCounter;
+
+/*  The bindings and the fixed function state the renderer changes, as last set through here, so
+    that the calls that would not change anything are not issued. Everything that changes this
+    state must go through GlState, including the deletion of the objects (their names are reused).
+    Code that cannot (a library) calls invalidate afterwards.
+    The counters of the issued and filtered calls are printed per frame with the GPU timings.
+*/
+class GlState {
+
+public:
+    static void         useProgram( GLuint program );
+    static void         bindVertexArray( GLuint vao );
+    static void         bindTexture( GLuint unit, GLenum target, GLuint texture );
+    static void         bindFramebuffer( GLenum target, GLuint fbo );
+    static void         enable( GLenum capability );
+    static void         disable( GLenum capability );
+    static void         depthFunc( GLenum func );
+    static void         blendFunc( GLenum src, GLenum dst );
+    static void         colorMask( bool write );
+
+    static void         deleteProgram( GLuint program );
+    static void         deleteVertexArrays( GLsizei n, const GLuint* vaos );
+    static void         deleteTextures( GLsizei n, const GLuint* textures );
+    static void         deleteFramebuffers( GLsizei n, const GLuint* fbos );
+
+    static void         invalidate( void );
+    static void         endFrame( void ) { frames++; };
+    static void         reset( void );
+    static void         print( std::ostream& os );
+
+private:
+    static GLuint           program;
+    static GLuint           vertexArray;
+    static GLuint           activeUnit;
+    static GLuint           textures[GL_STATE_TEXTURE_UNITS][3];    // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP
+    static GLuint           drawFramebuffer;
+    static GLuint           readFramebuffer;
+    static GLuint           capabilities[3];                        // GL_DEPTH_TEST, GL_BLEND, GL_FRAMEBUFFER_SRGB
+    static GLenum           depth;
+    static GLenum           blend[2];
+    static GLuint           mask;
+    static tGlStateCounter  counters[static_cast<int>(eGlState::count)];
+    static size_t           frames;
+
+    static bool         filter( eGlState state, bool redundant );
+    static void         setCapability( GLenum capability, bool enabled );
+
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "Exception.hpp"
+
+typedef struct  sGpuTimerQuery {
+    std::vector<GLuint> start;
+    std::vector<GLuint> stop;
+    std::vector<bool>   pending;
+    double              total;      // accumulated milliseconds since last reset
+    size_t              samples;
+}               tGpuTimerQuery;
+
+/*  GPU timings through GL_TIMESTAMP queries. The queries of a frame are only read back
+    `latency` frames later so that getting the results never stalls the pipeline.
+*/
+class GpuTimer {
+
+public:
+    GpuTimer( size_t latency = 3 );
+    ~GpuTimer( void );
+
+    void                begin( const std::string& name );
+    void                end( const std::string& name );
+    void                update( void );
+    void                reset( void );
+    void                print( std::ostream& os ) const;
+
+    double              getMilliseconds( const std::string& name ) const;
+
+private:
+    size_t                                      latency;
+    size_t                                      frame;
+    std::vector<std::string>                    names;   // keeps the passes in submission order
+    std::unordered_map<std::string, tGpuTimerQuery> queries;
+
+    tGpuTimerQuery&     getQuery( const std::string& name );
+
+};
@@ -24,7 +24,7 @@ public:
     ~Light( void );
 
     // void            update( void );
-    void            render( Shader shader );
+    void            render( Shader& shader );
 
     /* getters */
     const eLightType    getType( void ) const { return (type); };
@@ -52,4 +52,7 @@ private:
     float               linear;
     float               quadratic;
     int                 id;
+    tUniformId          uniforms[7];    // of the point light fields, resolved once
+
+    void                resolveUniforms( void );
 };
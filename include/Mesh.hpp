@@ -13,8 +13,10 @@
 
 #include "Exception.hpp"
 #include "Shader.hpp"
+#include "CommandBuffer.hpp"
 #include "Camera.hpp"
 #include "utils.hpp"
+#include "SpatialIndex.hpp"
 
 typedef struct  sVertex {
     glm::vec3   Position;
@@ -38,16 +40,29 @@ typedef struct  sTexture {
     std::string     path;
 }               tTexture;
 
+/*  a texture of the mesh with the uniforms it sets, resolved when the mesh is created */
+typedef struct  sTextureSlot {
+    GLuint          unit;
+    GLenum          target;
+    GLuint          texture;
+    bool            sampled;    // sets its sampler and usage flag (not the skybox)
+    tUniformId      sampler;    // texture_diffuse1, texture_normal1...
+    tUniformId      flag;       // state.use_texture_diffuse...
+}               tTextureSlot;
+
 class Mesh {
 
 public:
     Mesh( std::vector<tVertex> vertices, std::vector<unsigned int> indices, std::vector<tTexture> textures, tMaterial material );
     ~Mesh( void );
 
-    void                render( Shader shader );
+    void                render( Shader& shader );
+    void                record( CommandBuffer& commands ) const;
+    void                recordDepth( CommandBuffer& commands ) const;
     /* getters */
     const GLuint&       getVao( void ) const { return (vao); };
     const tMaterial&    getMaterial( void ) const { return (material); };
+    const tBounds&      getBounds( void ) const { return (bounds); };
 
 private:
     unsigned int                vao;               // Vertex Array Object
@@ -58,6 +73,10 @@ private:
     std::vector<unsigned int>   indices;
     std::vector<tTexture>       textures;
     tMaterial                   material;
+    tBounds                     bounds;             // of the vertices
+    std::vector<tTextureSlot>   slots;              // of the textures
+
+    void                    resolveSlots( void );
 
     void                    setup( int mode );
 
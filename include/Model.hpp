@@ -19,50 +19,93 @@
 #include "Camera.hpp"
 #include "utils.hpp"
 #include "Mesh.hpp"
+#include "TransformStore.hpp"
+
+typedef struct  sImage {
+    std::string                 path;
+    std::string                 type;       // texture_diffuse, texture_specular, texture_normal or texture_emissive
+    int                         width;
+    int                         height;
+    int                         channels;
+    std::vector<unsigned char>  pixels;
+}               tImage;
+
+typedef struct  sMeshData {
+    std::vector<tVertex>        vertices;
+    std::vector<unsigned int>   indices;
+    std::vector<size_t>         images;     // in tModelData::images
+    tMaterial                   material;
+}               tMeshData;
+
+/*  a model file read and decoded without touching OpenGL, so that it can be loaded on any thread */
+typedef struct  sModelData {
+    std::vector<tMeshData>      meshes;
+    std::vector<tImage>         images;
+    size_t                      bytes;      // video memory once uploaded
+}               tModelData;
 
 class Model {
 
 public:
-    Model( const std::string& path, const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ); // constructor from existing meshes
-    Model( const std::vector<Mesh*> meshes, const std::vector<tTexture> textures, const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale );
+    Model( const std::string& path, const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale );
+    Model( const tModelData& data, const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ); // constructor from a file read with Model::read
+    Model( void ); // empty, filled step by step with upload
+    Model( const std::vector<Mesh*> meshes, const std::vector<tTexture> textures, const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ); // constructor from existing meshes
     Model( const std::vector<std::string>& paths );  // cubemap constructor
     Model( const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ); // billboard constructor
     ~Model( void );
 
-    void            update( void );
-    void            render( Shader shader );
+    void            render( Shader& shader );
+    void            record( CommandBuffer& commands ) const;
+    void            recordDepth( CommandBuffer& commands, bool opaqueOnly = false ) const;
+
+    static void     read( const std::string& path, tModelData& data );
+    size_t          upload( const tModelData& data, size_t step ); // uploads one image or mesh of the data, returns its bytes
+    static size_t   getUploadSteps( const tModelData& data ) { return (data.images.size() + data.meshes.size()); };
 
     /* getters */
-    const glm::mat4&    getTransform( void ) const { return (transform); };
-    const glm::vec3&    getPosition( void ) const { return (position); };
-    const glm::vec3&    getOrientation( void ) const { return (orientation); };
-    const glm::vec3&    getScale( void ) const { return (scale); };
+    const glm::mat4&    getTransform( void ) const { return (TransformStore::getWorld(transform)); };
+    tTransformId        getTransformId( void ) const { return (transform); };
+    tBounds             getBounds( void ) const { return (transformBounds(bounds, getTransform())); };
+    tSpatialId          getSpatialId( void ) const { return (spatialId); };
+    glm::vec3           getPosition( void ) const { return (TransformStore::getPosition(transform)); };
+    glm::vec3           getOrientation( void ) const { return (TransformStore::getOrientation(transform)); };
+    glm::vec3           getScale( void ) const { return (TransformStore::getScale(transform)); };
+
+    bool                isDynamic( void ) const { return (dynamic); };
 
     const std::vector<Mesh*>    getMeshes( void ) const { return (meshes); };
     const std::vector<tTexture> getTextures( void ) const { return (textures_loaded); };
     /* setters */
-    void                setPosition( const glm::vec3& t ) { position = t; };
-    void                setOrientation( const glm::vec3& r ) { orientation = r; };
-    void                setScale( const glm::vec3& s ) { scale = s; };
+    void                setPosition( const glm::vec3& t ) { TransformStore::setPosition(transform, t); };
+    void                setOrientation( const glm::vec3& r ) { TransformStore::setOrientation(transform, r); };
+    void                setScale( const glm::vec3& s ) { TransformStore::setScale(transform, s); };
+    void                setParent( const Model* parent ) { TransformStore::setParent(transform, (parent ? parent->transform : TRANSFORM_NONE)); };
+    void                setDynamic( bool d ) { dynamic = d; };
+    void                setSpatialId( tSpatialId id ) { spatialId = id; };
 
 private:
-    glm::mat4               transform;          // the transform applied to the model
-    glm::vec3               position;           // the position
-    glm::vec3               orientation;        // the orientation
-    glm::vec3               scale;              // the scale
+    tTransformId            transform;          // in the TransformStore
+    bool                    dynamic;            // moves every frame, its shadows are not cached
+    tBounds                 bounds;             // of the meshes, in model space
+    tSpatialId              spatialId;          // in the SpatialIndex of the Env, SPATIAL_NONE if not indexed
 
     std::vector<Mesh*>      meshes;
-    std::string             directory;
     std::vector<tTexture>   textures_loaded;
     bool                    meshClone;
 
-    void                    loadModel( const std::string& path );
-    void                    processNode( aiNode* node, const aiScene* scene );
-    Mesh*                   processMesh( aiMesh* mesh, const aiScene* scene );
-    std::vector<tTexture>   loadMaterialTextures( aiMaterial* mat, aiTextureType type, std::string typeName );
+    void                    upload( const tModelData& data );
+    void                    computeBounds( void );
+    static size_t           getBytes( const tImage& image );
+    static size_t           getBytes( const tMeshData& mesh );
+    static void             processNode( aiNode* node, const aiScene* scene, const std::string& directory, tModelData& data );
+    static void             processMesh( aiMesh* mesh, const aiScene* scene, const std::string& directory, tModelData& data );
+    static void             loadMaterialTextures( aiMaterial* mat, aiTextureType type, std::string typeName, const std::string& directory, tModelData& data, tMeshData& mesh );
 
 };
 
 unsigned int            loadTexture( const char* path, const std::string& directory );
 unsigned int            loadTexture( const char* path );
+void                    readImage( const char* path, tImage& image );
+unsigned int            uploadTexture( const tImage& image );
 unsigned int            loadCubemap( const std::vector<std::string>& paths );
@@ -9,12 +9,23 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
 
 #include "Exception.hpp"
 #include "Shader.hpp"
 #include "Camera.hpp"
 #include "utils.hpp"
 #include "Mesh.hpp"
+#include "TransformStore.hpp"
+#include "SpatialIndex.hpp"
+
+#define RAYMARCH_MAX_OBJECTS 8      // size of the object array in the raymarch shaders
+#define RAYMARCH_OCCLUSION_REACH 0.5f   // OCCLUSION_ITERS * OCCLUSION_GRANULARITY in raymarch.frag.glsl
+#define RAYMARCH_SLOWDOWN_WIDTH 1.0f    // the camera slows down over that distance when it approaches an object
+#define RAYMARCH_OBJECT_FIELDS 11   // uniforms of an element of the object array
 
 enum class eRaymarchObject {
     mandelbox,
@@ -40,19 +51,50 @@ typedef struct  sObject {
     tMaterial       material;
 }               tObject;
 
+/*  what the object uniforms of a program were last set from (see setObjectUniforms) */
+typedef struct  sObjectUniforms {
+    GLuint      program;                        // the uniforms are lost when a reload replaces it
+    size_t      count;                          // nObjects
+    size_t      versions[RAYMARCH_MAX_OBJECTS]; // of the entries of the object array
+}               tObjectUniforms;
+
 class Raymarched {
 
 public:
     Raymarched( const std::vector<tObject>& objects );
     ~Raymarched( void );
 
-    void            render( Shader shader );
+    void            renderObject( Shader& shader, size_t i );
+    void            setObjectUniforms( Shader& shader, uint32_t mask = 0xFFFFFFFF );
+    std::vector<std::string>    getDefines( size_t i, bool useShadows ) const;
+    void                        getDrawOrder( const glm::vec3& cameraPos, std::vector<size_t>& order ) const;
     float           computeSpeedModifier( const glm::vec3& cameraPos );
+    glm::mat4       getLightSpaceMatrix( size_t i, const glm::vec3& lightDir ) const;
+    bool            castsShadow( size_t i ) const;
+    bool            isAnimated( size_t i ) const;
+    float           getBoundingRadius( size_t i ) const;
+    void            updateShadowCasters( const glm::vec3& lightDir );
+    void            setObjects( const std::vector<tObject>& objects );
+
+    const std::vector<tObject>& getObjects( void ) const { return (objects); };
+    size_t                      getGeneration( void ) const { return (generation); };
     unsigned int                skyboxId;
     unsigned int                noiseSamplerId;
 
 private:
     std::vector<tObject>        objects;
+    std::vector<tTransformId>   transforms;     // of the objects, in the TransformStore
+    std::vector<glm::mat4>      invMats;        // their inverse, only recomputed when they changed
+    std::vector<glm::mat4>      worlds;         // the world matrices the inverses were computed from
+    std::vector<size_t>         versions;       // of the uniforms of each object, renewed when they change
+    size_t                      version;        // the last one given
+    std::unordered_map<const Shader*, tObjectUniforms>  uploaded;   // by program
+    std::vector<int>            neighbors;      // bitmask of the objects within occlusion reach of each object
+    std::vector<int>            shadowCasters;  // bitmask of the objects between each object and the sun
+    size_t                      generation;     // incremented when the objects are replaced
+    std::mutex                  mutex;          // the simulation reads the objects on its own thread
+    SpatialIndex                slowdowns;      // the spheres where the objects slow the camera down
+    std::vector<tSpatialId>     inside;         // the spheres the camera is in (computeSpeedModifier)
 
     /* render quad variables */
     std::vector<tQuadVertex>    vertices;
@@ -63,5 +105,7 @@ private:
 
     void                        createRenderQuad( void );
     void                        setup( int mode );
+    void                        computeNeighbors( void );
+    void                        touch( size_t i ) { versions[i] = ++version; };
 
 };
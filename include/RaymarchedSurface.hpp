@@ -15,6 +15,7 @@
 #include "Camera.hpp"
 #include "utils.hpp"
 #include "Mesh.hpp"
+#include "TransformStore.hpp"
 
 typedef struct  sQuadVertex2 {
     glm::vec3   Position;
@@ -27,17 +28,18 @@ public:
     RaymarchedSurface( const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale, unsigned int skybox, unsigned int noise );
     ~RaymarchedSurface( void );
 
-    void                        update( void );
-    void                        render( Shader shader );
+    void                        record( CommandBuffer& commands ) const;
     unsigned int                noiseSamplerId;
     unsigned int                skyboxId;
-    glm::mat4&                  getTransform( void ) { return transform; };
+    const glm::mat4&            getTransform( void ) const { return (TransformStore::getWorld(transform)); };
+    tTransformId                getTransformId( void ) const { return (transform); };
+    tBounds                     getBounds( void ) const { return (transformBounds((tBounds){ glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, 0.5f, 0.0f) }, getTransform())); };
+    tSpatialId                  getSpatialId( void ) const { return (spatialId); };
+    void                        setSpatialId( tSpatialId id ) { spatialId = id; };
 
 private:
-    glm::mat4                   transform;
-    glm::vec3                   position;
-    glm::vec3                   orientation;
-    glm::vec3                   scale;
+    tTransformId                transform;  // in the TransformStore
+    tSpatialId                  spatialId;  // in the SpatialIndex of the Env, SPATIAL_NONE if not indexed
     /* render quad variables */
     std::vector<tQuadVertex2>   vertices;
     std::vector<unsigned int>   indices;
@@ -21,13 +21,100 @@
 #include "Camera.hpp"
 #include "Light.hpp"
 #include "VideoCapture.hpp"
+#include "GpuTimer.hpp"
+#include "FrameGraph.hpp"
+#include "ShaderVariants.hpp"
+#include "ShaderWatcher.hpp"
+#include "CameraPath.hpp"
+#include "FramePacer.hpp"
+#include "Simulation.hpp"
+#include "CommandBuffer.hpp"
+#include "GlBackend.hpp"
+#include "WorkerPool.hpp"
+#include "FrameArena.hpp"
 
-typedef struct  sDepthMap {
-    unsigned int    id;
-    unsigned int    fbo;
+#define SHADOW_CASCADES 4
+#define SHADOW_CASCADE_SIZE 2048
+#define SHADOW_DISTANCE 60.0f
+#define SHADOW_DYNAMIC_SIZE 1024
+#define SHADOW_UPDATE_ANGLE 0.5f    // degrees the sun can move before the cached shadows are re-rendered
+#define RAYMARCH_SHADOW_SIZE 512
+#define RAYMARCH_SHADOW_REFRESH 0.1 // seconds between two renders of the shadows of the animated objects
+
+typedef struct  sShadowCache {
+    glm::vec3               lightDir;                   // sun direction the cascades were rendered with
+    bool                    valid[SHADOW_CASCADES];
+    std::vector<tTransformId>   casters;                // transforms of the static models
+}               tShadowCache;
+
+/*  the handles of the render targets in the frame graph */
+typedef struct  sRenderTargets {
+    size_t      shadowDepth;
+    size_t      raymarchedShadow;
+    size_t      dynamicShadowDepth;
+    size_t      sceneColor;
+    size_t      sceneDepth;
+    size_t      backbuffer;
+    size_t      capture;        // offline only
+}               tRenderTargets;
+
+/*  the handles of the passes in the frame graph */
+typedef struct  sRenderPasses {
+    size_t      shadows;
+    size_t      raymarchedShadows;
+    size_t      dynamicShadows;
+    size_t      depthPrepass;
+    size_t      meshes;
+    size_t      skybox;
+    size_t      texturedSurfaces;
+    size_t      raymarchedSurfaces;
+    size_t      raymarched;
+    size_t      capture;        // offline only
+    size_t      screen;
+}               tRenderPasses;
+
+/*  the programs of the passes, resolved once from the shader map (a reload keeps the Shader) */
+typedef struct  sRenderPrograms {
+    Shader*     meshes;
+    Shader*     skybox;
+    Shader*     shadowMap;
+    Shader*     raymarchOnSurface;
+    Shader*     texture2D;
+    Shader*     depthPrepass;
+    Shader*     screen;
+    Shader*     raymarchShadow;
+    Shader*     downsample;     // offline only
+    Shader*     yuv;            // offline only
+}               tRenderPrograms;
+
+/*  Offline render: time advances by exactly one frame per frame whatever the rendering takes, the
+    camera follows a scripted path and every frame is encoded. The scene is rendered at
+    supersampling times the output resolution and box filtered down.
+*/
+typedef struct  sRenderToFile {
+    std::string     output;         // video file (.mov, or .y4m for raw I420 converted on the GPU)
+    std::string     cameraPath;     // see CameraPath
     size_t          width;
     size_t          height;
-}               tDepthMap;
+    size_t          supersampling;
+    float           framerate;
+}               tRenderToFile;
+
+enum class eCommandList {
+    staticDepth,
+    dynamicDepth,
+    opaqueDepth,
+    meshes,
+    raymarchedSurfaces,
+    texturedSurfaces,
+    count
+};
+
+/*  the draws of a pass, recorded by a worker while the frame starts */
+typedef struct  sCommandList {
+    CommandBuffer       commands;
+    tWorkerJob          recording;
+}               tCommandList;
 
 typedef std::unordered_map<std::string, Shader*> tShaderMap;
 typedef std::chrono::duration<double,std::milli> tMilliseconds;
@@ -36,37 +123,86 @@ typedef std::chrono::steady_clock::time_point tTimePoint;
 class Renderer {
 
 public:
-    Renderer( Env* env );
+    Renderer( Env* env, const tRenderToFile* renderToFile = nullptr );
     ~Renderer( void );
 
     void	loop( void );
+    void    renderFrame( void );
+    void    waitForShaders( void );
     void    updateShadowDepthMap( void );
-    void    renderLights( void );
+    void    updateDynamicShadowDepthMap( void );
+    void    updateRaymarchedShadowMap( void );
+    void    renderLights( Shader& shader );
+    void    renderDepthPrepass( void );
     void    renderMeshes( void );
     void    renderSkybox( void );
     void    renderRaymarched( void );
     void    renderRaymarchedSurfaces( void );
     void    render2Dtexture( void );
-    void    renderBlendTexture( void );
+    void    renderScreen( void );
+    void    renderCapture( void );
+
+    void    setShadowUpdateAngle( float degrees ) { shadowUpdateAngle = degrees; };
+    void    setFramerate( float framerate ) { framePacer.setFramerate(framerate); };
+    const ShaderWatcher&    getShaderWatcher( void ) const { return (shaderWatcher); };
 
 private:
     Env*            env;
     Camera          camera;
     tShaderMap      shader;
-    tDepthMap       depthMap;       // depth-map for the view fustrum
-    tDepthMap       shadowDepthMap; // depth-map for the shadows
-    tDepthMap       renderbuffer;
-    tDepthMap       intermediateTexture; // I'm so sorry... [renderbuffer -> texture -> blend shader -> screen]
-    glm::mat4       lightSpaceMat;
+    ShaderVariants  raymarchVariants;   // permutations of the raymarch shader, see Raymarched::getDefines
+    ShaderWatcher   shaderWatcher;
+    tRenderPrograms programs;
+    FrameGraph      frameGraph;     // owns the render targets and schedules the passes
+    tRenderTargets  targets;
+    tRenderPasses   passes;
+    glm::mat4       lightSpaceMat[SHADOW_CASCADES];
+    tShadowCache    shadowCache;
+    float           shadowUpdateAngle;
+    glm::mat4       raymarchLightSpaceMat[RAYMARCH_MAX_OBJECTS];
+    glm::vec3       raymarchShadowDir;  // sun direction the raymarched shadows were rendered with
+    size_t          raymarchShadowGeneration;   // and the objects (see Raymarched::getGeneration)
+    double          raymarchShadowTime;         // uTime of the last render of the animated objects
+    std::vector<Shader*>    raymarchShaders[2];     // variant of each object, without and with shadows
+    size_t                  raymarchShadersGeneration;  // of the objects they were looked up for
+    size_t                  raymarchVariantsGeneration; // of the variants, the failed ones are replaced on a reload
+    std::vector<size_t>     raymarchOrder;          // draw order of the objects, kept between frames
     int             useShadows;
     float           framerate;
     VideoCapture*   videoCapture;
+    bool            offline;
+    tRenderToFile   renderToFile;       // only set when offline
+    CameraPath*     cameraPath;
+    Simulation*     simulation;         // only set when interactive
+    GLuint          captureFbo;         // output resolution target read back by the capture
+    GLuint          captureTexture;
+    double          time;               // seconds, the uTime of the shaders
+    size_t          frame;
+    GpuTimer        gpuTimer;
+    tCommandList    commandLists[static_cast<int>(eCommandList::count)];
+    std::vector<tSpatialId>     inView;     // the objects of the world in the view frustum
+    std::vector<uint8_t>        visible;    // by spatial id, read by the recording of the camera passes
+    WorkerPool      workers;            // after the command lists, the pending jobs write in them
+    GlBackend       backend;
+    FramePacer      framePacer;         // interactive only, the offline render never waits
+    unsigned int    screenVao;
 
     tTimePoint      lastTime;
 
-    void    initShadowDepthMap( const size_t width = 1024, const size_t height = 1024 );
-    void    initDepthMap( void );
-    void    initRenderbuffer( void );
-    void    initIntermediateTexture( void );
+    void    initFrameGraph( void );
+    void    updatePasses( void );
+    void    updateShadowCascades( const glm::vec3& lightDir );
+    void    invalidateShadowCache( const glm::vec3& lightDir );
+    bool    hasDynamicModels( void );
+    void    reloadShaders( void );
+    void    initCapture( void );
+    void    waitForCommands( void );
+    void    recordCommands( void );
+    void    cullObjects( void );
+    bool    isVisible( tSpatialId id ) const { return (id == SPATIAL_NONE || visible[id]); };
+    void    pick( void );
+    void    initCommandLists( void );
+    void    setCommandList( eCommandList list, const std::function<void(CommandBuffer&)>& record );
+    const CommandBuffer&    getCommands( eCommandList list );
 
 };
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <random>
+
+#include "Exception.hpp"
+#include "Raymarched.hpp"
+#include "Light.hpp"
+
+enum class eSceneEntry {
+    environment,    // cubemap reflected by the raymarched surfaces
+    skybox,
+    noise,
+    model,
+    instance,
+    billboard,
+    raymarched,
+    surface,
+    texturedSurface,
+    light
+};
+
+typedef struct  sSceneEntry {
+    eSceneEntry                 type;
+    std::string                 name;       // model and instance
+    std::vector<std::string>    paths;      // 6 cubemap faces, or the model / texture file
+    glm::vec3                   position;
+    glm::vec3                   orientation;
+    glm::vec3                   scale;
+    tObject                     object;     // raymarched only
+    eLightType                  lightType;
+    glm::vec3                   ambient;
+    glm::vec3                   diffuse;
+    glm::vec3                   specular;
+    glm::vec3                   attenuation; // point lights: constant, linear, quadratic
+    size_t                      line;
+}               tSceneEntry;
+
+/*  A scene description, one entry per line (empty lines and lines starting with # are skipped):
+        environment <left> <right> <up> <down> <front> <back>
+        skybox      <left> <right> <up> <down> <front> <back>
+        noise       <path>
+        model       <name> <path> <position> <orientation> <scale>
+        instance    <name> <position> <orientation> <scale>     shares the meshes of model <name>
+        billboard   <position> <orientation> <scale>
+        raymarched  <type> <position> <orientation> <scale> <bounding sphere scale> <speed modifier>
+                    <ambient> <diffuse> <specular> <shininess> <opacity>
+        surface     <raymarched|textured> <position> <orientation> <scale>
+        light       directional <position> <ambient> <diffuse> <specular>
+        light       point <position> <ambient> <diffuse> <specular> [<constant> <linear> <quadratic>]
+    vectors are three floats, orientations in radians, paths without spaces. The file is read one
+    entry at a time, so a scene never lives in memory as text or as a document tree.
+*/
+class Scene {
+
+public:
+    Scene( const std::string& filename );
+    ~Scene( void );
+
+    bool                next( tSceneEntry& entry );
+    const std::string&  getFilename( void ) const { return (filename); };
+
+    static void         generate( const std::string& filename, size_t instances, size_t exhibits, unsigned int seed = 42 );
+
+private:
+    std::string         filename;
+    std::ifstream       ifs;
+    size_t              line;
+
+    void                parse( const std::string& keyword, std::istringstream& iss, tSceneEntry& entry );
+    std::string         error( const std::string& message ) const;
+
+};
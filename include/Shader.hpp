@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <sys/stat.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -10,36 +11,87 @@
 #include <fstream>
 #include <forward_list>
 #include <unordered_map>
+#include <vector>
+#include <set>
+#include <sstream>
+#include <cstdint>
 
 #include "Exception.hpp"
+#include "GlState.hpp"
+#include "UniformId.hpp"
+
+typedef struct  sShaderSource {
+    std::string             code;           // with the #include directives resolved
+    std::set<std::string>   dependencies;   // every file included, directly or not
+}               tShaderSource;
 
 class Shader {
 
 public:
     Shader( const std::string& vertexShader, const std::string& fragmentShader );
+    Shader( const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines );
     ~Shader( void );
+    /* owns the program, its pending shaders and the reloaded program, never copied */
+    Shader( const Shader& ) = delete;
+    Shader&             operator=( const Shader& ) = delete;
+
+    static void         setBinaryCache( const std::string& directory );
+    static void         setParallelCompile( void );
+    static void         invalidateSource( const std::string& filename );
+    bool                isFromBinaryCache( void ) const { return (fromBinaryCache); };
+    bool                isReady( void );
+    bool                dependsOn( const std::vector<std::string>& filenames ) const;
+    void                reload( void );
+    bool                update( void );
 
     std::string         getFromFile( const std::string& filename );
+    std::string         addDefines( const std::string& source, const std::vector<std::string>& defines );
     GLuint              create( const char* shaderSource, GLenum shaderType );
-    GLuint              createProgram( const std::forward_list<GLuint>& shaders );
+    GLuint              createProgram( const std::forward_list<GLuint>& shaders, bool retrievable = false );
     void                isCompilationSuccess( GLint handle, GLint success, int shaderType );
 
     void                use( void ) const;
 
-    unsigned int        getUniformLocation( const std::string& name );
+    GLint               getUniformLocation( tUniformId id ) const;
+    static const std::string&   getUniformName( tUniformId id );
 
-    void                setIntUniformValue( const std::string& name, const int i );
-    void                setFloatUniformValue( const std::string& name, const float f );
-    void                setMat2UniformValue( const std::string& name, const glm::mat2& m );
-    void                setMat3UniformValue( const std::string& name, const glm::mat3& m );
-    void                setMat4UniformValue( const std::string& name, const glm::mat4& m );
-    void                setVec2UniformValue( const std::string& name, const glm::vec2& v );
-    void                setVec3UniformValue( const std::string& name, const glm::vec3& v );
-    void                setVec4UniformValue( const std::string& name, const glm::vec4& v );
+    void                setIntUniformValue( const tUniformName& name, const int i );
+    void                setFloatUniformValue( const tUniformName& name, const float f );
+    void                setMat2UniformValue( const tUniformName& name, const glm::mat2& m );
+    void                setMat3UniformValue( const tUniformName& name, const glm::mat3& m );
+    void                setMat4UniformValue( const tUniformName& name, const glm::mat4& m );
+    void                setMat4ArrayUniformValue( const tUniformName& name, const glm::mat4* m, size_t count );
+    void                setVec2UniformValue( const tUniformName& name, const glm::vec2& v );
+    void                setIVec2UniformValue( const tUniformName& name, const glm::ivec2& v );
+    void                setVec3UniformValue( const tUniformName& name, const glm::vec3& v );
+    void                setVec4UniformValue( const tUniformName& name, const glm::vec4& v );
 
     GLuint  id;
 
 private:
-    std::unordered_map<std::string, unsigned int>   uniformLocations;
+    std::unordered_map<tUniformId, GLint>           uniformLocations;   // of the active uniforms, by hashed name, filled once linked
+    std::string                                     vertexShader;
+    std::string                                     fragmentShader;
+    std::vector<std::string>                        defines;
+    std::set<std::string>                           dependencies;   // the two sources and their includes
+    Shader*                                         reloaded;       // recompiled program waiting to replace this one
+    bool                                            fromBinaryCache;
+    bool                                            ready;
+    std::forward_list<GLuint>                       pending;        // shaders compiled for the program, until it is ready
+    std::string                                     binaryFile;     // where to save the program once linked
+    uint64_t                                        binaryKey;
+
+    static std::string  binaryCache;    // directory of the program binaries, disabled when empty
+    static std::unordered_map<std::string, tShaderSource>   sources;
+    static std::unordered_map<tUniformId, std::string>      uniformNames;   // of every program linked, to print the ids
+
+    static const tShaderSource& getSource( const std::string& filename );
+    static std::string  resolveIncludes( const std::string& filename, std::set<std::string>& included, int sourceId );
+
+    void                load( const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines );
+    bool                loadBinary( const std::string& binaryFile, uint64_t key );
+    void                saveBinary( const std::string& binaryFile, uint64_t key );
+    void                finish( void );
+    void                resolveUniforms( void );
 
 };
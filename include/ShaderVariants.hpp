@@ -0,0 +1,51 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Exception.hpp"
+#include "Shader.hpp"
+
+/*  The permutations of a shader pair. A variant is compiled the first time it is asked for (or
+    loaded from the program binary cache, see Shader::setBinaryCache), and kept by the (sorted)
+    set of its defines.
+    A variant that fails (its sources are mid-edit when it is first asked for) is reported once
+    and never ready: get() returns nullptr if its includes could not be resolved. The failed
+    variants are compiled again on the next reload, which changes the generation so that the
+    owner looks its variants up again.
+*/
+class ShaderVariants {
+
+public:
+    ShaderVariants( const std::string& vertexShader, const std::string& fragmentShader );
+    ~ShaderVariants( void );
+
+    Shader*             get( std::vector<std::string> defines );
+    void                reload( const std::vector<std::string>& filenames );
+    void                update( void );
+    size_t              size( void ) const { return (variants.size()); };
+    size_t              getGeneration( void ) const { return (generation); };
+    bool                isReady( Shader* variant );
+    bool                isReady( void );    // none is still compiling
+
+private:
+    typedef struct  sShaderVariant {
+        Shader*                     shader;     // nullptr when its sources could not be read
+        std::vector<std::string>    defines;
+        bool                        failed;
+    }               tShaderVariant;
+
+    std::string                                     vertexShader;
+    std::string                                     fragmentShader;
+    std::unordered_map<std::string, tShaderVariant> variants;
+    std::unordered_set<const Shader*>               failed;
+    size_t                                          generation;
+
+    void                compile( tShaderVariant& variant );
+    void                fail( tShaderVariant& variant, const Exception::ShaderError& err );
+
+};
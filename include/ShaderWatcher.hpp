@@ -0,0 +1,43 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "Exception.hpp"
+
+/*  Watches the shader sources of a directory (recursively) from a background thread, by polling
+    their modification time, and collects the files that changed since the last call to
+    getChanges. The renderer decides what to recompile from that list.
+*/
+class ShaderWatcher {
+
+public:
+    ShaderWatcher( const std::string& directory, size_t intervalMs = 250 );
+    ~ShaderWatcher( void );
+
+    std::vector<std::string>    getChanges( void );
+    std::thread::id             getThreadId( void ) const { return (thread.get_id()); };
+
+private:
+    std::string                             directory;
+    std::chrono::milliseconds               interval;
+    std::unordered_map<std::string, time_t> mtimes;     // only touched by the watching thread
+    std::set<std::string>                   changes;
+    std::mutex                              mutex;
+    std::atomic<bool>                       running;
+    std::thread                             thread;
+
+    void                watch( void );
+    void                scan( const std::string& path, bool notify );
+
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include "Exception.hpp"
+#include "Env.hpp"
+#include "Camera.hpp"
+#include "SpscQueue.hpp"
+
+#define SIMULATION_RATE 120.0           // ticks per second
+#define SIMULATION_INPUT_QUEUE 64
+#define SIMULATION_MAX_CATCHUP 4        // ticks run back to back at most, the rest of a longer stall is skipped
+
+/*  what the render thread gives the simulation each frame, the mouse look accumulates */
+typedef struct  sSimInput {
+    glm::vec3   axes;               // see Camera::getMoveAxes
+    glm::vec2   look;               // mouse displacement in pixels
+}               tSimInput;
+
+/*  the state of the world at the end of a tick, never modified once published */
+typedef struct  sSimSnapshot {
+    double      time;               // seconds since the simulation started
+    glm::vec3   cameraPosition;
+    float       pitch;
+    float       yaw;
+    float       speedmod;
+    glm::vec3   lightPosition;
+}               tSimSnapshot;
+
+/*  Advances the camera and the sun at a fixed timestep, on its own thread or from the render
+    thread (update), independently of the framerate. Each tick publishes a snapshot, the
+    renderer draws the state interpolated between the last two, one tick in the past, so the
+    motion stays smooth whatever the ratio between the two rates. After a stall (a breakpoint, a
+    long load) only SIMULATION_MAX_CATCHUP ticks are caught up, the simulation clock skips the
+    rest instead of spiraling into ticks that never catch up.
+*/
+class Simulation {
+
+public:
+    Simulation( Env* env, const Camera& camera, bool threaded = true, double rate = SIMULATION_RATE );
+    ~Simulation( void );
+
+    void                pushInput( const tSimInput& input );
+    void                update( void );
+    tSimSnapshot        getSnapshot( void );
+    double              getTime( void ) const;
+
+    static glm::vec3    getSunPosition( double time );
+
+private:
+    Env*                        env;
+    Camera                      camera;         // only touched by the ticks
+    double                      step;           // seconds
+    std::chrono::steady_clock::time_point   start;
+    std::atomic<double>         skipped;        // seconds of stalls skipped by the simulation clock
+    size_t                      ticks;
+    glm::vec3                   axes;           // last movement input, held between ticks
+    SpscQueue<tSimInput>        inputs;
+    tSimInput                   unsent;         // inputs the queue had no room for (render thread)
+    bool                        hasUnsent;
+    tSimSnapshot                snapshots[2];   // previous and last tick
+    std::mutex                  mutex;
+    std::atomic<bool>           running;
+    std::thread                 thread;
+
+    void                run( void );
+    void                advance( void );
+    void                tick( void );
+
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "Exception.hpp"
+
+#define SPATIAL_NONE 0xFFFFFFFF
+#define SPATIAL_ALL 0xFFFFFFFF      // mask matching every category
+#define SPATIAL_MARGIN 0.5f         // the leaves are enlarged by that much, small moves do not touch the tree
+#define SPATIAL_STACK 256           // nodes pending during a query, the tree is balanced so its height stays far below
+
+typedef uint32_t    tSpatialId;
+
+typedef struct  sBounds {
+    glm::vec3   min;
+    glm::vec3   max;
+}               tBounds;
+
+/*  the six planes of a view frustum, their normals point inside */
+typedef struct  sFrustum {
+    glm::vec4   planes[6];
+}               tFrustum;
+
+typedef struct  sSpatialNode {
+    tBounds     bounds;         // enlarged by the margin for the leaves
+    tBounds     tight;          // the bounds given to insert or move (leaves only)
+    uint32_t    parent;         // next free node when the node is free
+    uint32_t    children[2];    // SPATIAL_NONE for the leaves
+    int         height;         // 0 for the leaves, -1 for the free nodes
+    uint32_t    mask;           // category of a leaf, union of the categories below for the other nodes
+    const void* data;
+}               tSpatialNode;
+
+/*  A dynamic bounding volume hierarchy: every leaf is an object, every other node bounds its two
+    children. An object is inserted next to the sibling that grows the tree the least (surface
+    area heuristic) and the tree is rebalanced with rotations on the way up, so the queries
+    stay logarithmic whatever the order of the inserts. The ids are stable until removed.
+    Each object has a category mask, a query only walks the subtrees holding the categories it
+    asks for. The index is not synchronized, it is used from a single thread at a time.
+*/
+class SpatialIndex {
+
+public:
+    SpatialIndex( float margin = SPATIAL_MARGIN );
+    ~SpatialIndex( void );
+
+    tSpatialId          insert( const tBounds& bounds, uint32_t mask, const void* data );
+    void                remove( tSpatialId id );
+    bool                move( tSpatialId id, const tBounds& bounds );
+    void                clear( void );
+
+    void                query( const tFrustum& frustum, std::vector<tSpatialId>& result, uint32_t mask = SPATIAL_ALL ) const;
+    void                query( const glm::vec3& center, float radius, std::vector<tSpatialId>& result, uint32_t mask = SPATIAL_ALL ) const;
+    tSpatialId          raycast( const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, uint32_t mask = SPATIAL_ALL ) const;
+
+    /* getters */
+    const void*         getData( tSpatialId id ) const { return (nodes[id].data); };
+    uint32_t            getMask( tSpatialId id ) const { return (nodes[id].mask); };
+    const tBounds&      getBounds( tSpatialId id ) const { return (nodes[id].tight); };
+    size_t              getCount( void ) const { return (count); };
+    size_t              getCapacity( void ) const { return (nodes.size()); };    // the ids are below
+    int                 getHeight( void ) const { return (root != SPATIAL_NONE ? nodes[root].height : 0); };
+
+private:
+    std::vector<tSpatialNode>   nodes;
+    uint32_t                    root;
+    uint32_t                    freeList;
+    size_t                      count;
+    float                       margin;
+
+    uint32_t            allocate( void );
+    void                release( uint32_t node );
+    void                insertLeaf( uint32_t leaf );
+    void                removeLeaf( uint32_t leaf );
+    void                refit( uint32_t node );
+    void                fit( uint32_t node );
+    uint32_t            balance( uint32_t a );
+
+};
+
+tBounds                 merge( const tBounds& a, const tBounds& b );
+tBounds                 transformBounds( const tBounds& bounds, const glm::mat4& transform );
+tFrustum                getFrustum( const glm::mat4& viewProjection );
+int                     classify( const tFrustum& frustum, const tBounds& bounds );
+bool                    intersects( const tFrustum& frustum, const tBounds& bounds );
+bool                    intersects( const glm::vec3& center, float radius, const tBounds& bounds );
+bool                    intersects( const glm::vec3& origin, const glm::vec3& invDirection, const tBounds& bounds, float& distance );
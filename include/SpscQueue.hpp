@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+
+/*  Bounded single-producer single-consumer queue, lock-free: only the producer moves the tail
+    and only the consumer moves the head. push and pop fail instead of blocking when the queue
+    is full or empty, the caller decides whether to wait, retry or drop.
+*/
+template <typename T>
+class SpscQueue {
+
+public:
+    SpscQueue( size_t capacity ) : buffer(capacity + 1), head(0), tail(0) {};
+    ~SpscQueue( void ) {};
+
+    bool                push( const T& value ) {
+        size_t t = this->tail.load(std::memory_order_relaxed);
+        size_t next = (t + 1) % this->buffer.size();
+        if (next == this->head.load(std::memory_order_acquire))
+            return (false);
+        this->buffer[t] = value;
+        this->tail.store(next, std::memory_order_release);
+        return (true);
+    };
+
+    bool                pop( T& value ) {
+        size_t h = this->head.load(std::memory_order_relaxed);
+        if (h == this->tail.load(std::memory_order_acquire))
+            return (false);
+        value = this->buffer[h];
+        this->head.store((h + 1) % this->buffer.size(), std::memory_order_release);
+        return (true);
+    };
+
+    bool                empty( void ) const {
+        return (this->head.load(std::memory_order_acquire) == this->tail.load(std::memory_order_acquire));
+    };
+
+private:
+    std::vector<T>      buffer;     // one slot is kept empty to tell a full queue from an empty one
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+
+};
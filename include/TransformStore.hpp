@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__SSE__)
+# include <xmmintrin.h>
+#endif
+
+#include "Exception.hpp"
+
+#define TRANSFORM_NONE 0xFFFFFFFF
+
+typedef uint32_t    tTransformId;
+
+/*  The transforms of every object of the scene, in one place. The position, orientation (euler
+    angles, applied z then y then x) and scale components are stored in arrays of floats, one per
+    component, so that the local matrices can be composed four at a time. A transform can have a
+    parent, its world matrix is then relative to it.
+    Setting a component marks the transform dirty, update() composes the dirty local matrices
+    and propagates the world matrices down the hierarchy (parents are always processed before
+    their children), so an unchanged transform costs nothing. The transforms whose world matrix
+    changed in the last update are flagged until the next one.
+    Used from the GL thread only, the world matrices can be read from the workers while the
+    frame is recorded.
+*/
+class TransformStore {
+
+public:
+    static tTransformId     create( const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale, tTransformId parent = TRANSFORM_NONE );
+    static void             destroy( tTransformId id );
+
+    static void             update( void );
+
+    static void             setPosition( tTransformId id, const glm::vec3& position );
+    static void             setOrientation( tTransformId id, const glm::vec3& orientation );
+    static void             setScale( tTransformId id, const glm::vec3& scale );
+    static void             setParent( tTransformId id, tTransformId parent );
+
+    static glm::vec3        getPosition( tTransformId id );
+    static glm::vec3        getOrientation( tTransformId id );
+    static glm::vec3        getScale( tTransformId id );
+    static tTransformId     getParent( tTransformId id ) { return (parents[id]); };
+    static const glm::mat4& getWorld( tTransformId id ) { return (worlds[id]); };
+    static bool             isChanged( tTransformId id ) { return (changed[id] != 0); };
+    static size_t           getComposed( void ) { return (composed); };
+
+private:
+    static std::vector<float>           components[9];  // position xyz, orientation xyz, scale xyz
+    static std::vector<tTransformId>    parents;
+    static std::vector<glm::mat4>       locals;
+    static std::vector<glm::mat4>       worlds;
+    static std::vector<uint8_t>         dirty;      // the local matrix is outdated
+    static std::vector<uint8_t>         changed;    // the world matrix changed in the last update
+    static std::vector<uint8_t>         alive;
+    static std::vector<tTransformId>    dirtyList;
+    static std::vector<tTransformId>    freeList;
+    static std::vector<tTransformId>    order;      // the live transforms, parents first
+    static bool                         sorted;
+    static size_t                       composed;   // local matrices composed by the last update
+
+    static void             markDirty( tTransformId id );
+    static void             compose( const tTransformId* ids, size_t count );
+    static void             sort( void );
+
+};
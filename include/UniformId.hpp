@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+typedef uint64_t    tUniformId;
+
+/*  FNV-1a of a uniform name, a literal is hashed at compile time when the compiler folds it. */
+constexpr tUniformId    uniformId( const char* name, tUniformId hash = 14695981039346656037ULL ) {
+    return (*name ? uniformId(name + 1, (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ULL) : hash);
+}
+
+inline tUniformId       uniformId( const std::string& name ) {
+    return (uniformId(name.c_str()));
+}
+
+/*  What the uniform setters take: a literal, a string or an id already hashed, without building
+    a string. The names built at runtime (array elements) are hashed once, when their owner is
+    created, and passed as ids.
+*/
+typedef struct  sUniformName {
+    tUniformId  id;
+
+    sUniformName( const char* name ) : id(uniformId(name)) {};
+    sUniformName( const std::string& name ) : id(uniformId(name)) {};
+    sUniformName( tUniformId id ) : id(id) {};
+}               tUniformName;
@@ -4,34 +4,73 @@
 #include <GLFW/glfw3.h>
 
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
 #include <opencv2/core/core.hpp>
 #include <opencv2/videoio/videoio.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "Exception.hpp"
+#include "GlState.hpp"
+#include "SpscQueue.hpp"
+
+#define CAPTURE_PBO_COUNT 3     // frames in flight between glReadPixels and the copy out of the PBO
+#define CAPTURE_QUEUE_SIZE 8    // frames buffered for the encoder thread
+
 enum class eCodec {
     jpeg,
     mp4v,
-    avc1
+    avc1,
+    y4m     // raw I420 frames (YUV4MPEG2), converted on the GPU, for ffmpeg to encode afterwards
 };
 
+/*  Records the default framebuffer. The frames are read back asynchronously in a ring of pixel
+    pack buffers and copied out a couple of frames later, once their fence is signaled, then an
+    encoder thread flips and encodes them. The render thread only waits when the encoder falls
+    more than CAPTURE_QUEUE_SIZE frames behind (no frame is ever dropped).
+    With eCodec::y4m the framebuffer must already hold the I420 planes (see yuv.frag.glsl): half
+    the bytes of BGR are read back and written to the file as they are.
+*/
 class VideoCapture {
 
 public:
     VideoCapture( const std::string source, int width, int height, int framerate, eCodec codec=eCodec::avc1, float recordingTime=0. );
     ~VideoCapture( void );
  
-    void	        write( bool vflip=true );
+    void	        write( bool vflip=true, GLuint framebuffer=0 );
+    bool            isRecording( void ) const { return (recording); };
+    bool            isYuv( void ) const { return (yuv); };
 
 private:
-    cv::VideoWriter videoWriter;
-    cv::Size        size;
-    cv::Mat         frame;
-    float           framerate;
-    int             maxFrames;
-    int             currentFrame;
+    cv::VideoWriter                     videoWriter;
+    std::ofstream                       rawWriter;      // y4m output
+    bool                                yuv;
+    cv::Size                            size;
+    float                               framerate;
+    int                                 maxFrames;
+    int                                 currentFrame;
 
-    uint8_t*        data;
+    GLuint                              pbo[CAPTURE_PBO_COUNT];
+    GLsync                              fences[CAPTURE_PBO_COUNT];
+    size_t                              pboHead;        // next PBO to read into
+    size_t                              pboPending;     // PBOs read into but not copied yet
+    std::vector<uint8_t>                frames[CAPTURE_QUEUE_SIZE];
+    SpscQueue<size_t>                   encodeQueue;    // frames ready for the encoder
+    SpscQueue<size_t>                   freeQueue;      // frames given back by the encoder
+    size_t                              spareFrame;     // a free frame the render thread could not fill, CAPTURE_QUEUE_SIZE when none
+    std::atomic<bool>                   vflip;
+    std::atomic<bool>                   recording;
+    std::thread                         encoder;
 
+    void            readback( GLuint framebuffer );
+    void            copyOldest( bool wait );
+    void            finish( void );
+    void            encode( void );
     int             getCodecFourcc(eCodec codec);
 };
\ No newline at end of file
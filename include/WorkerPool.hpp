@@ -0,0 +1,50 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+
+#include "Exception.hpp"
+
+/*  a job run again every frame, owned by the caller: queuing and waiting for it allocates nothing */
+typedef struct  sWorkerJob {
+    std::function<void(void)>   function;   // set once
+    bool                        pending;    // queued or running, guarded by the mutex of the pool
+    std::exception_ptr          error;      // thrown by the last run, rethrown by wait
+}               tWorkerJob;
+
+/*  A few threads running the jobs submitted to them in order. The future of a job rethrows
+    what the job threw. The jobs repeated every frame are given with run() instead, the pool
+    keeps a pointer to them until they are done and wait() rethrows what they threw.
+*/
+class WorkerPool {
+
+public:
+    WorkerPool( size_t count = std::max(std::thread::hardware_concurrency(), 2u) - 1 );
+    ~WorkerPool( void );
+
+    std::future<void>   submit( const std::function<void(void)>& job );
+    void                run( tWorkerJob& job );
+    void                wait( tWorkerJob& job );
+
+private:
+    std::vector<std::thread>                            threads;
+    std::deque<std::shared_ptr<std::packaged_task<void(void)>>>  tasks;
+    std::vector<tWorkerJob*>                            jobs;       // cleared once all were taken, it keeps its capacity
+    size_t                                              next;       // first job not taken
+    std::mutex                                          mutex;
+    std::condition_variable                             condition;
+    std::condition_variable                             finished;
+    bool                                                running;
+
+    void                work( void );
+
+};
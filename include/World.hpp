@@ -0,0 +1,130 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <future>
+#include <algorithm>
+#include <cstdint>
+
+#include "Exception.hpp"
+#include "Scene.hpp"
+#include "Model.hpp"
+#include "Raymarched.hpp"
+#include "RaymarchedSurface.hpp"
+#include "WorkerPool.hpp"
+#include "SpatialIndex.hpp"
+#include "FrameArena.hpp"
+
+#define WORLD_CELL_SIZE 32.0f
+#define WORLD_LOAD_RADIUS 96.0f         // cells closer than that to the camera are streamed in
+#define WORLD_UNLOAD_RADIUS 128.0f      // and kept until they are farther than that
+#define WORLD_MEMORY_BUDGET (512 << 20) // bytes of vertices, indices and textures
+#define WORLD_UPLOAD_BUDGET (16 << 20)  // bytes uploaded per frame
+#define WORLD_MAX_READS 4               // model files read at the same time
+/* categories of the objects in the spatial index */
+#define WORLD_MODELS 0x1
+#define WORLD_SURFACES 0x2
+#define WORLD_EXHIBITS 0x4              // the bounding spheres of the raymarched objects
+
+class Env;
+
+enum class eCellState {
+    unloaded,
+    loading,    // waiting for its models
+    loaded
+};
+
+enum class eAssetState {
+    unloaded,
+    reading,    // read and decoded by a worker
+    read,       // waiting for its upload
+    resident,
+    failed      // the file could not be read, its instances are left out
+};
+
+/*  a model file shared by the cells that place it */
+typedef struct  sWorldAsset {
+    eAssetState         state;
+    std::future<void>   reading;
+    tModelData*         data;
+    Model*              model;      // the meshes and textures the instances are cloned from
+    size_t              uploaded;   // steps of the upload done, it can span several frames
+    size_t              bytes;      // known after the first read
+    size_t              refs;       // cells loading or loaded with it
+    size_t              lastUsed;   // frame, the least recently used are evicted first
+}               tWorldAsset;
+
+typedef struct  sWorldCell {
+    glm::ivec2                      coord;
+    eCellState                      state;
+    std::vector<tSceneEntry>        entries;
+    std::vector<std::string>        assets;
+    std::vector<Model*>             models;
+    std::vector<RaymarchedSurface*> surfaces;
+    std::vector<size_t>             objects;    // entries of the raymarched objects
+    std::vector<tSpatialId>         exhibits;   // their bounding spheres in the spatial index, while loaded
+    float                           priority;   // distance to the camera, weighted by the view direction
+}               tWorldCell;
+
+/*  The models, surfaces and raymarched objects of the scene are sorted in cells of a grid on the
+    ground. Each frame the cells around the camera are requested in order of priority (distance,
+    the cells in front first) within the memory budget; their model files are read and decoded
+    on the workers then uploaded on the GL thread, a few megabytes per frame, an image or a mesh
+    at a time. The far cells are unloaded, the model files no cell uses stay cached until the
+    budget is exceeded.
+    The loaded cells are added to the lists of the Env, and their raymarched objects closest to
+    the camera are handed to the Raymarched (which draws at most RAYMARCH_MAX_OBJECTS).
+    The cells and the loaded objects are kept in spatial indices (see SpatialIndex): the cells in
+    range, the exhibits around the camera, the visible objects and the picked ones are queried
+    instead of looping over the whole scene. The data of an object is its scene entry.
+*/
+class World {
+
+public:
+    World( Env* env );
+    ~World( void );
+
+    void                add( const tSceneEntry& entry );
+    void                update( const glm::vec3& position, const glm::vec3& front, bool wait = false );
+    void                updateBounds( void );
+    void                print( std::ostream& os ) const;
+    const tSceneEntry*  pick( const glm::vec3& origin, const glm::vec3& direction, float& distance ) const;
+
+    bool                hasRaymarched( void ) const { return (raymarchedCount != 0); };
+    const SpatialIndex& getIndex( void ) const { return (index); };
+    void                setMemoryBudget( size_t bytes ) { memoryBudget = bytes; };
+
+private:
+    Env*                                            env;
+    std::unordered_map<int64_t, tWorldCell>         cells;
+    std::unordered_map<std::string, tWorldAsset>    assets;     // by file
+    std::unordered_map<std::string, std::string>    names;      // model name -> file
+    std::unordered_set<int64_t>                     active;     // the cells loading or loaded
+    std::vector<const tSceneEntry*>                 exhibits;   // the objects given to the Raymarched
+    SpatialIndex                                    index;      // the objects of the loaded cells
+    SpatialIndex                                    cellIndex;  // the cells, flat on the ground
+    std::vector<tSpatialId>                         found;      // results of the queries
+    WorkerPool                                      workers;
+    size_t                                          memoryBudget;
+    size_t                                          residentBytes;
+    size_t                                          reads;
+    size_t                                          frame;
+    size_t                                          raymarchedCount;
+
+    static int64_t      getKey( const glm::ivec2& coord );
+    static float        getDistance( const tWorldCell& cell, const glm::vec3& position );
+    static float        getPriority( const tWorldCell& cell, const glm::vec3& position, const glm::vec3& front );
+    void                request( tWorldCell& cell );
+    void                read( const std::string& file, tWorldAsset& asset );
+    void                upload( bool wait );
+    void                instantiate( tWorldCell& cell );
+    void                unload( tWorldCell& cell );
+    void                evict( void );
+    void                updateExhibits( const glm::vec3& position );
+
+};
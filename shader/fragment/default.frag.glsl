@@ -42,12 +42,10 @@ in vec3 Normal;
 in vec2 TexCoords;
 in vec3 Tangent;
 in vec3 Bitangent;
-in vec4 FragPosLightSpace;
 
 #define MAX_POINT_LIGHTS 8
 
 /* uniforms */
-uniform sampler2D shadowMap;
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_normal1;
 uniform sampler2D texture_specular1;
@@ -60,6 +58,8 @@ uniform sPointLight pointLights[MAX_POINT_LIGHTS];
 uniform int nPointLights;
 uniform sState state;
 
+#include "../include/shadows.glsl"
+
 /* global variables */
 vec3    gDiffuse;
 vec3    gSpecular;
@@ -67,9 +67,8 @@ vec3    gEmissive;
 vec3    gNormal;
 
 /* prototypes */
-vec3    computeDirectionalLight( sDirectionalLight light, vec3 normal, vec3 viewDir, vec4 fragPosLightSpace );
+vec3    computeDirectionalLight( sDirectionalLight light, vec3 normal, vec3 viewDir, vec3 fragPos );
 vec3    computePointLight( sPointLight light, vec3 normal, vec3 fragPos,vec3 viewDir );
-float   computeShadows( vec4 fragPosLightSpace );
 void    handleStates( void );
 
 
@@ -77,7 +76,7 @@ void main() {
     handleStates();
     vec3 viewDir = normalize(viewPos - FragPos);
 
-    vec3 result = computeDirectionalLight(directionalLight, gNormal, viewDir, FragPosLightSpace);
+    vec3 result = computeDirectionalLight(directionalLight, gNormal, viewDir, FragPos);
     for (int i = 0; i < nPointLights && i < MAX_POINT_LIGHTS; ++i)
         result += computePointLight(pointLights[i], gNormal, FragPos, viewDir);
 
@@ -97,7 +96,7 @@ void    handleStates( void ) {
         gNormal = normalize(Normal);
 }
 
-vec3 computeDirectionalLight( sDirectionalLight light, vec3 normal, vec3 viewDir, vec4 fragPosLightSpace ) {
+vec3 computeDirectionalLight( sDirectionalLight light, vec3 normal, vec3 viewDir, vec3 fragPos ) {
     vec3 lightDir = normalize(light.position);
     /* diffuse */
     float diff = max(dot(normal, lightDir), 0.0);
@@ -111,7 +110,7 @@ vec3 computeDirectionalLight( sDirectionalLight light, vec3 normal, vec3 viewDir
     vec3 specular = light.specular * spec * gSpecular;
 
     if (state.use_shadows) {
-        float shadow  = computeShadows(fragPosLightSpace);
+        float shadow  = computeMeshShadows(fragPos, normal);
         return (gEmissive + ambient + (1.0 - shadow) * (diffuse + specular));
     }
     return (gEmissive + ambient + (diffuse + specular));
@@ -134,19 +133,3 @@ vec3 computePointLight( sPointLight light, vec3 normal, vec3 fragPos, vec3 viewD
 
     return (gEmissive + ambient + diffuse + specular);
 }
-
-float computeShadows( vec4 fragPosLightSpace ) {
-    vec3 projCoords = (fragPosLightSpace.xyz / fragPosLightSpace.w) * 0.5 + 0.5;
-    float currentDepth = projCoords.z;
-    float bias = 0.0025;
-    /* PCF */
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    for (int x = -1; x <= 1; ++x) {
-        for (int y = -1; y <= 1; ++y) {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-            shadow += (currentDepth - bias > pcfDepth ? 1.0 : 0.0);
-        }
-    }
-    return (projCoords.z > 1.0 ? 0.0 : shadow / 9.0);
-}
@@ -0,0 +1,17 @@
+#version 400 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+uniform int factor;
+
+/* box filter of the factor x factor block of the supersampled scene under the pixel */
+void main() {
+    ivec2 origin = ivec2(gl_FragCoord.xy) * factor;
+    vec3 color = vec3(0.0);
+    for (int y = 0; y < factor; ++y)
+        for (int x = 0; x < factor; ++x)
+            color += texelFetch(screenTexture, origin + ivec2(x, y), 0).rgb;
+    FragColor = vec4(color / float(factor * factor), 1.0);
+}
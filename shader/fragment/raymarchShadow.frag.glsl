@@ -0,0 +1,88 @@
+#version 400 core
+out vec4 FragColor;
+
+/*  Shadow of one raymarched object seen from the directional light. Each texel marches the
+    light ray through the bounding sphere of the object and stores:
+    x: the distance of the first hit from the near plane (2 * radius when missed)
+    y: the closest distance to the surface along the ray before the hit
+    z: the distance at which that closest approach happened
+    which is what the per-pixel soft shadow marching used to compute for a receiver on that ray.
+*/
+
+struct sMaterial {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+    float opacity;
+};
+
+struct sObject {
+    int         id;
+    float       scale;
+    float       boundingSphereScale;
+    mat4        invMat;
+    sMaterial   material;
+};
+
+in vec2 TexCoords;
+
+#define MAX_OBJECTS 8
+
+uniform sObject object[MAX_OBJECTS];
+uniform int layer;
+uniform mat4 invLightSpaceMat;
+uniform vec3 lightDir;
+uniform float uTime;
+
+const int   maxRayStepsShadow = 128;
+const float minDistShadow = 0.005;
+
+vec3    mapObj( in vec3 p, int i );
+float   blob( vec3 p );
+float   sphere( vec3 p, float s );
+float   smoothBox( vec3 p, vec3 s, float r );
+vec2    mandelbulb( vec3 p );
+vec2    mandelbox( vec3 p );
+float   ifs( vec3 p );
+
+void    main() {
+    float depthRange = 2.0 * object[layer].scale * object[layer].boundingSphereScale;
+    vec4 ro = invLightSpaceMat * vec4(TexCoords * 2.0 - 1.0, -1.0, 1.0);
+    vec3 rd = -normalize(lightDir);
+
+    float t = 0.0;
+    float hit = depthRange;
+    vec2 closest = vec2(depthRange);
+    for (int i = 0; i < maxRayStepsShadow; ++i) {
+        float h = mapObj(ro.xyz / ro.w + rd * t, layer).x;
+        if (h < minDistShadow) {
+            hit = t;
+            break;
+        }
+        if (h < closest.x)
+            closest = vec2(h, t);
+        t += h;
+        if (t > depthRange) break;
+    }
+    FragColor = vec4(hit, closest, 1.0);
+}
+
+vec3    mapObj( in vec3 p, int i ) {
+    vec3 pos = p;
+    vec3 res = vec3(100000., 0., i);
+
+    pos = (object[i].invMat * vec4(p, 1.0)).xyz / object[i].scale;
+    if (object[i].id == 0)
+        res.xy = mandelbox(pos);
+    else if (object[i].id == 1)
+        res.xy = mandelbulb(pos);
+    else if (object[i].id == 2)
+        res.x = ifs(pos);
+    else if (object[i].id == 5)
+        res.x = blob(pos);
+    res.x *= object[i].scale;
+    return res;
+}
+
+#include "../include/distanceEstimators.glsl"
@@ -15,14 +15,11 @@ in float Near;
 in float Far;
 
 uniform bool use_shadows;
-uniform sampler2D shadowMap;
 uniform samplerCube skybox;
-uniform sampler2D noiseSampler;
 
 uniform sDirectionalLight directionalLight;
 uniform mat4 invProjection;
 uniform mat4 invView;
-uniform mat4 lightSpaceMat;
 
 uniform float uTime;
 uniform vec3 cameraPos;
@@ -40,23 +37,13 @@ const float minDistShadow = 4./1080.;// the distance from object threshold at wh
 vec3    computeDirectionalLight( in vec3 hit, in vec3 normal, in vec3 viewDir, in vec3 m_diffuse, bool use_shadows );
 float   softShadow( in vec3 ro, in vec3 rd, float mint, float k );
 
-float   random(vec2 p) {
-    return fract(sin(mod(dot(p, vec2(12.9898,78.233)), 3.14))*43758.5453);
-}
+#include "../include/fbm.glsl"
+#include "../include/shadows.glsl"
 
 vec2    random2(vec2 p) {
     return fract(sin(vec2(dot(p,vec2(127.1,311.7)),dot(p,vec2(269.5,183.3))))*43758.5453);
 }
 
-float noise( vec3 x ) {
-    vec3 p = floor(x);
-    vec3 f = fract(x);
-    f = f*f*(3.0-2.0*f);
-    vec2 uv = (p.xy + vec2(37.0, 17.0) * p.z) + f.xy;
-    vec2 rg = texture(noiseSampler, (uv + 0.5) / 256.0, 0.0).rg;
-    return mix(rg.y, rg.x, f.z);
-}
-
 vec3    elevationMap(vec3 p, float size, float width) {
     vec3 f = abs(fract(p * size)-0.5);
     vec3 df = fwidth(p * size);
@@ -64,17 +51,6 @@ vec3    elevationMap(vec3 p, float size, float width) {
     return clamp((f-df*mi)/(df*(ma-mi)), max(0.0, 1.0-width), 1.0);
 }
 
-float   fbm2d(in vec2 st, in float amplitude, in float frequency, in int octaves, in float lacunarity, in float gain) {
-    float value = 0.0;
-    st *= frequency;
-    for (int i = 0; i < octaves; i++) {
-        value += amplitude * noise(vec3(st, 1.0));
-        st *= lacunarity;
-        amplitude *= gain;
-    }
-    return value;
-}
-
 float   voronoi2d(vec2 uv, float scale) {
     uv *= scale;
     // Tile the space
@@ -94,22 +70,6 @@ float   voronoi2d(vec2 uv, float scale) {
     return m_dist;
 }
 
-float   computeMeshShadows( vec3 hit, vec3 normal ) {
-    vec4 posLightSpace = lightSpaceMat * vec4(hit, 1.0);
-    vec3 projCoords = (posLightSpace.xyz / posLightSpace.w) * 0.5 + 0.5;
-    float bias = 0.0025;
-    /* PCF */
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    for (int x = -1; x <= 1; ++x) {
-        for (int y = -1; y <= 1; ++y) {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-            shadow += (projCoords.z - bias > pcfDepth ? 1.0 : 0.0);
-        }
-    }
-    return (projCoords.z > 1.0 ? 0.0 : shadow / 9.0);
-}
-
 float   map2(vec2 p) {
     return fbm2d(p + (0.8-fbm2d(p + uTime * 0.025, 1.0, 1.0, 6, 2.2, 0.5)*1.3), 0.3, 1.0, 5, 1., 0.5);
 }
@@ -0,0 +1,49 @@
+#version 400 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;    // linear scene color, supersampled
+uniform int factor;
+uniform ivec2 size;                 // output resolution, even
+
+/*  Writes the frame as I420 in a single channel target of size.x by size.y * 3/2 texels: read
+    back row by row it is the Y plane followed by the U and V planes, top-down. The colors are
+    sRGB encoded (the R8 target does not go through GL_FRAMEBUFFER_SRGB) and converted with the
+    BT.601 limited range matrix, what ffmpeg and OpenCV assume for untagged 4:2:0 video.
+*/
+
+vec3    linearToSRGB( vec3 c ) {
+    c = clamp(c, 0.0, 1.0);
+    return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, step(0.0031308, c));
+}
+
+/* box filter of the supersampled block under the output pixel p (y from the top of the image) */
+vec3    fetch( ivec2 p ) {
+    ivec2 origin = ivec2(p.x, size.y - 1 - p.y) * factor;
+    vec3 color = vec3(0.0);
+    for (int y = 0; y < factor; ++y)
+        for (int x = 0; x < factor; ++x)
+            color += texelFetch(screenTexture, origin + ivec2(x, y), 0).rgb;
+    return linearToSRGB(color / float(factor * factor));
+}
+
+void    main() {
+    int offset = int(gl_FragCoord.y) * size.x + int(gl_FragCoord.x);
+    int lumaSize = size.x * size.y;
+    int chromaWidth = size.x / 2;
+    int chromaSize = lumaSize / 4;
+    if (offset < lumaSize) {
+        vec3 rgb = fetch(ivec2(offset % size.x, offset / size.x));
+        FragColor = vec4(16.0 / 255.0 + dot(rgb, vec3(0.257, 0.504, 0.098)), 0.0, 0.0, 1.0);
+        return;
+    }
+    /* one chroma sample per 2x2 block, sited at its center */
+    int k = (offset - lumaSize) % chromaSize;
+    ivec2 p = ivec2(k % chromaWidth, k / chromaWidth) * 2;
+    vec3 rgb = (fetch(p) + fetch(p + ivec2(1, 0)) + fetch(p + ivec2(0, 1)) + fetch(p + ivec2(1, 1))) * 0.25;
+    if (offset - lumaSize < chromaSize)
+        FragColor = vec4(128.0 / 255.0 + dot(rgb, vec3(-0.148, -0.291, 0.439)), 0.0, 0.0, 1.0);
+    else
+        FragColor = vec4(128.0 / 255.0 + dot(rgb, vec3(0.439, -0.368, -0.071)), 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,86 @@
+/*  Distance Estimators of the raymarched objects, shared by the raymarch pass and the shadows
+    rendered from the light (the including shader declares uTime)
+*/
+
+float   sphere( vec3 p, float s ) {
+    return length(p) - s;
+}
+
+float   smoothBox( vec3 p, vec3 s, float r ) {
+    return length(max(abs(p) - s, 0.0)) - r;
+}
+
+float sminCubic( float a, float b, float k ) {
+    float h = max( k-abs(a-b), 0.0 );
+    return min( a, b ) - h*h*h/(6.0*k*k);
+}
+
+float   blob( vec3 p ) {
+    vec4 t = vec4(sin(uTime*0.8), cos(uTime*0.7), sin(uTime*1.6), cos(uTime*2.1));
+    float s1 = sphere(p + 0.42 * vec3(t.w, t.y, t.x), 1.0);
+    float s2 = sphere(p + 0.75 * vec3(t.z, t.x, t.y), 1.0);
+    float s3 = sphere(p + 0.75 * vec3(t.y, t.w, t.z), 1.0);
+    float s4 = sphere(p + 0.50 * vec3(t.x, t.z, t.w), 1.0);
+    return sminCubic(sminCubic(sminCubic(s1, s2, 0.25), s3, 0.25), s4, 0.25);
+}
+
+vec2   mandelbulb(vec3 pos) {
+	vec3 z = pos;
+	float dr = 1.0;
+	float r = 0.0;
+    float t0 = 1.0;
+	for (int i = 0; i < 4; ++i) {
+		r = length(z);
+		if (r > 1.5) break;
+		float theta = acos(z.z/r)*8.0 + uTime * 0.1;
+		float phi = atan(z.y,z.x)*8.0 + uTime * 0.05;
+        float rp = pow(r, 7.0);
+		dr =  rp*8.0*dr + 1.0;
+		float zr = rp * r;
+        float sinTheta = sin(theta);
+		z = zr*vec3(sinTheta*cos(phi), sin(phi)*sinTheta, cos(theta)) + pos;
+        t0 = min(t0, zr);
+	}
+	return vec2(0.25*log(r)*r/dr, t0);
+}
+
+/* mandelbox variables */
+const float min_radius = 0.25;
+const float scale = 2.0;
+const int iters = 10;
+const float minRadius2 = min_radius * min_radius;
+const vec4 scalevec = vec4(scale, scale, scale, abs(scale)) / minRadius2;
+const float C1 = abs(scale - 1.0), C2 = pow(abs(scale), float(1 - iters));
+
+vec2   mandelbox( vec3 p ) {
+    vec4 z = vec4(p.xyz * 6.0, 1.0), p0 = vec4(p.xyz * 6.0, 1.0);
+    float t0 = 1.0;
+    for (int i = 0; i < iters; i++) {
+        z.xyz = clamp(z.xyz, -1.0, 1.0) * 2.0 - z.xyz;  // box fold
+        float r2 = dot(z.xyz, z.xyz);
+        z.xyzw *= clamp(max(minRadius2 / r2, minRadius2), 0.0, 1.0);  // sphere fold
+        z.xyzw = z * scalevec + p0;
+        t0 = min(t0, r2);
+    }
+	return vec2(((length(z.xyz) - C1) / z.w - C2) / 6.0, t0);
+}
+
+float   ifs( vec3 p ) {
+    float ui = 100.0 * uTime * 0.1;
+    float y = -0.001 * ui;
+    mat2  m = mat2(sin(y), cos(y), -cos(y), sin(y));
+    y = 0.0035 * ui;
+    mat2  n = mat2(sin(y), cos(y), -cos(y), sin(y));
+    y = 0.0023 * ui;
+    mat2 nn = mat2(sin(y), cos(y), -cos(y), sin(y));
+
+    float t = 1.0;
+    for (int i = 0; i < 10; i++) {
+        t = t * 0.66;
+        p.xy =  m * p.xy;
+        p.yz =  n * p.yz;
+        p.zx = nn * p.zx;
+        p.xz = abs(p.xz) - t;
+    }
+    return smoothBox(p, vec3(0.975 * t), 0.1 * t);
+}
@@ -0,0 +1,24 @@
+/*  fractal brownian motion over the value noise */
+#include "noise.glsl"
+
+float   fbm2d(in vec2 st, in float amplitude, in float frequency, in int octaves, in float lacunarity, in float gain) {
+    float value = 0.0;
+    st *= frequency;
+    for (int i = 0; i < octaves; i++) {
+        value += amplitude * noise(vec3(st, 1.0));
+        st *= lacunarity;
+        amplitude *= gain;
+    }
+    return value;
+}
+
+float   fbm3d(in vec3 st, in float amplitude, in float frequency, in int octaves, in float lacunarity, in float gain) {
+    float value = 0.0;
+    st *= frequency;
+    for (int i = 0; i < octaves; i++) {
+        value += amplitude * noise(st);
+        st *= lacunarity;
+        amplitude *= gain;
+    }
+    return value;
+}
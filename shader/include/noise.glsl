@@ -0,0 +1,15 @@
+/*  value noise from the 256x256 noise texture, and a cheap hash */
+uniform sampler2D noiseSampler;
+
+float   random(vec2 p) {
+    return fract(sin(mod(dot(p, vec2(12.9898,78.233)), 3.14))*43758.5453);
+}
+
+float   noise( vec3 x ) {
+    vec3 p = floor(x);
+    vec3 f = fract(x);
+    f = f*f*(3.0-2.0*f);
+    vec2 uv = (p.xy + vec2(37.0, 17.0) * p.z) + f.xy;
+    vec2 rg = texture(noiseSampler, (uv + 0.5) / 256.0, 0.0).rg;
+    return mix(rg.y, rg.x, f.z);
+}
@@ -0,0 +1,34 @@
+/*  Shadows of the meshes, from the cascaded shadow maps (see Renderer::updateShadowCascades) */
+#define SHADOW_CASCADES 4
+
+uniform sampler2DArray shadowMap;
+uniform sampler2DArray dynamicShadowMap;    // moving models, rendered every frame
+uniform bool use_dynamic_shadows;
+uniform mat4 lightSpaceMat[SHADOW_CASCADES];
+
+float   computeMeshShadows( vec3 hit, vec3 normal ) {
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0).xy;
+    float bias = 0.0025;
+    /* use the first (finest) cascade containing the point, the PCF kernel included */
+    for (int c = 0; c < SHADOW_CASCADES; ++c) {
+        vec4 posLightSpace = lightSpaceMat[c] * vec4(hit, 1.0);
+        vec3 projCoords = (posLightSpace.xyz / posLightSpace.w) * 0.5 + 0.5;
+        if (any(lessThan(projCoords.xy, 2.0 * texelSize)) || any(greaterThan(projCoords.xy, 1.0 - 2.0 * texelSize)))
+            continue;
+        if (projCoords.z > 1.0)
+            return (0.0);
+        /* PCF */
+        float shadow = 0.0;
+        for (int x = -1; x <= 1; ++x) {
+            for (int y = -1; y <= 1; ++y) {
+                vec3 uvw = vec3(projCoords.xy + vec2(x, y) * texelSize, c);
+                float pcfDepth = texture(shadowMap, uvw).r;
+                if (use_dynamic_shadows)
+                    pcfDepth = min(pcfDepth, texture(dynamicShadowMap, uvw).r);
+                shadow += (projCoords.z - bias > pcfDepth ? 1.0 : 0.0);
+            }
+        }
+        return (shadow / 9.0);
+    }
+    return (0.0);
+}
@@ -11,12 +11,11 @@ out vec2 TexCoords;
 out vec3 Tangent;
 out vec3 Bitangent;
 
-out vec4 FragPosLightSpace;
-
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform mat4 lightSpaceMat;
+
+invariant gl_Position;
 
 void main() {
     FragPos = vec3(model * vec4(aPos, 1.0));
@@ -24,6 +23,5 @@ void main() {
     TexCoords = aTexCoords;
     Tangent = aTangent;
     Bitangent = aBitangent;
-    FragPosLightSpace = lightSpaceMat * vec4(FragPos, 1.0);
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
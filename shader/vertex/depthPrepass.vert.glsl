@@ -0,0 +1,13 @@
+#version 400 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+/* must produce bit-identical depths to default.vert.glsl for the GL_LEQUAL main pass */
+invariant gl_Position;
+
+void main() {
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,9 @@
+#version 400 core
+
+out vec2 TexCoords;
+
+/* full-screen triangle generated from the vertex id (no vertex buffer needed) */
+void main() {
+    TexCoords = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(TexCoords * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -21,13 +21,20 @@ Camera::Camera( const Camera& rhs ) {
 
 Camera& Camera::operator=( const Camera& rhs ) {
     this->projectionMatrix = rhs.getProjectionMatrix();
+    this->invProjectionMatrix = rhs.getInvProjectionMatrix();
     this->viewMatrix = rhs.getViewMatrix();
+    this->invViewMatrix = rhs.getInvViewMatrix();
     this->position = rhs.getPosition();
     this->cameraFront = rhs.getCameraFront();
     this->fov = rhs.getFov();
     this->aspect = rhs.getAspect();
     this->near = rhs.getNear();
     this->far = rhs.getFar();
+    this->pitch = rhs.getPitch();
+    this->yaw = rhs.getYaw();
+    this->speed = rhs.speed;
+    this->speedmod = rhs.speedmod;
+    this->last = rhs.last;
     return (*this);
 }
 
@@ -59,29 +66,55 @@ void    Camera::setFar( float far ) {
 }
 
 void    Camera::handleInputs( const std::array<tKey, N_KEY>& keys, const tMouse& mouse ) {
-    this->handleKeys(keys);
-    this->handleMouse(mouse);
-    this->viewMatrix = glm::lookAt(this->position, this->position + this->cameraFront, glm::vec3(0, 1, 0));
-    this->invViewMatrix = glm::inverse(this->viewMatrix);
+    this->move(Camera::getMoveAxes(keys), glm::vec2(mouse.pos - mouse.prevPos), this->getElapsedMilliseconds(this->last).count());
+    this->last = std::chrono::steady_clock::now();
+}
+
+/*  axes from getMoveAxes, look is the mouse displacement in pixels */
+void    Camera::move( const glm::vec3& axes, const glm::vec2& look, float milliseconds ) {
+    this->handleKeys(axes, milliseconds);
+    this->handleMouse(look);
+    this->updateView();
+}
+
+/*  place the camera directly (scripted camera paths), the mouse look continues from there */
+void    Camera::lookAt( const glm::vec3& position, const glm::vec3& target ) {
+    this->position = position;
+    this->cameraFront = glm::normalize(target - position);
+    this->pitch = glm::degrees(std::asin(this->cameraFront.y));
+    this->yaw = glm::degrees(std::atan2(this->cameraFront.z, this->cameraFront.x));
+    this->updateView();
     this->last = std::chrono::steady_clock::now();
 }
 
-void    Camera::handleKeys( const std::array<tKey, N_KEY>& keys ) {
-    glm::vec4    translate(
+/*  place the camera from a simulation snapshot */
+void    Camera::place( const glm::vec3& position, float pitch, float yaw ) {
+    this->position = position;
+    this->pitch = pitch;
+    this->yaw = yaw;
+    this->handleMouse(glm::vec2(0.0f));
+    this->updateView();
+}
+
+glm::vec3   Camera::getMoveAxes( const std::array<tKey, N_KEY>& keys ) {
+    return (glm::vec3(
         (float)(keys[GLFW_KEY_A].value - keys[GLFW_KEY_D].value),
         (float)(keys[GLFW_KEY_LEFT_SHIFT].value - keys[GLFW_KEY_SPACE].value),
-        (float)(keys[GLFW_KEY_W].value - keys[GLFW_KEY_S].value),
-        1.0f
-    );
+        (float)(keys[GLFW_KEY_W].value - keys[GLFW_KEY_S].value)
+    ));
+}
+
+void    Camera::handleKeys( const glm::vec3& axes, float milliseconds ) {
+    glm::vec4    translate(axes, 1.0f);
     /* translation is in the same coordinate system as view (moves in same direction) */
     translate = glm::transpose(this->viewMatrix) * glm::normalize(translate);
-    this->position = this->position - glm::vec3(translate) * this->getElapsedMilliseconds(this->last).count() * this->speed * this->speedmod;
+    this->position = this->position - glm::vec3(translate) * milliseconds * this->speed * this->speedmod;
 }
 
-void    Camera::handleMouse( const tMouse& mouse, float sensitivity ) {
-    this->pitch += (mouse.prevPos.y - mouse.pos.y) * sensitivity;
+void    Camera::handleMouse( const glm::vec2& look, float sensitivity ) {
+    this->pitch -= look.y * sensitivity;
     this->pitch = std::min(std::max(this->pitch, -89.0f), 89.0f);
-    this->yaw += (mouse.pos.x - mouse.prevPos.x) * sensitivity;
+    this->yaw += look.x * sensitivity;
     glm::vec3 front(
         std::cos(glm::radians(pitch)) * std::cos(glm::radians(yaw)),
         std::sin(glm::radians(pitch)),
@@ -90,6 +123,11 @@ void    Camera::handleMouse( const tMouse& mouse, float sensitivity ) {
     this->cameraFront = glm::normalize(front);
 }
 
+void    Camera::updateView( void ) {
+    this->viewMatrix = glm::lookAt(this->position, this->position + this->cameraFront, glm::vec3(0, 1, 0));
+    this->invViewMatrix = glm::inverse(this->viewMatrix);
+}
+
 tMilliseconds   Camera::getElapsedMilliseconds( tTimePoint last ) {
     return (std::chrono::steady_clock::now() - last);
 }
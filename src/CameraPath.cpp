@@ -0,0 +1,44 @@
+#include "CameraPath.hpp"
+
+CameraPath::CameraPath( const std::string& filename ) {
+    std::ifstream   ifs(filename);
+    std::string     line;
+    if (!ifs.is_open())
+        throw Exception::InitError("could not open camera path " + filename);
+    while (std::getline(ifs, line)) {
+        if (line.find_first_not_of(" \t") == std::string::npos || line[line.find_first_not_of(" \t")] == '#')
+            continue;
+        std::istringstream  iss(line);
+        tCameraKey          key;
+        if (!(iss >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.target.x >> key.target.y >> key.target.z))
+            throw Exception::InitError("malformed camera path key in " + filename + ": " + line);
+        if (this->keys.size() != 0 && key.time <= this->keys.back().time)
+            throw Exception::InitError("camera path keys are not sorted by time in " + filename);
+        this->keys.push_back(key);
+    }
+    if (this->keys.size() < 2)
+        throw Exception::InitError("camera path " + filename + " needs at least two keys");
+}
+
+CameraPath::~CameraPath( void ) {
+}
+
+static glm::vec3    catmullRom( const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t ) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return (0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3));
+}
+
+/*  the path is clamped to its first and last keys */
+void    CameraPath::sample( float time, glm::vec3& position, glm::vec3& target ) const {
+    size_t i = 0;
+    while (i + 2 < this->keys.size() && time > this->keys[i + 1].time)
+        i++;
+    const tCameraKey& k0 = this->keys[i > 0 ? i - 1 : i];
+    const tCameraKey& k1 = this->keys[i];
+    const tCameraKey& k2 = this->keys[i + 1];
+    const tCameraKey& k3 = this->keys[i + 2 < this->keys.size() ? i + 2 : i + 1];
+    float t = glm::clamp((time - k1.time) / (k2.time - k1.time), 0.0f, 1.0f);
+    position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+    target = catmullRom(k0.target, k1.target, k2.target, k3.target, t);
+}
@@ -0,0 +1,89 @@
+#include "CommandBuffer.hpp"
+#include "Shader.hpp"
+
+CommandBuffer::CommandBuffer( void ) {
+}
+
+CommandBuffer::~CommandBuffer( void ) {
+}
+
+void    CommandBuffer::push( eCommand type, GLenum target, GLuint object, GLuint unit, tUniformId name, size_t count, size_t data, size_t offset ) {
+    this->commands.push_back((tCommand){ type, target, object, unit, name, count, data, offset });
+}
+
+size_t  CommandBuffer::store( const void* value, size_t size ) {
+    size_t offset = this->data.size();
+    this->data.resize(offset + size);
+    std::memcpy(this->data.data() + offset, value, size);
+    return (offset);
+}
+
+void    CommandBuffer::bindTexture( GLuint unit, GLenum target, GLuint texture ) {
+    this->push(eCommand::bindTexture, target, texture, unit, 0, 0, 0, 0);
+}
+
+void    CommandBuffer::bindVertexArray( GLuint vao ) {
+    this->push(eCommand::bindVertexArray, 0, vao, 0, 0, 0, 0, 0);
+}
+
+void    CommandBuffer::drawElements( size_t count ) {
+    this->push(eCommand::drawElements, 0, 0, 0, 0, count, 0, 0);
+}
+
+void    CommandBuffer::drawArrays( size_t count ) {
+    this->push(eCommand::drawArrays, 0, 0, 0, 0, count, 0, 0);
+}
+
+void    CommandBuffer::setUniform( const tUniformName& name, int i ) {
+    this->push(eCommand::uniformInt, 0, 0, 0, name.id, 1, this->store(&i, sizeof(i)), 0);
+}
+
+void    CommandBuffer::setUniform( const tUniformName& name, float f ) {
+    this->push(eCommand::uniformFloat, 0, 0, 0, name.id, 1, this->store(&f, sizeof(f)), 0);
+}
+
+void    CommandBuffer::setUniform( const tUniformName& name, const glm::vec3& v ) {
+    this->push(eCommand::uniformVec3, 0, 0, 0, name.id, 1, this->store(&v, sizeof(v)), 0);
+}
+
+void    CommandBuffer::setUniform( const tUniformName& name, const glm::mat4& m ) {
+    this->push(eCommand::uniformMat4, 0, 0, 0, name.id, 1, this->store(&m, sizeof(m)), 0);
+}
+
+void    CommandBuffer::updateBuffer( GLenum target, GLuint buffer, size_t offset, const void* data, size_t size ) {
+    this->push(eCommand::updateBuffer, target, buffer, 0, 0, size, this->store(data, size), offset);
+}
+
+void    CommandBuffer::reset( void ) {
+    this->commands.clear();
+    this->data.clear();
+}
+
+void    CommandBuffer::dump( std::ostream& os ) const {
+    static const char* types[] = { "bindTexture", "bindVertexArray", "drawElements", "drawArrays", "uniformInt",
+                                   "uniformFloat", "uniformVec3", "uniformMat4", "updateBuffer" };
+    int     i;
+    float   f;
+    os << "> CommandBuffer: " << this->commands.size() << " commands, " << this->data.size() << " bytes" << std::endl;
+    for (size_t c = 0; c < this->commands.size(); ++c) {
+        const tCommand& command = this->commands[c];
+        os << "  " << types[static_cast<int>(command.type)];
+        switch (command.type) {
+            case eCommand::bindTexture: os << " unit " << command.unit << " texture " << command.object; break;
+            case eCommand::bindVertexArray: os << " " << command.object; break;
+            case eCommand::drawElements:
+            case eCommand::drawArrays: os << " " << command.count; break;
+            case eCommand::uniformInt:
+                std::memcpy(&i, this->getData(command.data), sizeof(i));
+                os << " " << Shader::getUniformName(command.name) << " " << i;
+                break;
+            case eCommand::uniformFloat:
+                std::memcpy(&f, this->getData(command.data), sizeof(f));
+                os << " " << Shader::getUniformName(command.name) << " " << f;
+                break;
+            case eCommand::updateBuffer: os << " buffer " << command.object << " +" << command.offset << " " << command.count << " bytes"; break;
+            default: os << " " << Shader::getUniformName(command.name); break;
+        };
+        os << std::endl;
+    }
+}
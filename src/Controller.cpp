@@ -1,80 +1,145 @@
 #include "Controller.hpp"
 
-Controller::Controller( GLFWwindow* window ) : window(window) {
+Controller::Controller( GLFWwindow* window ) : window(window), events(CONTROLLER_EVENT_QUEUE), overflow(false) {
     this->ref = std::chrono::steady_clock::now();
+    this->pressed.fill(0);
+    this->latched.fill(0);
+    this->latches.reserve(N_KEY);
+    this->mouse.button.fill(0);
     glfwSetInputMode(this->window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwGetCursorPos(this->window, &(this->mouse.pos.x), &(this->mouse.pos.y));
+    this->mouse.prevPos = this->mouse.pos;
+    glfwSetWindowUserPointer(this->window, this);
+    glfwSetKeyCallback(this->window, Controller::keyCallback);
+    glfwSetMouseButtonCallback(this->window, Controller::mouseButtonCallback);
+    glfwSetCursorPosCallback(this->window, Controller::cursorPosCallback);
 }
 
 Controller::~Controller( void ) {
+    glfwSetKeyCallback(this->window, NULL);
+    glfwSetMouseButtonCallback(this->window, NULL);
+    glfwSetCursorPosCallback(this->window, NULL);
+    glfwSetWindowUserPointer(this->window, NULL);
 }
 
-void    Controller::update( void ) {
-    this->mouseHandler();
-    this->keyHandler();
+void    Controller::keyCallback( GLFWwindow* window, int key, int scancode, int action, int mods ) {
+    Controller* controller = static_cast<Controller*>(glfwGetWindowUserPointer(window));
+    if (controller && key >= 0 && key < N_KEY && action != GLFW_REPEAT)
+        controller->push((tInputEvent){ eInputEvent::key, key, (short)(action == GLFW_PRESS), glm::dvec2(0.0) });
 }
 
-void    Controller::mouseHandler( void ) {
-    this->mouse.prevPos = this->mouse.pos;
-    glfwGetCursorPos(this->window, &(this->mouse.pos.x), &(this->mouse.pos.y));
+void    Controller::mouseButtonCallback( GLFWwindow* window, int button, int action, int mods ) {
+    Controller* controller = static_cast<Controller*>(glfwGetWindowUserPointer(window));
+    if (controller && button >= 0 && button < N_MOUSE_BUTTON)
+        controller->push((tInputEvent){ eInputEvent::button, button, (short)(action == GLFW_PRESS), glm::dvec2(0.0) });
+}
+
+void    Controller::cursorPosCallback( GLFWwindow* window, double x, double y ) {
+    Controller* controller = static_cast<Controller*>(glfwGetWindowUserPointer(window));
+    if (controller)
+        controller->push((tInputEvent){ eInputEvent::cursor, 0, 0, glm::dvec2(x, y) });
+}
+
+/*  a dropped event could leave a key stuck, the next update polls everything instead */
+void    Controller::push( const tInputEvent& event ) {
+    if (!this->events.push(event))
+        this->overflow = true;
+}
+
+void    Controller::poll( void ) {
+    for (size_t k = 0; k < N_KEY; ++k)
+        this->pressed[k] = (glfwGetKey(this->window, k) == GLFW_PRESS);
     for (size_t b = 0; b < N_MOUSE_BUTTON; ++b)
         this->mouse.button[b] = (glfwGetMouseButton(this->window, b) == GLFW_PRESS);
+    glfwGetCursorPos(this->window, &(this->mouse.pos.x), &(this->mouse.pos.y));
 }
 
-void    Controller::keyHandler( void ) {
-	if (glfwGetKey(this->window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+void    Controller::update( void ) {
+    tTimePoint  now = std::chrono::steady_clock::now();
+    tInputEvent event;
+
+    this->mouse.prevPos = this->mouse.pos;
+    /* the presses latched by the last update were seen for a frame */
+    for (size_t i = 0; i < this->latches.size(); ++i) {
+        this->latched[this->latches[i]] = 0;
+        this->keyUpdate(this->latches[i], now);
+    }
+    this->latches.clear();
+    while (this->events.pop(event)) {
+        if (event.type == eInputEvent::cursor)
+            this->mouse.pos = event.pos;
+        else if (event.type == eInputEvent::button)
+            this->mouse.button[event.code] = event.pressed;
+        else {
+            this->pressed[event.code] = event.pressed;
+            if (event.pressed && this->key[event.code].type == eKeyMode::press && !this->latched[event.code]) {
+                this->latched[event.code] = 1;
+                this->latches.push_back(event.code);
+            }
+            this->keyUpdate(event.code, now);
+        }
+    }
+    if (this->overflow) {
+        this->overflow = false;
+        this->poll();
+        for (size_t k = 0; k < N_KEY; ++k)
+            this->keyUpdate(k, now);
+    }
+    /* the modes change the value over time, even without any event */
+    for (size_t i = 0; i < this->modal.size(); ++i)
+        this->keyUpdate(this->modal[i], now);
+	if (this->pressed[GLFW_KEY_ESCAPE])
 		glfwSetWindowShouldClose(this->window, GL_TRUE);
-    for (size_t k = 0; k < N_KEY; ++k)
-        this->keyUpdate(k);
 }
 
-void	Controller::keyUpdate( int k ) {
-    const short value = (glfwGetKey(this->window, k) == GLFW_PRESS);
+void	Controller::keyUpdate( int k, tTimePoint now ) {
+    const short value = this->pressed[k];
 
     switch (this->key[k].type) {
-        case eKeyMode::toggle: this->keyToggle(k, value); break;
-        case eKeyMode::cooldown: this->keyCooldown(k, value); break;
-        case eKeyMode::instant: this->keyInstant(k, value); break;
-        case eKeyMode::cycle: this->keyCycle(k, value); break;
-        default: this->key[k].value = value; break;
+        case eKeyMode::toggle: this->keyToggle(k, value, now); break;
+        case eKeyMode::cooldown: this->keyCooldown(k, value, now); break;
+        case eKeyMode::instant: this->keyInstant(k, value, now); break;
+        case eKeyMode::cycle: this->keyCycle(k, value, now); break;
+        default: this->key[k].value = (value || this->latched[k]); break;
     };
 }
 
-void    Controller::keyToggle( int k, short value ) {
-    if (value && getElapsedMilliseconds(this->key[k].last).count() > this->key[k].cooldown) {
+void    Controller::keyToggle( int k, short value, tTimePoint now ) {
+    if (value && tMilliseconds(now - this->key[k].last).count() > this->key[k].cooldown) {
         this->key[k].value = ~(this->key[k].value) & 0x1;
-        this->key[k].last = std::chrono::steady_clock::now();
-        this->key[k].stamp = std::chrono::steady_clock::now();
+        this->key[k].last = now;
+        this->key[k].stamp = now;
     }
     /* so that when we unpress the key we can switch immediatly */
     if (!value)
         this->key[k].last = this->ref;
 }
 
-void    Controller::keyCooldown( int k, short value ) {
+void    Controller::keyCooldown( int k, short value, tTimePoint now ) {
     if (value && !this->key[k].value) {
         this->key[k].value = 1;
-        this->key[k].last = std::chrono::steady_clock::now();
-        this->key[k].stamp = std::chrono::steady_clock::now();
+        this->key[k].last = now;
+        this->key[k].stamp = now;
     }
-    if (getElapsedMilliseconds(this->key[k].last).count() > this->key[k].cooldown)
+    if (tMilliseconds(now - this->key[k].last).count() > this->key[k].cooldown)
         this->key[k].value = 0;
 }
 
-void    Controller::keyInstant( int k, short value ) {
-    if (this->key[k].value && getElapsedMilliseconds(this->key[k].last).count() <= this->key[k].cooldown)
+void    Controller::keyInstant( int k, short value, tTimePoint now ) {
+    if (this->key[k].value && tMilliseconds(now - this->key[k].last).count() <= this->key[k].cooldown)
         this->key[k].value = 0;
-    if (value && !this->key[k].value && getElapsedMilliseconds(this->key[k].last).count() > this->key[k].cooldown) {
+    if (value && !this->key[k].value && tMilliseconds(now - this->key[k].last).count() > this->key[k].cooldown) {
         this->key[k].value = 1;
-        this->key[k].last = std::chrono::steady_clock::now();
-        this->key[k].stamp = std::chrono::steady_clock::now();
+        this->key[k].last = now;
+        this->key[k].stamp = now;
     }
 }
 
-void    Controller::keyCycle( int k, short value ) {
-    if (value && getElapsedMilliseconds(this->key[k].last).count() > this->key[k].cooldown) {
+void    Controller::keyCycle( int k, short value, tTimePoint now ) {
+    if (value && tMilliseconds(now - this->key[k].last).count() > this->key[k].cooldown) {
         this->key[k].value = (this->key[k].value + 1 >= this->key[k].cycles ? 0 : this->key[k].value + 1);
-        this->key[k].last = std::chrono::steady_clock::now();
-        this->key[k].stamp = std::chrono::steady_clock::now();
+        this->key[k].last = now;
+        this->key[k].stamp = now;
     }
     if (!value)
         this->key[k].last = this->ref;
@@ -85,8 +150,6 @@ void    Controller::setKeyProperties( int k, eKeyMode type, short sval, uint coo
     this->key[k].type = type;
     this->key[k].cooldown = cooldown;
     this->key[k].cycles = cycles;
-}
-
-tMilliseconds   Controller::getElapsedMilliseconds( tTimePoint prev ) {
-    return (std::chrono::steady_clock::now() - prev);
+    if (type != eKeyMode::press && std::find(this->modal.begin(), this->modal.end(), k) == this->modal.end())
+        this->modal.push_back(k);
 }
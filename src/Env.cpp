@@ -5,7 +5,17 @@
     https://sketchfab.com/models/5cfc211a49164bf2835a121b5069ee08
 */
 
-Env::Env( void ) {
+/*  A scene that fails to load throws out of the constructor, the destructor does not run then so
+    what was created so far is released here before the error reaches main.
+*/
+Env::Env( const std::string& scene ) {
+    this->window.ptr = nullptr;
+    this->controller = nullptr;
+    this->skyboxTexture = 0;
+    this->noiseTexture = 0;
+    this->skybox = nullptr;
+    this->raymarched = nullptr;
+    this->world = nullptr;
     try {
         this->initGlfwEnvironment("4.0");
         this->initGlfwWindow(720, 480); /* 1280x720 */
@@ -15,196 +25,22 @@ Env::Env( void ) {
         if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
             throw Exception::InitError("glad initialization failed");
         this->controller = new Controller(this->window.ptr);
-
-        this->skyboxTexture = loadCubemap(std::vector<std::string>{{
-            "./resource/CloudyLightRays/CloudyLightRaysLeft2048.png",
-            "./resource/CloudyLightRays/CloudyLightRaysRight2048.png",
-            "./resource/CloudyLightRays/CloudyLightRaysUp2048.png",
-            "./resource/CloudyLightRays/CloudyLightRaysDown2048.png",
-            "./resource/CloudyLightRays/CloudyLightRaysFront2048.png",
-            "./resource/CloudyLightRays/CloudyLightRaysBack2048.png",
-        }});
-        this->noiseTexture = loadTexture("./resource/RGBAnoiseMedium.png");
-
-        this->models.push_back( new Model(
-            "./resource/models/Inn/theInn.FBX.obj",
-            glm::vec3(0.0f, 2.0f, 0.0f),
-            glm::vec3(0.0f),
-            glm::vec3(75.0f)
-        ));
-        this->models.push_back( new Model( /* stand emplacement 1 - Marble */
-            "./resource/models/Crystal/crystal.obj",
-            glm::vec3(10.0f, -0.75f, 14.f),
-            glm::vec3(0.0f),
-            glm::vec3(2.5f)
-        ));
-        this->models.push_back( new Model( /* stand emplacement 2 - IFS */
-            this->models[1]->getMeshes(),
-            this->models[1]->getTextures(),
-            glm::vec3(11.3f, 1.15f, -17.65f),
-            glm::vec3(0.0f, 1.0f, 0.0f),
-            glm::vec3(3.0f)
-        ));
-        this->models.push_back( new Model( /* stand emplacement 3 - Mandelbulb */
-            this->models[1]->getMeshes(),
-            this->models[1]->getTextures(),
-            glm::vec3(-15.f, -1.5f, 3.1f),
-            glm::vec3(0.0f, 0.5f, 0.0f),
-            glm::vec3(2.5f)
-        ));
-        this->models.push_back( new Model( /* stand emplacement 4 - Cloud */
-            this->models[1]->getMeshes(),
-            this->models[1]->getTextures(),
-            glm::vec3(-27.6f, 3.53f, -22.55f),
-            glm::vec3(0.0f, 2.5f, 0.0f),
-            glm::vec3(2.5f)
-        ));
-        this->models.push_back( new Model( /* stand emplacement 5 - Mandelbox */
-            this->models[1]->getMeshes(),
-            this->models[1]->getTextures(),
-            glm::vec3(-27.6f, -2.75f, 12.5f),
-            glm::vec3(0.0f, 2.0f, 0.0f),
-            glm::vec3(2.5f, 2.0f, 2.5f)
-        ));
-        this->models.push_back( new Model( /* stand emplacement 6 - Blob */
-            this->models[1]->getMeshes(),
-            this->models[1]->getTextures(),
-            glm::vec3(-11.9f, -2.75f, 27.4f),
-            glm::vec3(0.0f, -0.4f, 0.0f),
-            glm::vec3(2.f)
-        ));
-        this->models.push_back( new Model( /* quad for raymarched surface (to compute shadowMap correclty) */
-            glm::vec3(17.01f, 0.58f, 28.75f),
-            glm::vec3(0.0f, 3.1415926536f * 0.5f, 0.0f),
-            glm::vec3(4.3f, 11.5f, 0.0f)
-        ));
-
-        this->raymarched = new Raymarched({
-            (tObject){
-                eRaymarchObject::marble,
-                glm::vec3(10.0f, 2.5f, 14.f),
-                glm::vec3(0.0),
-                1.0, // scale
-                1.0, // bs scale
-                1.0, // speed modifier
-                (tMaterial){ glm::vec3(0.0), glm::vec3(1.0), glm::vec3(1.0), 2048.0, 1.0 }
-            },
-            (tObject){
-                eRaymarchObject::cloud,
-                glm::vec3(-27.6f, 7.73f, -22.55f),
-                glm::vec3(0.0),
-                2.0,
-                1.0,
-                1.0,
-                (tMaterial){ glm::vec3(0.0), glm::vec3(1.0), glm::vec3(0.0), 1.0, 1.0 }
-            },
-            (tObject){
-                eRaymarchObject::ifs,
-                glm::vec3(11.3f, 5.0f, -17.65f),
-                glm::vec3(0.0),
-                0.5,
-                3.0,
-                0.03,
-                (tMaterial){
-                    glm::vec3(0),
-                    glm::vec3(1.0),
-                    glm::vec3(0.35),
-                    128.0,
-                    1.0
-                }
-            },
-            (tObject){
-                eRaymarchObject::mandelbox,
-                glm::vec3(-27.6f, 0.f, 12.5f),
-                glm::vec3(0.0),
-                0.5,
-                2.0,
-                0.015,
-                (tMaterial){
-                    glm::vec3(0.0),
-                    glm::vec3(0.0),
-                    glm::vec3(1., 0.659, 0.537),
-                    256.0,
-                    1.0
-                }
-            },
-            (tObject){
-                eRaymarchObject::mandelbulb,
-                glm::vec3(-15.f, 2.0f, 3.1f),
-                glm::vec3(0.0),
-                1.0,
-                1.15,
-                0.1,
-                (tMaterial){
-                    glm::vec3(0.0),
-                    glm::vec3(0.0),
-                    glm::vec3(0.35, 0.35, 0.35),
-                    82.0,
-                    1.0
-                }
-            },
-            (tObject){
-                eRaymarchObject::blob,
-                glm::vec3(-11.9f, 0.f, 27.4f),
-                glm::vec3(0.0),
-                0.5,
-                2.5,
-                1.0,
-                (tMaterial){
-                    glm::vec3(0.0),
-                    glm::vec3(1.0),
-                    glm::vec3(2.0f),
-                    1024.0,
-                    1.0
-                }
-            }
-        });
-        this->raymarchedSurfaces.push_back( new RaymarchedSurface(
-            glm::vec3(17.0f, 0.58f, 28.75f),
-            glm::vec3(0.0f, 3.1415926536f * 0.5f, 0.0f),
-            glm::vec3(4.3f, 11.5f, 0.0f),
-            this->skyboxTexture,
-            this->noiseTexture
-        ));
-        this->raymarchedSurfaces.push_back( new RaymarchedSurface(
-            glm::vec3(16.8f, 5.85f, -18.215f),
-            glm::vec3(0.0f, 3.1415926536f * 0.5f, 0.0f),
-            glm::vec3(2.825f, 3.45f, 0.0f),
-            this->skyboxTexture,
-            this->noiseTexture
-        ));
-        this->texturedSurfaces.push_back( new RaymarchedSurface(
-            glm::vec3(16.88f, 4.8f, -6.015f),
-            glm::vec3(0.0f, 3.1415926536f * 0.5f, 0.0f),
-            glm::vec3(10.f, 13.f, 0.0f),
-            this->skyboxTexture,
-            this->noiseTexture
-        ));
-        this->lights = {
-            new Light(
-                glm::vec3(30, 30, 18),
-                glm::vec3(0.77f, 0.88f, 1.0f) * 0.075f,
-                glm::vec3(1.0f, 0.964f, 0.77f),
-                glm::vec3(1.0f, 1.0f, 1.0f),
-                eLightType::directional
-            )
-        };
-        this->skybox = new Model(std::vector<std::string>{{
-            "./resource/ThickCloudsWater/ThickCloudsWaterLeft2048.png",
-            "./resource/ThickCloudsWater/ThickCloudsWaterRight2048.png",
-            "./resource/ThickCloudsWater/ThickCloudsWaterUp2048.png",
-            "./resource/ThickCloudsWater/ThickCloudsWaterDown2048.png",
-            "./resource/ThickCloudsWater/ThickCloudsWaterFront2048.png",
-            "./resource/ThickCloudsWater/ThickCloudsWaterBack2048.png",
-        }});
+        this->world = new World(this);
+        this->loadScene(scene);
 
         this->setupController();
-    } catch (const std::exception& err) {
-        std::cout << err.what() << std::endl;
+    } catch (...) {
+        this->release();
+        throw;
     }
 }
 
 Env::~Env( void ) {
+    this->release();
+}
+
+void    Env::release( void ) {
+    delete this->world;
     for (size_t i = 0; i < this->models.size(); ++i)
         delete this->models[i];
     for (size_t i = 0; i < this->lights.size(); ++i)
@@ -212,11 +48,12 @@ Env::~Env( void ) {
     delete this->skybox;
     delete this->controller;
     delete this->raymarched;
-    if (glIsTexture(this->skyboxTexture))
-        glDeleteTextures(1, &this->skyboxTexture);
-    if (glIsTexture(this->noiseTexture))
-        glDeleteTextures(1, &this->noiseTexture);
-    glfwDestroyWindow(this->window.ptr);
+    if (this->skyboxTexture)
+        GlState::deleteTextures(1, &this->skyboxTexture);
+    if (this->noiseTexture)
+        GlState::deleteTextures(1, &this->noiseTexture);
+    if (this->window.ptr)
+        glfwDestroyWindow(this->window.ptr);
     glfwTerminate();
 }
 
@@ -242,8 +79,53 @@ void	Env::initGlfwWindow( size_t width, size_t height ) {
     glfwGetFramebufferSize(this->window.ptr, &this->window.width, &this->window.height);
 }
 
+/*  The global entries (cubemaps, noise, lights) are loaded as the file is read (see Scene), the
+    models, surfaces and raymarched objects are handed to the World which streams them in around
+    the camera. The surfaces reflect the environment cubemap, so it and the noise come first.
+*/
+void    Env::loadScene( const std::string& filename ) {
+    Scene                           scene(filename);
+    tSceneEntry                     entry;
+    std::unordered_set<std::string> names;
+    size_t                          counts[10] = { 0 };
+
+    while (scene.next(entry)) {
+        counts[static_cast<int>(entry.type)]++;
+        if (entry.type == eSceneEntry::environment)
+            this->skyboxTexture = loadCubemap(entry.paths);
+        else if (entry.type == eSceneEntry::skybox)
+            this->skybox = new Model(entry.paths);
+        else if (entry.type == eSceneEntry::noise)
+            this->noiseTexture = loadTexture(entry.paths[0].c_str());
+        else if (entry.type == eSceneEntry::light && entry.lightType == eLightType::point)
+            this->lights.push_back( new Light(entry.position, entry.ambient, entry.diffuse, entry.specular, entry.attenuation.x, entry.attenuation.y, entry.attenuation.z, eLightType::point) );
+        else if (entry.type == eSceneEntry::light)
+            this->lights.push_back( new Light(entry.position, entry.ambient, entry.diffuse, entry.specular, eLightType::directional) );
+        else {
+            if (entry.type == eSceneEntry::model)
+                names.insert(entry.name);
+            if (entry.type == eSceneEntry::instance && names.find(entry.name) == names.end())
+                throw Exception::InitError(filename + ":" + std::to_string(entry.line) + ": instance of unknown model " + entry.name);
+            if ((entry.type == eSceneEntry::surface || entry.type == eSceneEntry::texturedSurface) && (!this->skyboxTexture || !this->noiseTexture))
+                throw Exception::InitError(filename + ":" + std::to_string(entry.line) + ": surface before the environment and noise textures");
+            this->world->add(entry);
+        }
+    }
+    if (!this->skybox)
+        throw Exception::InitError("scene " + filename + " has no skybox");
+    if (this->world->hasRaymarched())
+        this->raymarched = new Raymarched(std::vector<tObject>());
+    std::cout << "scene: " << counts[static_cast<int>(eSceneEntry::model)] + counts[static_cast<int>(eSceneEntry::instance)] + counts[static_cast<int>(eSceneEntry::billboard)]
+              << " models (" << counts[static_cast<int>(eSceneEntry::instance)] << " instances), " << counts[static_cast<int>(eSceneEntry::raymarched)] << " raymarched objects, "
+              << counts[static_cast<int>(eSceneEntry::surface)] + counts[static_cast<int>(eSceneEntry::texturedSurface)] << " surfaces, " << this->lights.size() << " lights" << std::endl;
+}
+
 void    Env::setupController( void ) {
     this->controller->setKeyProperties(GLFW_KEY_P, eKeyMode::toggle, 1, 1000);
+    this->controller->setKeyProperties(GLFW_KEY_V, eKeyMode::cycle, 0, 250, 3);    /* vsync off, on, adaptive */
+    this->controller->setKeyProperties(GLFW_KEY_L, eKeyMode::toggle, 0, 250);      /* low latency pacing */
+    this->controller->setKeyProperties(GLFW_KEY_I, eKeyMode::instant, 0, 250);     /* pick the object in the center of the view */
+    this->controller->setKeyProperties(GLFW_KEY_G, eKeyMode::instant, 0, 250);     /* print the schedule of the frame graph */
 }
 
 void    Env::framebufferSizeCallback( GLFWwindow* window, int width, int height ) {
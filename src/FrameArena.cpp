@@ -0,0 +1,46 @@
+#include "FrameArena.hpp"
+
+char*               FrameArena::block = nullptr;
+size_t              FrameArena::capacity = 0;
+size_t              FrameArena::offset = 0;
+size_t              FrameArena::used = 0;
+size_t              FrameArena::spilledBytes = 0;
+std::vector<void*>  FrameArena::spilled;
+
+void*   FrameArena::allocate( size_t size, size_t alignment ) {
+    if (!FrameArena::block) {
+        FrameArena::block = static_cast<char*>(::operator new(FRAME_ARENA_SIZE));
+        FrameArena::capacity = FRAME_ARENA_SIZE;
+    }
+    size_t start = (FrameArena::offset + alignment - 1) & ~(alignment - 1);
+    if (start + size <= FrameArena::capacity) {
+        FrameArena::offset = start + size;
+        return (FrameArena::block + start);
+    }
+    /* full, the heap until the reset, with room to align the start like in the block */
+    FrameArena::spilledBytes += size + alignment;
+    FrameArena::spilled.push_back(::operator new(size + alignment - 1));
+    uintptr_t address = reinterpret_cast<uintptr_t>(FrameArena::spilled.back());
+    return (reinterpret_cast<void*>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)));
+}
+
+/*  nothing allocated in the frame may be used after this */
+void    FrameArena::reset( void ) {
+    size_t needed = FrameArena::offset + FrameArena::spilledBytes;
+    for (size_t i = 0; i < FrameArena::spilled.size(); ++i)
+        ::operator delete(FrameArena::spilled[i]);
+    FrameArena::spilled.clear();
+    if (needed > FrameArena::capacity) {
+        while (FrameArena::capacity < needed)
+            FrameArena::capacity *= 2;
+        ::operator delete(FrameArena::block);
+        FrameArena::block = static_cast<char*>(::operator new(FrameArena::capacity));
+    }
+    FrameArena::used = needed;
+    FrameArena::offset = 0;
+    FrameArena::spilledBytes = 0;
+}
+
+void    FrameArena::print( std::ostream& os ) {
+    os << "frame arena: " << FrameArena::used / 1024 << "/" << FrameArena::capacity / 1024 << " KB" << std::endl;
+}
@@ -0,0 +1,414 @@
+#include "FrameGraph.hpp"
+#include <algorithm>
+#include <climits>
+#include <sstream>
+
+FrameGraph::FrameGraph( void ) : compiled(false), currentStep(0), gpuTimer(nullptr) {
+}
+
+FrameGraph::~FrameGraph( void ) {
+    for (auto it = this->fbos.begin(); it != this->fbos.end(); it++)
+        GlState::deleteFramebuffers(1, &it->second);
+    for (auto it = this->textures.begin(); it != this->textures.end(); it++)
+        GlState::deleteTextures(1, &it->second);
+}
+
+/*  returns the handle of the resource, for getTexture and attachLayer */
+size_t  FrameGraph::addResource( const std::string& name, const tFrameResourceDesc& desc ) {
+    if (this->resourceIndex.find(name) != this->resourceIndex.end())
+        throw Exception::RuntimeError("FrameGraph resource declared twice: " + name);
+    tFrameResource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = false;
+    resource.fbo = 0;
+    resource.slot = -1;
+    resource.firstUse = -1;
+    resource.lastUse = -1;
+    this->resourceIndex[name] = this->resources.size();
+    this->resources.push_back(resource);
+    this->compiled = false;
+    return (this->resources.size() - 1);
+}
+
+/*  imported resources are framebuffers owned by someone else (the window), they are never
+    cleared nor aliased, and a pass writing one is always kept alive.
+*/
+size_t  FrameGraph::importResource( const std::string& name, GLuint fbo, size_t width, size_t height ) {
+    size_t resource = this->addResource(name, (tFrameResourceDesc){ width, height, 1, GL_NONE, false });
+    this->resources[resource].imported = true;
+    this->resources[resource].fbo = fbo;
+    return (resource);
+}
+
+/*  returns the handle of the pass, for setEnabled and isCulled */
+size_t  FrameGraph::addPass( const tFramePass& pass ) {
+    for (size_t i = 0; i < pass.reads.size(); ++i) {
+        this->getResourceIndex(pass.reads[i]);
+        if (std::find(pass.writes.begin(), pass.writes.end(), pass.reads[i]) != pass.writes.end())
+            throw Exception::RuntimeError("FrameGraph pass " + pass.name + " reads and writes " + pass.reads[i]);
+    }
+    for (size_t i = 0; i < pass.writes.size(); ++i)
+        if (this->resources[this->getResourceIndex(pass.writes[i])].imported && pass.writes.size() > 1)
+            throw Exception::RuntimeError("FrameGraph pass " + pass.name + " mixes an imported target with others");
+    this->passes.push_back(pass);
+    this->enabled.push_back(true);
+    this->compiled = false;
+    return (this->passes.size() - 1);
+}
+
+void    FrameGraph::setEnabled( size_t pass, bool enabled ) {
+    if (this->enabled[pass] == enabled)
+        return;
+    this->enabled[pass] = enabled;
+    this->compiled = false;
+}
+
+size_t  FrameGraph::getResourceIndex( const std::string& name ) const {
+    auto it = this->resourceIndex.find(name);
+    if (it == this->resourceIndex.end())
+        throw Exception::RuntimeError("FrameGraph unknown resource: " + name);
+    return (it->second);
+}
+
+void    FrameGraph::compile( void ) {
+    this->cullPasses();
+    this->computeLifetimes();
+    this->aliasResources();
+    this->buildSteps();
+    this->compiled = true;
+}
+
+/*  walk the passes backward from the imported targets. Writes are considered read-modify-write
+    (depth testing and blending depend on what was there before), so a pass stays alive as long
+    as a later alive pass touches one of its outputs.
+*/
+void    FrameGraph::cullPasses( void ) {
+    std::vector<bool> needed(this->resources.size(), false);
+    this->alive.assign(this->passes.size(), false);
+    for (size_t i = this->passes.size(); i-- > 0; ) {
+        if (!this->enabled[i])
+            continue;
+        const tFramePass& pass = this->passes[i];
+        bool keep = false;
+        for (size_t w = 0; w < pass.writes.size(); ++w) {
+            size_t r = this->getResourceIndex(pass.writes[w]);
+            keep = keep || this->resources[r].imported || needed[r];
+        }
+        if (!keep)
+            continue;
+        this->alive[i] = true;
+        for (size_t w = 0; w < pass.reads.size(); ++w)
+            needed[this->getResourceIndex(pass.reads[w])] = true;
+        for (size_t w = 0; w < pass.writes.size(); ++w)
+            needed[this->getResourceIndex(pass.writes[w])] = true;
+    }
+}
+
+void    FrameGraph::computeLifetimes( void ) {
+    for (size_t r = 0; r < this->resources.size(); ++r) {
+        this->resources[r].firstUse = -1;
+        this->resources[r].lastUse = -1;
+    }
+    for (size_t i = 0; i < this->passes.size(); ++i) {
+        if (!this->alive[i])
+            continue;
+        std::vector<std::string> used(this->passes[i].reads);
+        used.insert(used.end(), this->passes[i].writes.begin(), this->passes[i].writes.end());
+        for (size_t u = 0; u < used.size(); ++u) {
+            tFrameResource& resource = this->resources[this->getResourceIndex(used[u])];
+            if (resource.firstUse == -1)
+                resource.firstUse = i;
+            resource.lastUse = i;
+        }
+    }
+}
+
+static std::string  descKey( const tFrameResourceDesc& desc ) {
+    std::stringstream ss;
+    ss << std::hex << desc.internalFormat << std::dec << "_" << desc.width << "x" << desc.height << "x" << desc.layers;
+    return (ss.str());
+}
+
+/*  greedy assignment of the resources to physical textures: a transient resource reuses the
+    texture of another transient resource with the same description whose lifetime ended.
+    The slot keys are deterministic so the textures survive a recompilation.
+*/
+void    FrameGraph::aliasResources( void ) {
+    std::vector<size_t> order;
+    std::vector<int>    slotLastUse;
+    for (size_t r = 0; r < this->resources.size(); ++r)
+        order.push_back(r);
+    std::stable_sort(order.begin(), order.end(), [this]( size_t a, size_t b ) {
+        return (this->resources[a].firstUse < this->resources[b].firstUse);
+    });
+    this->slots.clear();
+    for (size_t o = 0; o < order.size(); ++o) {
+        tFrameResource& resource = this->resources[order[o]];
+        resource.slot = -1;
+        if (resource.imported || resource.firstUse == -1)
+            continue;
+        if (!resource.desc.transient) {
+            resource.slot = this->slots.size();
+            this->slots.push_back((tFrameSlot){ "persistent:" + resource.name, resource.desc });
+            slotLastUse.push_back(INT_MAX);
+            continue;
+        }
+        std::string key = descKey(resource.desc);
+        size_t      sameDesc = 0;
+        for (size_t s = 0; s < this->slots.size() && resource.slot == -1; ++s) {
+            if (this->slots[s].key.compare(0, key.size() + 1, key + "#") != 0)
+                continue;
+            sameDesc++;
+            if (slotLastUse[s] < resource.firstUse) {
+                resource.slot = s;
+                slotLastUse[s] = resource.lastUse;
+            }
+        }
+        if (resource.slot == -1) {
+            resource.slot = this->slots.size();
+            this->slots.push_back((tFrameSlot){ key + "#" + std::to_string(sameDesc), resource.desc });
+            slotLastUse.push_back(resource.lastUse);
+        }
+    }
+}
+
+/*  Only the first read of a resource after it was written needs a barrier. With OpenGL the
+    framebuffer rebind between the two passes already orders the texture fetches after the
+    writes, so they are only recorded (and dumped), no command is issued for them.
+*/
+void    FrameGraph::buildSteps( void ) {
+    std::vector<bool> written(this->resources.size(), false);
+    std::vector<bool> dirty(this->resources.size(), false);
+    this->steps.clear();
+    for (size_t i = 0; i < this->passes.size(); ++i) {
+        if (!this->alive[i])
+            continue;
+        const tFramePass& pass = this->passes[i];
+        tFrameStep step;
+        step.pass = i;
+        step.fbo = 0;
+        step.width = 0;
+        step.height = 0;
+        for (size_t u = 0; u < pass.reads.size(); ++u) {
+            size_t r = this->getResourceIndex(pass.reads[u]);
+            if (dirty[r]) {
+                step.barriers.push_back(r);
+                dirty[r] = false;
+            }
+        }
+        for (size_t u = 0; u < pass.writes.size(); ++u) {
+            size_t r = this->getResourceIndex(pass.writes[u]);
+            step.writes.push_back(r);
+            if (!written[r] && this->resources[r].desc.transient)
+                step.clears.push_back(r);
+            written[r] = true;
+            dirty[r] = true;
+            if (step.width == 0) {
+                step.width = this->resources[r].desc.width;
+                step.height = this->resources[r].desc.height;
+            }
+        }
+        this->steps.push_back(step);
+    }
+}
+
+/*  create the textures and framebuffers needed by the compiled schedule (kept across compilations) */
+void    FrameGraph::realize( void ) {
+    for (size_t s = 0; s < this->slots.size(); ++s)
+        if (this->textures.find(this->slots[s].key) == this->textures.end())
+            this->textures[this->slots[s].key] = this->createTexture(this->slots[s].desc);
+    for (size_t i = 0; i < this->steps.size(); ++i)
+        this->steps[i].fbo = this->createFramebuffer(this->steps[i]);
+}
+
+GLuint  FrameGraph::createTexture( const tFrameResourceDesc& desc ) {
+    GLuint  id;
+    bool    depth = isDepthFormat(desc.internalFormat);
+    GLenum  target = (desc.layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D);
+    GLenum  format = (depth ? GL_DEPTH_COMPONENT : GL_RGBA);
+    glGenTextures(1, &id);
+    GlState::bindTexture(0, target, id);
+    if (desc.layers > 1)
+        glTexImage3D(target, 0, desc.internalFormat, desc.width, desc.height, desc.layers, 0, format, GL_FLOAT, NULL);
+    else
+        glTexImage2D(target, 0, desc.internalFormat, desc.width, desc.height, 0, format, GL_FLOAT, NULL);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    if (depth) {
+        /* sampling outside of a depth texture returns the far plane */
+        float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, borderColor);
+    }
+    else {
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    GlState::bindTexture(0, target, 0);
+    return (id);
+}
+
+/*  layered resources are attached whole (a clear then covers every layer), a single layer is
+    attached with attachLayer() by the pass rendering it.
+*/
+void    FrameGraph::attach( const tFrameResource& resource, GLenum attachment, int layer ) {
+    GLuint texture = this->textures[this->slots[resource.slot].key];
+    if (resource.desc.layers <= 1)
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+    else if (layer < 0)
+        glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture, 0);
+    else
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, texture, 0, layer);
+}
+
+/*  to be called from the execute function of the pass writing the resource */
+void    FrameGraph::attachLayer( size_t resource, size_t layer ) {
+    const tFrameStep&   step = this->steps[this->currentStep];
+    size_t              color = 0;
+    for (size_t u = 0; u < step.writes.size(); ++u) {
+        size_t r = step.writes[u];
+        bool depth = isDepthFormat(this->resources[r].desc.internalFormat);
+        if (r == resource)
+            return (this->attach(this->resources[r], (depth ? GL_DEPTH_ATTACHMENT : GL_COLOR_ATTACHMENT0 + color), layer));
+        color += (depth ? 0 : 1);
+    }
+    throw Exception::RuntimeError("FrameGraph pass " + this->passes[step.pass].name + " does not write " + this->resources[resource].name);
+}
+
+/*  one framebuffer per distinct set of attachments. A pass sampling a texture never has it
+    attached, so there is no feedback loop (e.g. the raymarch pass reads the scene depth while
+    writing the scene color).
+*/
+GLuint  FrameGraph::createFramebuffer( const tFrameStep& step ) {
+    const tFramePass&   pass = this->passes[step.pass];
+    std::string         key;
+    for (size_t u = 0; u < step.writes.size(); ++u) {
+        const tFrameResource& resource = this->resources[step.writes[u]];
+        if (resource.imported)
+            return (resource.fbo);
+        key += std::to_string(this->textures[this->slots[resource.slot].key]) + ";";
+    }
+    if (this->fbos.find(key) != this->fbos.end())
+        return (this->fbos[key]);
+
+    GLuint              fbo;
+    std::vector<GLenum> drawBuffers;
+    glGenFramebuffers(1, &fbo);
+    GlState::bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    for (size_t u = 0; u < step.writes.size(); ++u) {
+        const tFrameResource& resource = this->resources[step.writes[u]];
+        if (isDepthFormat(resource.desc.internalFormat))
+            this->attach(resource, GL_DEPTH_ATTACHMENT, -1);
+        else {
+            this->attach(resource, GL_COLOR_ATTACHMENT0 + drawBuffers.size(), -1);
+            drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + drawBuffers.size());
+        }
+    }
+    if (drawBuffers.size() == 0) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else
+        glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        throw Exception::RuntimeError("FrameGraph framebuffer of pass " + pass.name + " is incomplete");
+    GlState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+    this->fbos[key] = fbo;
+    return (fbo);
+}
+
+/*  the schedule is recompiled only when a pass was enabled or disabled (e.g. toggling the shadows).
+    Clears go through glClearBuffer, which honors the depth and color write masks.
+*/
+void    FrameGraph::execute( void ) {
+    if (!this->compiled) {
+        this->compile();
+        this->realize();
+    }
+    const GLfloat clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    const GLfloat clearDepth = 1.0f;
+    for (size_t i = 0; i < this->steps.size(); ++i) {
+        const tFrameStep& step = this->steps[i];
+        const tFramePass& pass = this->passes[step.pass];
+        this->currentStep = i;
+        GlState::bindFramebuffer(GL_FRAMEBUFFER, step.fbo);
+        glViewport(0, 0, step.width, step.height);
+        GLint colorIndex = 0;
+        for (size_t u = 0; u < step.writes.size(); ++u) {
+            size_t r = step.writes[u];
+            bool   depth = isDepthFormat(this->resources[r].desc.internalFormat);
+            /* the pass may have left a single layer attached last frame */
+            if (this->resources[r].desc.layers > 1)
+                this->attach(this->resources[r], (depth ? GL_DEPTH_ATTACHMENT : GL_COLOR_ATTACHMENT0 + colorIndex), -1);
+            if (std::find(step.clears.begin(), step.clears.end(), r) != step.clears.end()) {
+                if (depth)
+                    glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+                else
+                    glClearBufferfv(GL_COLOR, colorIndex, clearColor);
+            }
+            colorIndex += (depth ? 0 : 1);
+        }
+        if (this->gpuTimer)
+            this->gpuTimer->begin(pass.name);
+        pass.execute();
+        if (this->gpuTimer)
+            this->gpuTimer->end(pass.name);
+    }
+}
+
+GLuint  FrameGraph::getTexture( size_t index ) const {
+    const tFrameResource& resource = this->resources[index];
+    if (resource.slot == -1)
+        return (0);
+    auto it = this->textures.find(this->slots[resource.slot].key);
+    return (it == this->textures.end() ? 0 : it->second);
+}
+
+bool    FrameGraph::isCulled( const std::string& name ) const {
+    for (size_t i = 0; i < this->passes.size() && i < this->alive.size(); ++i)
+        if (this->passes[i].name == name)
+            return (!this->alive[i]);
+    return (true);
+}
+
+void    FrameGraph::dump( std::ostream& os ) const {
+    os << "> FrameGraph: " << this->steps.size() << "/" << this->passes.size() << " passes" << std::endl;
+    for (size_t i = 0; i < this->passes.size(); ++i) {
+        os << "  " << this->passes[i].name;
+        if (!this->compiled || !this->alive[i]) {
+            os << " (culled)" << std::endl;
+            continue;
+        }
+        const tFrameStep* step = nullptr;
+        for (size_t s = 0; s < this->steps.size(); ++s)
+            if (this->steps[s].pass == i)
+                step = &this->steps[s];
+        for (size_t u = 0; u < step->barriers.size(); ++u)
+            os << " barrier(" << this->resources[step->barriers[u]].name << ")";
+        for (size_t u = 0; u < step->clears.size(); ++u)
+            os << " clear(" << this->resources[step->clears[u]].name << ")";
+        for (size_t u = 0; u < this->passes[i].reads.size(); ++u)
+            os << " read(" << this->passes[i].reads[u] << ")";
+        for (size_t u = 0; u < this->passes[i].writes.size(); ++u)
+            os << " write(" << this->passes[i].writes[u] << ")";
+        os << std::endl;
+    }
+    for (size_t r = 0; r < this->resources.size(); ++r) {
+        const tFrameResource& resource = this->resources[r];
+        os << "  " << resource.name << ": ";
+        if (resource.imported)
+            os << "imported";
+        else if (resource.slot == -1)
+            os << "unused";
+        else
+            os << this->slots[resource.slot].key << " [" << resource.firstUse << ", " << resource.lastUse << "]";
+        os << std::endl;
+    }
+}
+
+bool    isDepthFormat( GLenum internalFormat ) {
+    return (internalFormat == GL_DEPTH_COMPONENT || internalFormat == GL_DEPTH_COMPONENT16 ||
+            internalFormat == GL_DEPTH_COMPONENT24 || internalFormat == GL_DEPTH_COMPONENT32F);
+}
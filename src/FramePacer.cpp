@@ -0,0 +1,141 @@
+#include "FramePacer.hpp"
+
+FramePacer::FramePacer( float framerate, eSyncMode sync, bool lowLatency ) : framerate(framerate), sync(sync), lowLatency(lowLatency) {
+    this->work = 0.0;
+    this->frame = 0;
+    glGenQueries(FRAME_PACER_LATENCY, this->queries);
+    std::fill(this->pending, this->pending + FRAME_PACER_LATENCY, false);
+    this->setSyncMode(sync);
+    this->lastSwap = std::chrono::steady_clock::now();
+    this->inputTime = this->lastSwap;
+    this->deadline = this->lastSwap + this->period;
+    this->reset();
+}
+
+FramePacer::~FramePacer( void ) {
+    glDeleteQueries(FRAME_PACER_LATENCY, this->queries);
+}
+
+void    FramePacer::setFramerate( float framerate ) {
+    this->framerate = std::max(framerate, 0.0f);
+    this->updatePeriod();
+}
+
+/*  the adaptive mode needs the swap_control_tear extension, otherwise it falls back to vsync */
+void    FramePacer::setSyncMode( eSyncMode sync ) {
+    this->sync = sync;
+    if (sync == eSyncMode::adaptive && !glfwExtensionSupported("WGL_EXT_swap_control_tear")
+        && !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+        glfwSwapInterval(1);
+    else
+        glfwSwapInterval(sync == eSyncMode::off ? 0 : (sync == eSyncMode::vsync ? 1 : -1));
+    this->updatePeriod();
+}
+
+void    FramePacer::updatePeriod( void ) {
+    double seconds = 0.0;
+    if (this->framerate > 0.0f)
+        seconds = 1.0 / this->framerate;
+    else if (this->sync != eSyncMode::off) {
+        /* only to place the low latency wait, the swap itself already blocks */
+        const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        if (mode && mode->refreshRate > 0)
+            seconds = 1.0 / mode->refreshRate;
+    }
+    this->period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+/*  sleeps while the deadline is more than FRAME_PACER_SPIN away, then spins */
+void    FramePacer::waitUntil( tTimePoint time ) {
+    const tMilliseconds spin(FRAME_PACER_SPIN);
+    for (tMilliseconds remaining = time - std::chrono::steady_clock::now(); remaining.count() > 0.0;
+         remaining = time - std::chrono::steady_clock::now()) {
+        if (remaining > spin)
+            std::this_thread::sleep_for(remaining - spin);
+        else
+            std::this_thread::yield();
+    }
+}
+
+/*  to call before sampling the inputs */
+void    FramePacer::beginFrame( void ) {
+    if (this->lowLatency && this->period.count() > 0) {
+        tMilliseconds estimate(this->work);
+        this->waitUntil(this->deadline - std::chrono::duration_cast<std::chrono::steady_clock::duration>(estimate));
+    }
+    this->inputTime = std::chrono::steady_clock::now();
+}
+
+/*  to call once the buffers are swapped */
+void    FramePacer::endFrame( void ) {
+    size_t slot = this->frame % FRAME_PACER_LATENCY;
+    if (this->pending[slot])
+        this->readLatency(slot);
+    glQueryCounter(this->queries[slot], GL_TIMESTAMP);
+    this->inputTimes[slot] = this->inputTime;
+    this->pending[slot] = true;
+    this->frame++;
+
+    tTimePoint swap = std::chrono::steady_clock::now();
+    double interval = tMilliseconds(swap - this->lastSwap).count();
+    this->stats.intervalSum += interval;
+    this->stats.intervalSqSum += interval * interval;
+    this->stats.intervalMax = std::max(this->stats.intervalMax, interval);
+    this->stats.intervals++;
+    this->lastSwap = swap;
+    this->work = 0.9 * this->work + 0.1 * tMilliseconds(swap - this->inputTime).count();
+
+    if (this->period.count() == 0)
+        return;
+    if (!this->lowLatency)
+        this->waitUntil(this->deadline);
+    /* keep the cadence, unless we are late by more than a whole period */
+    this->deadline += this->period;
+    if (this->deadline < swap)
+        this->deadline = swap + this->period;
+}
+
+/*  the GPU clock is mapped on the CPU one through a pair of readings taken at the same time */
+void    FramePacer::calibrate( void ) {
+    glGetInteger64v(GL_TIMESTAMP, &this->gpuReference);
+    this->cpuReference = std::chrono::steady_clock::now();
+}
+
+void    FramePacer::readLatency( size_t slot ) {
+    GLuint64 timestamp;
+    glGetQueryObjectui64v(this->queries[slot], GL_QUERY_RESULT, &timestamp);
+    this->pending[slot] = false;
+    double gpu = static_cast<double>(static_cast<GLint64>(timestamp) - this->gpuReference) / 1000000.0;
+    double latency = gpu + tMilliseconds(this->cpuReference - this->inputTimes[slot]).count();
+    this->stats.latencySum += latency;
+    this->stats.latencyMax = std::max(this->stats.latencyMax, latency);
+    this->stats.latencies++;
+}
+
+void    FramePacer::reset( void ) {
+    this->stats = (tFrameStats){ 0.0, 0.0, 0.0, 0, 0.0, 0.0, 0 };
+    this->calibrate();
+}
+
+/*  average input to photon latency since the last reset, in milliseconds */
+double  FramePacer::getLatency( void ) const {
+    return (this->stats.latencies ? this->stats.latencySum / this->stats.latencies : 0.0);
+}
+
+/*  standard deviation of the frame interval since the last reset, in milliseconds */
+double  FramePacer::getJitter( void ) const {
+    if (this->stats.intervals < 2)
+        return (0.0);
+    double mean = this->stats.intervalSum / this->stats.intervals;
+    return (std::sqrt(std::max(this->stats.intervalSqSum / this->stats.intervals - mean * mean, 0.0)));
+}
+
+void    FramePacer::print( std::ostream& os ) const {
+    static const char* modes[] = { "off", "vsync", "adaptive" };
+    double interval = (this->stats.intervals ? this->stats.intervalSum / this->stats.intervals : 0.0);
+    os << "pacing: " << std::fixed << std::setprecision(2)
+       << (this->framerate > 0.0f ? this->framerate : 0.0f) << " fps target, vsync " << modes[static_cast<int>(this->sync)]
+       << (this->lowLatency ? ", low latency" : "") << " | frame " << interval << "ms jitter "
+       << this->getJitter() << "ms max " << this->stats.intervalMax << "ms | latency "
+       << this->getLatency() << "ms max " << this->stats.latencyMax << "ms" << std::endl;
+}
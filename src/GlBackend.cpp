@@ -0,0 +1,55 @@
+#include "GlBackend.hpp"
+
+GlBackend::GlBackend( void ) {
+}
+
+GlBackend::~GlBackend( void ) {
+}
+
+/*  the uniforms are set on program, which the pass has bound. The values are copied out of the
+    buffer since nothing aligns them there.
+*/
+void    GlBackend::execute( const CommandBuffer& commands, Shader& program ) {
+    const std::vector<tCommand>& list = commands.getCommands();
+    int         i;
+    float       f;
+    glm::vec3   v;
+    glm::mat4   m;
+    for (size_t c = 0; c < list.size(); ++c) {
+        const tCommand& command = list[c];
+        switch (command.type) {
+            case eCommand::bindTexture:
+                GlState::bindTexture(command.unit, command.target, command.object);
+                break;
+            case eCommand::bindVertexArray:
+                GlState::bindVertexArray(command.object);
+                break;
+            case eCommand::drawElements:
+                glDrawElements(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, 0);
+                break;
+            case eCommand::drawArrays:
+                glDrawArrays(GL_TRIANGLES, 0, command.count);
+                break;
+            case eCommand::uniformInt:
+                std::memcpy(&i, commands.getData(command.data), sizeof(i));
+                program.setIntUniformValue(command.name, i);
+                break;
+            case eCommand::uniformFloat:
+                std::memcpy(&f, commands.getData(command.data), sizeof(f));
+                program.setFloatUniformValue(command.name, f);
+                break;
+            case eCommand::uniformVec3:
+                std::memcpy(&v, commands.getData(command.data), sizeof(v));
+                program.setVec3UniformValue(command.name, v);
+                break;
+            case eCommand::uniformMat4:
+                std::memcpy(&m, commands.getData(command.data), sizeof(m));
+                program.setMat4UniformValue(command.name, m);
+                break;
+            case eCommand::updateBuffer:
+                glBindBuffer(command.target, command.object);
+                glBufferSubData(command.target, command.offset, command.count, commands.getData(command.data));
+                break;
+        };
+    }
+}
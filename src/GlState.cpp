@@ -0,0 +1,192 @@
+#include "GlState.hpp"
+
+GLuint          GlState::program = GL_STATE_UNKNOWN;
+GLuint          GlState::vertexArray = GL_STATE_UNKNOWN;
+GLuint          GlState::activeUnit = GL_STATE_UNKNOWN;
+GLuint          GlState::textures[GL_STATE_TEXTURE_UNITS][3];
+GLuint          GlState::drawFramebuffer = GL_STATE_UNKNOWN;
+GLuint          GlState::readFramebuffer = GL_STATE_UNKNOWN;
+GLuint          GlState::capabilities[3] = { GL_STATE_UNKNOWN, GL_STATE_UNKNOWN, GL_STATE_UNKNOWN };
+GLenum          GlState::depth = GL_STATE_UNKNOWN;
+GLenum          GlState::blend[2] = { GL_STATE_UNKNOWN, GL_STATE_UNKNOWN };
+GLuint          GlState::mask = GL_STATE_UNKNOWN;
+tGlStateCounter GlState::counters[static_cast<int>(eGlState::count)];
+size_t          GlState::frames = 0;
+
+static int      getTargetIndex( GLenum target ) {
+    switch (target) {
+        case GL_TEXTURE_2D: return (0);
+        case GL_TEXTURE_2D_ARRAY: return (1);
+        case GL_TEXTURE_CUBE_MAP: return (2);
+        default: return (-1);
+    };
+}
+
+static int      getCapabilityIndex( GLenum capability ) {
+    switch (capability) {
+        case GL_DEPTH_TEST: return (0);
+        case GL_BLEND: return (1);
+        case GL_FRAMEBUFFER_SRGB: return (2);
+        default: return (-1);
+    };
+}
+
+/*  counts the call, returns true when it must not be issued */
+bool    GlState::filter( eGlState state, bool redundant ) {
+    tGlStateCounter& counter = GlState::counters[static_cast<int>(state)];
+    if (redundant)
+        counter.filtered++;
+    else
+        counter.issued++;
+    return (redundant);
+}
+
+void    GlState::useProgram( GLuint program ) {
+    if (GlState::filter(eGlState::program, GlState::program == program))
+        return;
+    glUseProgram(program);
+    GlState::program = program;
+}
+
+void    GlState::bindVertexArray( GLuint vao ) {
+    if (GlState::filter(eGlState::vertexArray, GlState::vertexArray == vao))
+        return;
+    glBindVertexArray(vao);
+    GlState::vertexArray = vao;
+}
+
+/*  the unit is only made active when the binding changes */
+void    GlState::bindTexture( GLuint unit, GLenum target, GLuint texture ) {
+    int t = getTargetIndex(target);
+    bool tracked = (t != -1 && unit < GL_STATE_TEXTURE_UNITS);
+    if (GlState::filter(eGlState::texture, tracked && GlState::textures[unit][t] == texture))
+        return;
+    if (!GlState::filter(eGlState::activeTexture, GlState::activeUnit == unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        GlState::activeUnit = unit;
+    }
+    glBindTexture(target, texture);
+    if (tracked)
+        GlState::textures[unit][t] = texture;
+}
+
+void    GlState::bindFramebuffer( GLenum target, GLuint fbo ) {
+    bool draw = (target != GL_READ_FRAMEBUFFER);
+    bool read = (target != GL_DRAW_FRAMEBUFFER);
+    if (GlState::filter(eGlState::framebuffer, (!draw || GlState::drawFramebuffer == fbo) && (!read || GlState::readFramebuffer == fbo)))
+        return;
+    glBindFramebuffer(target, fbo);
+    if (draw)
+        GlState::drawFramebuffer = fbo;
+    if (read)
+        GlState::readFramebuffer = fbo;
+}
+
+void    GlState::setCapability( GLenum capability, bool enabled ) {
+    int c = getCapabilityIndex(capability);
+    if (GlState::filter(eGlState::capability, c != -1 && GlState::capabilities[c] == enabled))
+        return;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+    if (c != -1)
+        GlState::capabilities[c] = enabled;
+}
+
+void    GlState::enable( GLenum capability ) {
+    GlState::setCapability(capability, true);
+}
+
+void    GlState::disable( GLenum capability ) {
+    GlState::setCapability(capability, false);
+}
+
+void    GlState::depthFunc( GLenum func ) {
+    if (GlState::filter(eGlState::depthFunc, GlState::depth == func))
+        return;
+    glDepthFunc(func);
+    GlState::depth = func;
+}
+
+void    GlState::blendFunc( GLenum src, GLenum dst ) {
+    if (GlState::filter(eGlState::blendFunc, GlState::blend[0] == src && GlState::blend[1] == dst))
+        return;
+    glBlendFunc(src, dst);
+    GlState::blend[0] = src;
+    GlState::blend[1] = dst;
+}
+
+void    GlState::colorMask( bool write ) {
+    if (GlState::filter(eGlState::colorMask, GlState::mask == write))
+        return;
+    glColorMask(write, write, write, write);
+    GlState::mask = write;
+}
+
+/*  OpenGL unbinds a deleted object, the cache must forget it too or the next object given the
+    same name would be considered bound already
+*/
+void    GlState::deleteProgram( GLuint program ) {
+    if (GlState::program == program)
+        GlState::program = GL_STATE_UNKNOWN;
+    glDeleteProgram(program);
+}
+
+void    GlState::deleteVertexArrays( GLsizei n, const GLuint* vaos ) {
+    for (GLsizei i = 0; i < n; ++i)
+        if (GlState::vertexArray == vaos[i])
+            GlState::vertexArray = GL_STATE_UNKNOWN;
+    glDeleteVertexArrays(n, vaos);
+}
+
+void    GlState::deleteTextures( GLsizei n, const GLuint* textures ) {
+    for (GLsizei i = 0; i < n; ++i)
+        for (size_t u = 0; u < GL_STATE_TEXTURE_UNITS; ++u)
+            for (size_t t = 0; t < 3; ++t)
+                if (GlState::textures[u][t] == textures[i])
+                    GlState::textures[u][t] = GL_STATE_UNKNOWN;
+    glDeleteTextures(n, textures);
+}
+
+void    GlState::deleteFramebuffers( GLsizei n, const GLuint* fbos ) {
+    for (GLsizei i = 0; i < n; ++i) {
+        if (GlState::drawFramebuffer == fbos[i])
+            GlState::drawFramebuffer = GL_STATE_UNKNOWN;
+        if (GlState::readFramebuffer == fbos[i])
+            GlState::readFramebuffer = GL_STATE_UNKNOWN;
+    }
+    glDeleteFramebuffers(n, fbos);
+}
+
+void    GlState::invalidate( void ) {
+    GlState::program = GL_STATE_UNKNOWN;
+    GlState::vertexArray = GL_STATE_UNKNOWN;
+    GlState::activeUnit = GL_STATE_UNKNOWN;
+    for (size_t u = 0; u < GL_STATE_TEXTURE_UNITS; ++u)
+        std::fill(GlState::textures[u], GlState::textures[u] + 3, GL_STATE_UNKNOWN);
+    GlState::drawFramebuffer = GL_STATE_UNKNOWN;
+    GlState::readFramebuffer = GL_STATE_UNKNOWN;
+    std::fill(GlState::capabilities, GlState::capabilities + 3, GL_STATE_UNKNOWN);
+    GlState::depth = GL_STATE_UNKNOWN;
+    GlState::blend[0] = GL_STATE_UNKNOWN;
+    GlState::blend[1] = GL_STATE_UNKNOWN;
+    GlState::mask = GL_STATE_UNKNOWN;
+}
+
+void    GlState::reset( void ) {
+    for (size_t i = 0; i < static_cast<size_t>(eGlState::count); ++i)
+        GlState::counters[i] = (tGlStateCounter){ 0, 0 };
+    GlState::frames = 0;
+}
+
+/*  issued/filtered calls per frame since the last reset */
+void    GlState::print( std::ostream& os ) {
+    static const char* names[] = { "program", "vao", "unit", "texture", "fbo", "enable", "depthFunc", "blendFunc", "colorMask" };
+    size_t frames = std::max(GlState::frames, static_cast<size_t>(1));
+    os << "state:" << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < static_cast<size_t>(eGlState::count); ++i)
+        os << " " << names[i] << " " << static_cast<double>(GlState::counters[i].issued) / frames
+           << "/" << static_cast<double>(GlState::counters[i].filtered) / frames;
+    os << " (issued/filtered)" << std::endl;
+}
@@ -0,0 +1,81 @@
+#include "GpuTimer.hpp"
+
+GpuTimer::GpuTimer( size_t latency ) : latency(latency), frame(0) {
+}
+
+GpuTimer::~GpuTimer( void ) {
+    for (auto it = this->queries.begin(); it != this->queries.end(); it++) {
+        glDeleteQueries(it->second.start.size(), it->second.start.data());
+        glDeleteQueries(it->second.stop.size(), it->second.stop.data());
+    }
+}
+
+/*  the queries objects are created the first time a pass is timed, one pair per frame in flight
+*/
+tGpuTimerQuery& GpuTimer::getQuery( const std::string& name ) {
+    auto it = this->queries.find(name);
+    if (it != this->queries.end())
+        return (it->second);
+    tGpuTimerQuery& query = this->queries[name];
+    query.start.resize(this->latency);
+    query.stop.resize(this->latency);
+    query.pending.resize(this->latency, false);
+    query.total = 0.0;
+    query.samples = 0;
+    glGenQueries(this->latency, query.start.data());
+    glGenQueries(this->latency, query.stop.data());
+    this->names.push_back(name);
+    return (query);
+}
+
+void    GpuTimer::begin( const std::string& name ) {
+    tGpuTimerQuery& query = this->getQuery(name);
+    glQueryCounter(query.start[this->frame % this->latency], GL_TIMESTAMP);
+}
+
+void    GpuTimer::end( const std::string& name ) {
+    tGpuTimerQuery& query = this->getQuery(name);
+    glQueryCounter(query.stop[this->frame % this->latency], GL_TIMESTAMP);
+    query.pending[this->frame % this->latency] = true;
+}
+
+/*  called once at the end of each frame. The slot that the next frame will reuse was issued
+    `latency` frames ago, so its result is (almost always) available without waiting.
+*/
+void    GpuTimer::update( void ) {
+    this->frame++;
+    size_t slot = this->frame % this->latency;
+    for (auto it = this->queries.begin(); it != this->queries.end(); it++) {
+        tGpuTimerQuery& query = it->second;
+        if (!query.pending[slot])
+            continue;
+        GLuint64 start, stop;
+        glGetQueryObjectui64v(query.start[slot], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(query.stop[slot], GL_QUERY_RESULT, &stop);
+        query.total += static_cast<double>(stop - start) / 1000000.0;
+        query.samples++;
+        query.pending[slot] = false;
+    }
+}
+
+void    GpuTimer::reset( void ) {
+    for (auto it = this->queries.begin(); it != this->queries.end(); it++) {
+        it->second.total = 0.0;
+        it->second.samples = 0;
+    }
+}
+
+/*  average time spent on the GPU by the pass since the last reset */
+double  GpuTimer::getMilliseconds( const std::string& name ) const {
+    auto it = this->queries.find(name);
+    if (it == this->queries.end() || it->second.samples == 0)
+        return (0.0);
+    return (it->second.total / it->second.samples);
+}
+
+void    GpuTimer::print( std::ostream& os ) const {
+    os << "gpu:" << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < this->names.size(); ++i)
+        os << " " << this->names[i] << " " << this->getMilliseconds(this->names[i]) << "ms";
+    os << std::endl;
+}
@@ -6,6 +6,7 @@ Light::Light( const glm::vec3& position, const glm::vec3& ambient, const glm::ve
     if (type == eLightType::point) {
         this->id = this->pointLightCount;
         this->pointLightCount++;
+        this->resolveUniforms();
     }
 }
 
@@ -13,6 +14,7 @@ Light::Light( const glm::vec3& position, const glm::vec3& ambient, const glm::ve
     if (type == eLightType::point) {
         this->id = this->pointLightCount;
         this->pointLightCount++;
+        this->resolveUniforms();
     }
 }
 
@@ -21,7 +23,7 @@ Light::~Light( void ) {
         this->pointLightCount--;
 }
 
-void    Light::render( Shader shader ) {
+void    Light::render( Shader& shader ) {
     if (this->type == eLightType::directional) {
         shader.setVec3UniformValue("directionalLight.position", this->position);
         shader.setVec3UniformValue("directionalLight.ambient", this->ambient);
@@ -29,18 +31,23 @@ void    Light::render( Shader shader ) {
         shader.setVec3UniformValue("directionalLight.specular", this->specular);
     }
     else if (this->type == eLightType::point) {
-        std::string var = "pointLights[";
-        var += std::to_string(this->id) + "].";
-        shader.setVec3UniformValue((var+std::string("position")).c_str(), this->position);
-        shader.setVec3UniformValue((var+std::string("ambient")).c_str(), this->ambient);
-        shader.setVec3UniformValue((var+std::string("diffuse")).c_str(), this->diffuse);
-        shader.setVec3UniformValue((var+std::string("specular")).c_str(), this->specular);
-        shader.setFloatUniformValue((var+std::string("const")).c_str(), this->lconst);
-        shader.setFloatUniformValue((var+std::string("linear")).c_str(), this->linear);
-        shader.setFloatUniformValue((var+std::string("quadratic")).c_str(), this->quadratic);
+        shader.setVec3UniformValue(this->uniforms[0], this->position);
+        shader.setVec3UniformValue(this->uniforms[1], this->ambient);
+        shader.setVec3UniformValue(this->uniforms[2], this->diffuse);
+        shader.setVec3UniformValue(this->uniforms[3], this->specular);
+        shader.setFloatUniformValue(this->uniforms[4], this->lconst);
+        shader.setFloatUniformValue(this->uniforms[5], this->linear);
+        shader.setFloatUniformValue(this->uniforms[6], this->quadratic);
     }
 }
 
+void    Light::resolveUniforms( void ) {
+    static const char*  fields[7] = { "position", "ambient", "diffuse", "specular", "const", "linear", "quadratic" };
+    std::string var = "pointLights[" + std::to_string(this->id) + "].";
+    for (size_t i = 0; i < 7; ++i)
+        this->uniforms[i] = uniformId(var + fields[i]);
+}
+
 // void    Light::update( void ) {
 //     this->transform = glm::mat4();
 //     this->transform = glm::translate(this->transform, this->position);
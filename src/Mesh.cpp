@@ -2,16 +2,22 @@
 #include "glm/ext.hpp"
 
 Mesh::Mesh( std::vector<tVertex> vertices, std::vector<unsigned int> indices, std::vector<tTexture> textures, tMaterial material ) : vertices(vertices), indices(indices), textures(textures), material(material) {
+    this->bounds = (tBounds){ glm::vec3(0.0f), glm::vec3(0.0f) };
+    for (size_t i = 0; i < this->vertices.size(); ++i) {
+        this->bounds.min = (i ? glm::min(this->bounds.min, this->vertices[i].Position) : this->vertices[i].Position);
+        this->bounds.max = (i ? glm::max(this->bounds.max, this->vertices[i].Position) : this->vertices[i].Position);
+    }
+    this->resolveSlots();
     this->setup(GL_STATIC_DRAW);
 }
 
 Mesh::~Mesh( void ) {
-    glDeleteVertexArrays(1, &this->vao);
+    GlState::deleteVertexArrays(1, &this->vao);
     glDeleteBuffers(1, &this->vbo);
     glDeleteBuffers(1, &this->ebo);
 }
 
-void    Mesh::render( Shader shader ) {
+void    Mesh::render( Shader& shader ) {
     /* set material attributes */
     shader.setVec3UniformValue("material.ambient", this->material.ambient);
     shader.setVec3UniformValue("material.diffuse", this->material.diffuse);
@@ -24,29 +30,70 @@ void    Mesh::render( Shader shader ) {
     shader.setIntUniformValue("state.use_texture_specular", 0);
     shader.setIntUniformValue("state.use_texture_emissive", 0);
     /* set texture attributes */
-    std::array<unsigned int, 4> n = { 1, 1, 1, 1 };
-    for (size_t i = 0; i < this->textures.size(); ++i) {
-        if (this->textures[i].type == "skybox")
-            glBindTexture(GL_TEXTURE_CUBE_MAP, this->textures[i].id);
-        else {
-            glActiveTexture(GL_TEXTURE0 + i + 1);
-            std::string number;
-            std::string name = this->textures[i].type;
-            if (name == "texture_diffuse")  number = std::to_string((n[0])++);
-            if (name == "texture_specular") number = std::to_string((n[1])++);
-            if (name == "texture_normal")   number = std::to_string((n[2])++);
-            if (name == "texture_emissive") number = std::to_string((n[3])++);
-            shader.setIntUniformValue(name + number, i + 1);
-            glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
-            shader.setIntUniformValue("state.use_"+name, 1); // activate texture usage
+    for (size_t i = 0; i < this->slots.size(); ++i) {
+        const tTextureSlot& slot = this->slots[i];
+        GlState::bindTexture(slot.unit, slot.target, slot.texture);
+        if (slot.sampled) {
+            shader.setIntUniformValue(slot.sampler, static_cast<int>(slot.unit));
+            shader.setIntUniformValue(slot.flag, 1); // activate texture usage
         }
     }
     /* render */
-    glBindVertexArray(this->vao);
+    GlState::bindVertexArray(this->vao);
     glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
+}
+
+/*  the same as render, for a command list */
+void    Mesh::record( CommandBuffer& commands ) const {
+    commands.setUniform("material.ambient", this->material.ambient);
+    commands.setUniform("material.diffuse", this->material.diffuse);
+    commands.setUniform("material.specular", this->material.specular);
+    commands.setUniform("material.shininess", this->material.shininess);
+    commands.setUniform("material.opacity", this->material.opacity);
+    commands.setUniform("state.use_texture_diffuse", 0);
+    commands.setUniform("state.use_texture_normal", 0);
+    commands.setUniform("state.use_texture_specular", 0);
+    commands.setUniform("state.use_texture_emissive", 0);
+    for (size_t i = 0; i < this->slots.size(); ++i) {
+        const tTextureSlot& slot = this->slots[i];
+        commands.bindTexture(slot.unit, slot.target, slot.texture);
+        if (slot.sampled) {
+            commands.setUniform(slot.sampler, static_cast<int>(slot.unit));
+            commands.setUniform(slot.flag, 1);
+        }
+    }
+    commands.bindVertexArray(this->vao);
+    commands.drawElements(this->indices.size());
+}
+
+/*  the n-th texture of a type is sampled by texture_<type>n on unit i + 1, the skybox is bound
+    to unit 0. The names are only built here, rendering sets the uniforms by their ids.
+*/
+void    Mesh::resolveSlots( void ) {
+    static const char*          types[4] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_emissive" };
+    std::array<unsigned int, 4> n = { 1, 1, 1, 1 };
+    this->slots.clear();
+    for (size_t i = 0; i < this->textures.size(); ++i) {
+        const std::string&  name = this->textures[i].type;
+        tTextureSlot        slot;
+        slot.texture = this->textures[i].id;
+        slot.sampled = (name != "skybox");
+        slot.unit = (slot.sampled ? i + 1 : 0);
+        slot.target = (slot.sampled ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP);
+        std::string number;
+        for (size_t t = 0; t < 4; ++t)
+            if (name == types[t])
+                number = std::to_string((n[t])++);
+        slot.sampler = uniformId(name + number);
+        slot.flag = uniformId("state.use_" + name);
+        this->slots.push_back(slot);
+    }
+}
 
-    glBindVertexArray(0);
-    glActiveTexture(GL_TEXTURE0);
+/*  the geometry only, for the passes that write depth alone (shadow-map, depth prepass) */
+void    Mesh::recordDepth( CommandBuffer& commands ) const {
+    commands.bindVertexArray(this->vao);
+    commands.drawElements(this->indices.size());
 }
 
 void    Mesh::setup( int mode ) {
@@ -56,7 +103,7 @@ void    Mesh::setup( int mode ) {
 	glGenBuffers(1, &this->ebo);
     // bind vertex array object, basically this is an object to allow us to not redo all of this process each time
     // we want to draw an object to screen, all the states we set are stored in the VAO
-	glBindVertexArray(this->vao);
+	GlState::bindVertexArray(this->vao);
     // copy our vertices array in a buffer for OpenGL to use
 	glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
 	glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(tVertex), this->vertices.data(), mode);
@@ -81,7 +128,7 @@ void    Mesh::setup( int mode ) {
     glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(tVertex), reinterpret_cast<GLvoid*>(offsetof(tVertex, Bitangent)));
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GlState::bindVertexArray(0);
 }
 
 bool    sortByTransparency( const Mesh* a, const Mesh* b ) {
@@ -13,22 +13,34 @@ static inline glm::vec3    copyAssimpColor( const aiColor3D& aic ) {
     return (glm::vec3(aic.r, aic.g, aic.b));
 }
 
-Model::Model( const std::string& path, const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ) : position(position), orientation(orientation), scale(scale) {
-    this->loadModel(path);
-    /* sort the meshes by transparency of material */
-    std::sort(this->meshes.begin(), this->meshes.end(), sortByTransparency);
-    this->update();
+Model::Model( const std::string& path, const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ) : transform(TransformStore::create(position, orientation, scale)), dynamic(false) {
+    tModelData  data;
+    Model::read(path, data);
+    this->upload(data);
     this->meshClone = false;
+    this->computeBounds();
+}
+
+Model::Model( const tModelData& data, const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ) : transform(TransformStore::create(position, orientation, scale)), dynamic(false) {
+    this->upload(data);
+    this->meshClone = false;
+    this->computeBounds();
+}
+
+/* an empty model, filled one step at a time by upload (see World::upload) */
+Model::Model( void ) : transform(TransformStore::create(glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f))), dynamic(false) {
+    this->meshClone = false;
+    this->computeBounds();
 }
 
 Model::Model( const std::vector<Mesh*> meshes, const std::vector<tTexture> textures, const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ) :
-position(position), orientation(orientation), scale(scale), meshes(meshes), textures_loaded(textures) {
-    this->update();
+transform(TransformStore::create(position, orientation, scale)), dynamic(false), meshes(meshes), textures_loaded(textures) {
     this->meshClone = true;
+    this->computeBounds();
 }
 
 /* this constructor will create a cubemap */
-Model::Model( const std::vector<std::string>& paths ) : position(glm::vec3(0, 0, 0)), orientation(glm::vec3(0, 0, 0)), scale(glm::vec3(1, 1, 1)) {
+Model::Model( const std::vector<std::string>& paths ) : transform(TransformStore::create(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec3(1, 1, 1))), dynamic(false) {
     std::vector<float>          v;
     std::vector<tVertex>        vertices;
     std::vector<unsigned int>   indices;
@@ -52,12 +64,12 @@ Model::Model( const std::vector<std::string>& paths ) : position(glm::vec3(0, 0,
     textures.push_back(texture);
 
     this->meshes.push_back(new Mesh(vertices, indices, textures, material));
-    this->update();
     this->meshClone = false;
+    this->computeBounds();
 }
 
 /* this constructor will create a quad (used to render fractals shaders, ...) */
-Model::Model( const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ) : position(position), orientation(orientation), scale(scale){
+Model::Model( const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale ) : transform(TransformStore::create(position, orientation, scale)), dynamic(false){
     std::vector<float>          v;
     std::vector<tVertex>        vertices;
     std::vector<unsigned int>   indices;
@@ -82,34 +94,51 @@ Model::Model( const glm::vec3& position, const glm::vec3& orientation, const glm
     }
     tMaterial material = (tMaterial){ glm::vec3(0.), glm::vec3(1.), glm::vec3(0.33), 0.0f };
     this->meshes.push_back(new Mesh(vertices, indices, textures, material));
-    this->update();
     this->meshClone = false;
+    this->computeBounds();
 }
 
 
 Model::~Model( void ) {
-    if (!this->meshClone)
+    TransformStore::destroy(this->transform);
+    if (!this->meshClone) {
         for (unsigned int i = 0; i < this->meshes.size(); ++i)
             delete this->meshes[i];
+        for (unsigned int i = 0; i < this->textures_loaded.size(); ++i)
+            GlState::deleteTextures(1, &this->textures_loaded[i].id);
+    }
 }
 
-void    Model::render( Shader shader ) {
-    this->update();
-    shader.setMat4UniformValue("model", this->transform);
+void    Model::render( Shader& shader ) {
+    shader.setMat4UniformValue("model", this->getTransform());
     for (unsigned int i = 0; i < this->meshes.size(); ++i)
         this->meshes[i]->render(shader);
 }
 
-void    Model::update( void ) {
-    this->transform = glm::mat4();
-    this->transform = glm::translate(this->transform, this->position);
-    this->transform = glm::rotate(this->transform, this->orientation.z, glm::vec3(0, 0, 1));
-    this->transform = glm::rotate(this->transform, this->orientation.y, glm::vec3(0, 1, 0));
-    this->transform = glm::rotate(this->transform, this->orientation.x, glm::vec3(1, 0, 0));
-    this->transform = glm::scale(this->transform, this->scale);
+/*  recording only reads the model, the TransformStore must have been updated before */
+void    Model::record( CommandBuffer& commands ) const {
+    commands.setUniform("model", this->getTransform());
+    for (unsigned int i = 0; i < this->meshes.size(); ++i)
+        this->meshes[i]->record(commands);
+}
+
+/*  skip materials and textures, the transparent meshes can be excluded (they must not occlude in a depth prepass) */
+void    Model::recordDepth( CommandBuffer& commands, bool opaqueOnly ) const {
+    commands.setUniform("model", this->getTransform());
+    for (unsigned int i = 0; i < this->meshes.size(); ++i)
+        if (!opaqueOnly || this->meshes[i]->getMaterial().opacity >= 1.0f)
+            this->meshes[i]->recordDepth(commands);
 }
 
-void    Model::loadModel( const std::string& path ) {
+void    Model::computeBounds( void ) {
+    this->spatialId = SPATIAL_NONE;
+    this->bounds = (tBounds){ glm::vec3(0.0f), glm::vec3(0.0f) };
+    for (size_t i = 0; i < this->meshes.size(); ++i)
+        this->bounds = (i ? merge(this->bounds, this->meshes[i]->getBounds()) : this->meshes[i]->getBounds());
+}
+
+/*  only reads the file and decodes its textures, the GL objects are created by upload */
+void    Model::read( const std::string& path, tModelData& data ) {
     std::cout << "> Loading: " << path << std::endl;
     Assimp::Importer import;
     const aiScene*  scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
@@ -117,19 +146,66 @@ void    Model::loadModel( const std::string& path ) {
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
         throw Exception::ModelError("AssimpLoader", import.GetErrorString());
 
-    this->directory = path.substr(0, path.find_last_of('/'));
-    this->processNode(scene->mRootNode, scene);
+    data.meshes.clear();
+    data.images.clear();
+    Model::processNode(scene->mRootNode, scene, path.substr(0, path.find_last_of('/')), data);
+    data.bytes = 0;
+    for (size_t i = 0; i < data.meshes.size(); ++i)
+        data.bytes += Model::getBytes(data.meshes[i]);
+    for (size_t i = 0; i < data.images.size(); ++i)
+        data.bytes += Model::getBytes(data.images[i]);
+}
+
+void    Model::upload( const tModelData& data ) {
+    for (size_t step = 0; step < Model::getUploadSteps(data); ++step)
+        this->upload(data, step);
+}
+
+/*  the images first, then the meshes that use them. The last step sorts the meshes by
+    transparency of material and computes the bounds.
+*/
+size_t  Model::upload( const tModelData& data, size_t step ) {
+    size_t  bytes;
+    if (step < data.images.size()) {
+        tTexture texture;
+        texture.id = uploadTexture(data.images[step]);
+        texture.type = data.images[step].type;
+        texture.path = data.images[step].path;
+        this->textures_loaded.push_back(texture);
+        bytes = Model::getBytes(data.images[step]);
+    }
+    else {
+        const tMeshData&        mesh = data.meshes[step - data.images.size()];
+        std::vector<tTexture>   textures;
+        for (size_t j = 0; j < mesh.images.size(); ++j)
+            textures.push_back(this->textures_loaded[mesh.images[j]]);
+        this->meshes.push_back(new Mesh(mesh.vertices, mesh.indices, textures, mesh.material));
+        bytes = Model::getBytes(mesh);
+    }
+    if (step + 1 == Model::getUploadSteps(data)) {
+        std::sort(this->meshes.begin(), this->meshes.end(), sortByTransparency);
+        this->computeBounds();
+    }
+    return (bytes);
 }
 
-void    Model::processNode( aiNode* node, const aiScene* scene ) {
+size_t  Model::getBytes( const tImage& image ) {
+    return (image.pixels.size() * 4 / 3); // with the mipmaps
+}
+
+size_t  Model::getBytes( const tMeshData& mesh ) {
+    return (mesh.vertices.size() * sizeof(tVertex) + mesh.indices.size() * sizeof(unsigned int));
+}
+
+void    Model::processNode( aiNode* node, const aiScene* scene, const std::string& directory, tModelData& data ) {
     // process all the node's meshes (if any)
     for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        this->meshes.push_back(this->processMesh(mesh, scene));
+        Model::processMesh(mesh, scene, directory, data);
     }
     // then do the same for each of its children
     for (unsigned int i = 0; i < node->mNumChildren; ++i)
-        this->processNode(node->mChildren[i], scene);
+        Model::processNode(node->mChildren[i], scene, directory, data);
 }
 
 static void updateMinMaxMean( const glm::vec3& pos, glm::vec3* min, glm::vec3* max, glm::vec3* mean ) {
@@ -142,11 +218,12 @@ static void updateMinMaxMean( const glm::vec3& pos, glm::vec3* min, glm::vec3* m
     max->z = (pos.z > max->z ? pos.z : max->z);
 }
 
-Mesh*    Model::processMesh( aiMesh* mesh, const aiScene* scene ) {
-    std::vector<tVertex>        vertices;
-    std::vector<unsigned int>   indices;
-    std::vector<tTexture>       textures;
-    tMaterial                   meshMaterial;
+void    Model::processMesh( aiMesh* mesh, const aiScene* scene, const std::string& directory, tModelData& data ) {
+    data.meshes.push_back(tMeshData());
+    tMeshData&                  meshData = data.meshes.back();
+    std::vector<tVertex>&       vertices = meshData.vertices;
+    std::vector<unsigned int>&  indices = meshData.indices;
+    tMaterial&                  meshMaterial = meshData.material;
 
     glm::vec3 min = glm::vec3(1000000), max = glm::vec3(-1000000), mean = glm::vec3(0.0);
     /* vertices */
@@ -178,14 +255,10 @@ Mesh*    Model::processMesh( aiMesh* mesh, const aiScene* scene ) {
     /* materials */
     aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
     /* process the textures */
-    std::vector<tTexture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-    std::vector<tTexture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-    std::vector<tTexture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-    textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-    std::vector<tTexture> emissiveMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_emissive");
-    textures.insert(textures.end(), emissiveMaps.begin(), emissiveMaps.end());
+    Model::loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", directory, data, meshData);
+    Model::loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", directory, data, meshData);
+    Model::loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", directory, data, meshData);
+    Model::loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_emissive", directory, data, meshData);
 
     /* process the materials attributes */
     float   f;
@@ -200,66 +273,67 @@ Mesh*    Model::processMesh( aiMesh* mesh, const aiScene* scene ) {
     meshMaterial.shininess = f;
     material->Get(AI_MATKEY_OPACITY, f);
     meshMaterial.opacity = f;
-    return (new Mesh(vertices, indices, textures, meshMaterial));
 }
 
-std::vector<tTexture>   Model::loadMaterialTextures( aiMaterial* mat, aiTextureType type, std::string typeName ) {
-    std::vector<tTexture> textures;
+void    Model::loadMaterialTextures( aiMaterial* mat, aiTextureType type, std::string typeName, const std::string& directory, tModelData& data, tMeshData& mesh ) {
     for (unsigned int i = 0; i < mat->GetTextureCount(type); ++i) {
         aiString str;
         mat->GetTexture(type, i, &str);
         bool skip = false;
-        for (unsigned int j = 0; j < this->textures_loaded.size(); ++j) {
-            if (std::strcmp(this->textures_loaded[j].path.data(), str.C_Str()) == 0) {
-                textures.push_back(this->textures_loaded[j]);
+        for (unsigned int j = 0; j < data.images.size(); ++j) {
+            if (std::strcmp(data.images[j].path.data(), str.C_Str()) == 0) {
+                mesh.images.push_back(j);
                 skip = true;
                 break;
             }
         }
         if (!skip) {
-            tTexture texture;
-            texture.id = loadTexture(str.C_Str(), this->directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            this->textures_loaded.push_back(texture);
+            data.images.push_back(tImage());
+            readImage((directory + '/' + std::string(str.C_Str())).c_str(), data.images.back());
+            data.images.back().type = typeName;
+            data.images.back().path = str.C_Str();
+            mesh.images.push_back(data.images.size() - 1);
         }
     }
-    return (textures);
 }
 
-unsigned int    loadTexture( const char* filename ) {
+void    readImage( const char* filename, tImage& image ) {
     std::cout << "> texture: " << filename << std::endl;
+    unsigned char*  data = stbi_load(filename, &image.width, &image.height, &image.channels, 0);
+    if (!data)
+        throw Exception::ModelError("TextureLoader", filename);
+    image.path = filename;
+    image.pixels.assign(data, data + image.width * image.height * image.channels);
+    stbi_image_free(data);
+}
+
+unsigned int    uploadTexture( const tImage& image ) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, channels;
-    unsigned char*  data = stbi_load(filename, &width, &height, &channels, 0);
-
-    if (data) {
-        GLenum format;
-        switch (channels) {
-            case 1: format = GL_RED; break;
-            case 3: format = GL_RGB; break;
-            case 4: format = GL_RGBA; break;
-        };
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        stbi_image_free(data);
-    }
-    else {
-        stbi_image_free(data);
-        throw Exception::ModelError("TextureLoader", filename);
-    }
+    GLenum format;
+    switch (image.channels) {
+        case 1: format = GL_RED; break;
+        case 3: format = GL_RGB; break;
+        case 4: format = GL_RGBA; break;
+    };
+    GlState::bindTexture(0, GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     return (textureID);
 }
 
+unsigned int    loadTexture( const char* filename ) {
+    tImage  image;
+    readImage(filename, image);
+    return (uploadTexture(image));
+}
+
 unsigned int    loadTexture( const char* path, const std::string& directory ) {
     std::string filename = directory + '/' + std::string(path);
     return (loadTexture(filename.c_str()));
@@ -268,7 +342,7 @@ unsigned int    loadTexture( const char* path, const std::string& directory ) {
 unsigned int    loadCubemap( const std::vector<std::string>& paths ) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GlState::bindTexture(0, GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, channels;
     for (size_t i = 0; i < paths.size(); ++i) {
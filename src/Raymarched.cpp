@@ -2,7 +2,8 @@
 #include "glm/ext.hpp"
 #include "Model.hpp"
 
-Raymarched::Raymarched( const std::vector<tObject>& objects ) : objects(objects) {
+Raymarched::Raymarched( const std::vector<tObject>& objects ) : generation(0), version(0) {
+    this->setObjects(objects);
     this->createRenderQuad();
     this->setup(GL_STATIC_DRAW);
     this->skyboxId = loadCubemap(std::vector<std::string>{{
@@ -17,27 +18,65 @@ Raymarched::Raymarched( const std::vector<tObject>& objects ) : objects(objects)
 }
 
 Raymarched::~Raymarched( void ) {
-    glDeleteVertexArrays(1, &this->vao);
+    for (size_t i = 0; i < this->transforms.size(); ++i)
+        TransformStore::destroy(this->transforms[i]);
+    GlState::deleteVertexArrays(1, &this->vao);
     glDeleteBuffers(1, &this->vbo);
     glDeleteBuffers(1, &this->ebo);
 }
 
+/*  the streamed world swaps the exhibits around the camera, what was derived from the previous
+    ones (neighbors, shadow casters, the raymarched shadow maps of the renderer) is outdated
+*/
+void    Raymarched::setObjects( const std::vector<tObject>& objects ) {
+    if (objects.size() > RAYMARCH_MAX_OBJECTS)
+        throw Exception::RuntimeError("too many raymarched objects");
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->objects = objects;
+    for (size_t i = 0; i < this->transforms.size(); ++i)
+        TransformStore::destroy(this->transforms[i]);
+    this->transforms.clear();
+    this->invMats.clear();
+    this->worlds.clear();
+    this->versions.clear();
+    this->slowdowns.clear();
+    for (size_t i = 0; i < objects.size(); ++i) {
+        this->transforms.push_back(TransformStore::create(objects[i].position, objects[i].orientation, glm::vec3(1.0f)));
+        this->worlds.push_back(TransformStore::getWorld(this->transforms.back()));
+        this->invMats.push_back(glm::inverse(this->worlds.back()));
+        this->versions.push_back(0);
+        this->touch(i);
+        float radius = 1.4142f * objects[i].scale + RAYMARCH_SLOWDOWN_WIDTH;
+        if (objects[i].speedMod != 1.0)
+            this->slowdowns.insert((tBounds){ objects[i].position - radius, objects[i].position + radius }, 1, &this->objects[i]);
+    }
+    this->computeNeighbors();
+    this->shadowCasters.assign(objects.size(), 0);
+    this->generation++;
+}
+
 float   lerp(float v0, float v1, float t) {
     return (v0 * (1.0 - t) + v1 * t);
 }
 
 float   Raymarched::computeSpeedModifier( const glm::vec3& cameraPos ) {
+    std::lock_guard<std::mutex> lock(this->mutex);
     float speedmod = 1.0;
-    for (size_t i = 0; i < this->objects.size(); ++i) {
-        if (this->objects[i].speedMod != 1.0) {
-            float width = 1.0f;
-            float dist = glm::length(cameraPos - this->objects[i].position);
-            float radius = 1.4142f * this->objects[i].scale;
-            if (dist >= radius && dist < radius + width)
-                speedmod = lerp(1.0, this->objects[i].speedMod, (radius + width - dist) / width);
-            else if (dist < radius)
-                speedmod = this->objects[i].speedMod;
-        }
+    /* the bounds of the spheres the camera is in, the last object wins as before */
+    this->inside.clear();
+    this->slowdowns.query(cameraPos, 0.0f, this->inside);
+    std::sort(this->inside.begin(), this->inside.end(), [this]( tSpatialId a, tSpatialId b ) {
+        return (this->slowdowns.getData(a) < this->slowdowns.getData(b));
+    });
+    for (size_t k = 0; k < this->inside.size(); ++k) {
+        size_t i = static_cast<const tObject*>(this->slowdowns.getData(this->inside[k])) - this->objects.data();
+        float width = RAYMARCH_SLOWDOWN_WIDTH;
+        float dist = glm::length(cameraPos - this->objects[i].position);
+        float radius = 1.4142f * this->objects[i].scale;
+        if (dist >= radius && dist < radius + width)
+            speedmod = lerp(1.0, this->objects[i].speedMod, (radius + width - dist) / width);
+        else if (dist < radius)
+            speedmod = this->objects[i].speedMod;
     }
     return (speedmod);
 }
@@ -59,45 +98,169 @@ void    Raymarched::createRenderQuad( void ) {
     this->indices = {{ 0, 1, 2,  2, 3, 0 }};
 }
 
-void    Raymarched::render( Shader shader ) {
+/*  the shader is the permutation of raymarch.frag.glsl given by getDefines(i) */
+void    Raymarched::renderObject( Shader& shader, size_t i ) {
     shader.setMat4UniformValue("model", glm::mat4());
-    shader.setIntUniformValue("nObjects", this->objects.size());
+    shader.setIntUniformValue("objectIndex", i);
+    /* the entries the variant reads: the object, its neighbors and its shadow casters */
+    this->setObjectUniforms(shader, (1u << i) | this->neighbors[i] | this->shadowCasters[i]);
 
-    std::string name;
-    for (int i = 0; i < this->objects.size(); ++i) {
-        glm::mat4 mat = glm::mat4();
-        mat = glm::translate(mat, this->objects[i].position);
-        mat = glm::rotate(mat, this->objects[i].orientation.z, glm::vec3(0, 0, 1));
-        mat = glm::rotate(mat, this->objects[i].orientation.y, glm::vec3(0, 1, 0));
-        mat = glm::rotate(mat, this->objects[i].orientation.x, glm::vec3(1, 0, 0));
-
-        name = std::string("object[")+std::to_string(i)+std::string("].");
-        /* set material attributes */
-        shader.setVec3UniformValue(name+"material.ambient", this->objects[i].material.ambient);
-        shader.setVec3UniformValue(name+"material.diffuse", this->objects[i].material.diffuse);
-        shader.setVec3UniformValue(name+"material.specular", this->objects[i].material.specular);
-        shader.setFloatUniformValue(name+"material.shininess", this->objects[i].material.shininess);
-        shader.setFloatUniformValue(name+"material.opacity", this->objects[i].material.opacity);
-
-        shader.setIntUniformValue(name+"id", static_cast<int>(this->objects[i].id));
-        shader.setFloatUniformValue(name+"scale", this->objects[i].scale);
-        shader.setFloatUniformValue(name+"boundingSphereScale", this->objects[i].boundingSphereScale);
-        shader.setMat4UniformValue(name+"invMat", glm::inverse(mat));
-    }
-    
-    glActiveTexture(GL_TEXTURE2);
     shader.setIntUniformValue("skybox", 2);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, this->skyboxId);
+    GlState::bindTexture(2, GL_TEXTURE_CUBE_MAP, this->skyboxId);
 
-    glActiveTexture(GL_TEXTURE3);
     shader.setIntUniformValue("noiseSampler", 3);
-    glBindTexture(GL_TEXTURE_2D, this->noiseSamplerId);
+    GlState::bindTexture(3, GL_TEXTURE_2D, this->noiseSamplerId);
 
     /* render */
-    glBindVertexArray(this->vao);
+    GlState::bindVertexArray(this->vao);
     glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
+}
+
+/*  the ids of the fields of object[i], hashed the first time */
+static const tUniformId*    getObjectUniforms( size_t i ) {
+    static const char*  fields[RAYMARCH_OBJECT_FIELDS] = {
+        "material.ambient", "material.diffuse", "material.specular", "material.shininess", "material.opacity",
+        "id", "scale", "boundingSphereScale", "invMat", "neighbors", "shadowCasters"
+    };
+    static tUniformId   ids[RAYMARCH_MAX_OBJECTS][RAYMARCH_OBJECT_FIELDS];
+    static bool         resolved = false;
+    if (!resolved) {
+        for (size_t o = 0; o < RAYMARCH_MAX_OBJECTS; ++o)
+            for (size_t f = 0; f < RAYMARCH_OBJECT_FIELDS; ++f)
+                ids[o][f] = uniformId("object[" + std::to_string(o) + "]." + fields[f]);
+        resolved = true;
+    }
+    return (ids[i]);
+}
+
+/*  The entries of the object array in the mask, only set when they changed since they were last
+    set on that program: every object is drawn with its own variant, and a variant only reads
+    a few entries.
+*/
+void    Raymarched::setObjectUniforms( Shader& shader, uint32_t mask ) {
+    tObjectUniforms& uploaded = this->uploaded[&shader];
+    if (uploaded.program != shader.id || uploaded.count != this->objects.size()) {
+        uploaded.program = shader.id;
+        uploaded.count = this->objects.size();
+        std::fill(uploaded.versions, uploaded.versions + RAYMARCH_MAX_OBJECTS, 0);
+        shader.setIntUniformValue("nObjects", this->objects.size());
+    }
+    for (size_t i = 0; i < this->objects.size(); ++i) {
+        if (TransformStore::getWorld(this->transforms[i]) != this->worlds[i]) {
+            this->worlds[i] = TransformStore::getWorld(this->transforms[i]);
+            this->invMats[i] = glm::inverse(this->worlds[i]);
+            this->touch(i);
+        }
+        if (!(mask & (1u << i)) || uploaded.versions[i] == this->versions[i])
+            continue;
+        uploaded.versions[i] = this->versions[i];
+
+        const tUniformId* name = getObjectUniforms(i);
+        /* set material attributes */
+        shader.setVec3UniformValue(name[0], this->objects[i].material.ambient);
+        shader.setVec3UniformValue(name[1], this->objects[i].material.diffuse);
+        shader.setVec3UniformValue(name[2], this->objects[i].material.specular);
+        shader.setFloatUniformValue(name[3], this->objects[i].material.shininess);
+        shader.setFloatUniformValue(name[4], this->objects[i].material.opacity);
+
+        shader.setIntUniformValue(name[5], static_cast<int>(this->objects[i].id));
+        shader.setFloatUniformValue(name[6], this->objects[i].scale);
+        shader.setFloatUniformValue(name[7], this->objects[i].boundingSphereScale);
+        shader.setMat4UniformValue(name[8], this->invMats[i]);
+        shader.setIntUniformValue(name[9], this->neighbors[i]);
+        shader.setIntUniformValue(name[10], this->shadowCasters[i]);
+    }
+}
+
+/*  The permutation of raymarch.frag.glsl drawing object i: its type, the distance estimators of
+    its neighbors (the only ones evaluated for ambient occlusion) and the lighting features.
+*/
+std::vector<std::string>    Raymarched::getDefines( size_t i, bool useShadows ) const {
+    static const char*  names[] = { "HAS_MANDELBOX", "HAS_MANDELBULB", "HAS_IFS", "", "", "HAS_BLOB" };
+    std::vector<std::string> defines;
+    defines.push_back("OBJECT_ID " + std::to_string(static_cast<int>(this->objects[i].id)));
+    for (size_t j = 0; j < this->objects.size(); ++j) {
+        std::string name = names[static_cast<int>(this->objects[j].id)];
+        if ((j == i || (this->neighbors[i] & (1 << j))) && !name.empty()
+            && std::find(defines.begin(), defines.end(), name) == defines.end())
+            defines.push_back(name);
+    }
+    if (useShadows)
+        defines.push_back("USE_SHADOWS");
+    if (this->objects[i].id == eRaymarchObject::mandelbulb)
+        defines.push_back("USE_OCCLUSION");
+    return (defines);
+}
+
+/*  back to front, the objects are blended over each other (their bounding spheres do not overlap) */
+void    Raymarched::getDrawOrder( const glm::vec3& cameraPos, std::vector<size_t>& order ) const {
+    order.clear();
+    for (size_t i = 0; i < this->objects.size(); ++i)
+        order.push_back(i);
+    std::sort(order.begin(), order.end(), [this, &cameraPos]( size_t a, size_t b ) {
+        return (glm::length(this->objects[a].position - cameraPos) > glm::length(this->objects[b].position - cameraPos));
+    });
+}
+
+float   Raymarched::getBoundingRadius( size_t i ) const {
+    return (this->objects[i].scale * this->objects[i].boundingSphereScale);
+}
+
+/*  The ambient occlusion of a point only samples the distance field up to RAYMARCH_OCCLUSION_REACH
+    along the normal, so only the objects whose bounding spheres are that close can contribute.
+*/
+void    Raymarched::computeNeighbors( void ) {
+    this->neighbors.assign(this->objects.size(), 0);
+    for (size_t i = 0; i < this->objects.size(); ++i)
+        for (size_t j = 0; j < this->objects.size(); ++j) {
+            float reach = this->getBoundingRadius(i) + this->getBoundingRadius(j) + RAYMARCH_OCCLUSION_REACH;
+            if (this->castsShadow(j) && glm::length(this->objects[i].position - this->objects[j].position) < reach)
+                this->neighbors[i] |= (1 << j);
+        }
+}
+
+/*  An object can only be shadowed by the objects whose bounding spheres intersect the cylinder
+    going from its own bounding sphere toward the sun. Called when the sun moved.
+*/
+void    Raymarched::updateShadowCasters( const glm::vec3& lightDir ) {
+    for (size_t i = 0; i < this->objects.size(); ++i) {
+        int previous = this->shadowCasters[i];
+        this->shadowCasters[i] = 0;
+        for (size_t j = 0; j < this->objects.size(); ++j) {
+            if (!this->castsShadow(j))
+                continue;
+            glm::vec3 v = this->objects[j].position - this->objects[i].position;
+            float t = glm::dot(v, lightDir);
+            float reach = this->getBoundingRadius(i) + this->getBoundingRadius(j);
+            float dist = (t > 0.0f ? glm::length(v - lightDir * t) : glm::length(v));
+            if (dist < reach)
+                this->shadowCasters[i] |= (1 << j);
+        }
+        if (this->shadowCasters[i] != previous)
+            this->touch(i);
+    }
+}
+
+/*  the volumetric objects (marble and cloud) are not distance fields, they cast no shadow */
+bool    Raymarched::castsShadow( size_t i ) const {
+    return (this->objects[i].id != eRaymarchObject::marble && this->objects[i].id != eRaymarchObject::cloud);
+}
+
+/*  the distance estimators of the mandelbulb, the ifs and the blob change with uTime */
+bool    Raymarched::isAnimated( size_t i ) const {
+    return (this->objects[i].id == eRaymarchObject::mandelbulb || this->objects[i].id == eRaymarchObject::ifs
+            || this->objects[i].id == eRaymarchObject::blob);
+}
 
-    glBindVertexArray(0);
+/*  orthographic projection from the light fitting the bounding sphere of the object, the near
+    plane is tangent to the sphere so depths are in [0, 2 * radius] world units.
+*/
+glm::mat4   Raymarched::getLightSpaceMatrix( size_t i, const glm::vec3& lightDir ) const {
+    float radius = this->getBoundingRadius(i);
+    glm::vec3 center = this->objects[i].position;
+    glm::vec3 up = (std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 lightView = glm::lookAt(center + lightDir * radius, center, up);
+    return (glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius) * lightView);
 }
 
 
@@ -108,7 +271,7 @@ void    Raymarched::setup( int mode ) {
 	glGenBuffers(1, &this->ebo);
     // bind vertex array object, basically this is an object to allow us to not redo all of this process each time
     // we want to draw an object to screen, all the states we set are stored in the VAO
-	glBindVertexArray(this->vao);
+	GlState::bindVertexArray(this->vao);
     // copy our vertices array in a buffer for OpenGL to use
 	glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
 	glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(tQuadVertex), this->vertices.data(), mode);
@@ -124,5 +287,5 @@ void    Raymarched::setup( int mode ) {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(tQuadVertex), reinterpret_cast<GLvoid*>(offsetof(tQuadVertex, TexCoords)));
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GlState::bindVertexArray(0);
 }
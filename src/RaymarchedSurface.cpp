@@ -2,14 +2,14 @@
 #include "glm/ext.hpp"
 #include "Model.hpp"
 
-RaymarchedSurface::RaymarchedSurface( const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale, unsigned int skybox, unsigned int noise ) : position(position), orientation(orientation), scale(scale), skyboxId(skybox), noiseSamplerId(noise) {
+RaymarchedSurface::RaymarchedSurface( const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale, unsigned int skybox, unsigned int noise ) : noiseSamplerId(noise), skyboxId(skybox), transform(TransformStore::create(position, orientation, scale)), spatialId(SPATIAL_NONE) {
     this->createRenderQuad();
     this->setup(GL_STATIC_DRAW);
-    this->update();
 }
 
 RaymarchedSurface::~RaymarchedSurface( void ) {
-    glDeleteVertexArrays(1, &this->vao);
+    TransformStore::destroy(this->transform);
+    GlState::deleteVertexArrays(1, &this->vao);
     glDeleteBuffers(1, &this->vbo);
     glDeleteBuffers(1, &this->ebo);
 }
@@ -31,31 +31,15 @@ void    RaymarchedSurface::createRenderQuad( void ) {
     this->indices = {{ 0, 1, 2,  2, 3, 0 }};
 }
 
-void    RaymarchedSurface::update( void ) {
-    this->transform = glm::mat4();
-    this->transform = glm::translate(this->transform, this->position);
-    this->transform = glm::rotate(this->transform, this->orientation.z, glm::vec3(0, 0, 1));
-    this->transform = glm::rotate(this->transform, this->orientation.y, glm::vec3(0, 1, 0));
-    this->transform = glm::rotate(this->transform, this->orientation.x, glm::vec3(1, 0, 0));
-    this->transform = glm::scale(this->transform, this->scale);
-}
-
-void    RaymarchedSurface::render( Shader shader ) {
-    this->update();
-    shader.setMat4UniformValue("model", this->transform);
-
-    glActiveTexture(GL_TEXTURE1);
-    shader.setIntUniformValue("skybox", 1);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, this->skyboxId);
-
-    glActiveTexture(GL_TEXTURE2);
-    shader.setIntUniformValue("noiseSampler", 2);
-    glBindTexture(GL_TEXTURE_2D, this->noiseSamplerId);
-    /* render */
-    glBindVertexArray(this->vao);
-    glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-
-    glBindVertexArray(0);
+/*  recording only reads the surface, the TransformStore must have been updated before */
+void    RaymarchedSurface::record( CommandBuffer& commands ) const {
+    commands.setUniform("model", this->getTransform());
+    commands.setUniform("skybox", 1);
+    commands.bindTexture(1, GL_TEXTURE_CUBE_MAP, this->skyboxId);
+    commands.setUniform("noiseSampler", 2);
+    commands.bindTexture(2, GL_TEXTURE_2D, this->noiseSamplerId);
+    commands.bindVertexArray(this->vao);
+    commands.drawElements(this->indices.size());
 }
 
 
@@ -66,7 +50,7 @@ void    RaymarchedSurface::setup( int mode ) {
 	glGenBuffers(1, &this->ebo);
     // bind vertex array object, basically this is an object to allow us to not redo all of this process each time
     // we want to draw an object to screen, all the states we set are stored in the VAO
-	glBindVertexArray(this->vao);
+	GlState::bindVertexArray(this->vao);
     // copy our vertices array in a buffer for OpenGL to use
 	glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
 	glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(tQuadVertex2), this->vertices.data(), mode);
@@ -82,5 +66,5 @@ void    RaymarchedSurface::setup( int mode ) {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(tQuadVertex2), reinterpret_cast<GLvoid*>(offsetof(tQuadVertex2, TexCoords)));
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    GlState::bindVertexArray(0);
 }
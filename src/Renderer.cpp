@@ -1,25 +1,80 @@
 #include "Renderer.hpp"
 #include "glm/ext.hpp"
 
-Renderer::Renderer( Env* env ) :
+Renderer::Renderer( Env* env, const tRenderToFile* renderToFile ) :
 env(env),
-camera(75, (float)env->getWindow().width / (float)env->getWindow().height) {
+camera(75, (float)env->getWindow().width / (float)env->getWindow().height),
+raymarchVariants("./shader/vertex/raymarch.vert.glsl", "./shader/fragment/raymarch.frag.glsl"),
+shaderWatcher("./shader") {
+    tTimePoint  start = std::chrono::steady_clock::now();
+    Shader::setBinaryCache("./shader/cache");
+    Shader::setParallelCompile();
     this->shader["default"] = new Shader("./shader/vertex/default.vert.glsl", "./shader/fragment/default.frag.glsl");
     this->shader["skybox"]  = new Shader("./shader/vertex/skybox.vert.glsl", "./shader/fragment/skybox.frag.glsl");
     this->shader["shadowMap"] = new Shader("./shader/vertex/shadowMap.vert.glsl", "./shader/fragment/shadowMap.frag.glsl");
-    this->shader["raymarch"] = new Shader("./shader/vertex/raymarch.vert.glsl", "./shader/fragment/raymarch.frag.glsl");
     this->shader["raymarchOnSurface"] = new Shader("./shader/vertex/raymarchSurface.vert.glsl", "./shader/fragment/raymarchSurface.frag.glsl");
     this->shader["2Dtexture"] = new Shader("./shader/vertex/raymarchSurface.vert.glsl", "./shader/fragment/2Dtexture.frag.glsl");
-    this->shader["blendTexture"] = new Shader("./shader/vertex/raymarch.vert.glsl", "./shader/fragment/blendTexture.frag.glsl");
+    this->shader["depthPrepass"] = new Shader("./shader/vertex/depthPrepass.vert.glsl", "./shader/fragment/shadowMap.frag.glsl");
+    this->shader["screen"] = new Shader("./shader/vertex/screen.vert.glsl", "./shader/fragment/screen.frag.glsl");
+    this->shader["raymarchShadow"] = new Shader("./shader/vertex/screen.vert.glsl", "./shader/fragment/raymarchShadow.frag.glsl");
+    this->offline = (renderToFile != nullptr);
+    if (this->offline) {
+        this->shader["downsample"] = new Shader("./shader/vertex/screen.vert.glsl", "./shader/fragment/downsample.frag.glsl");
+        this->shader["yuv"] = new Shader("./shader/vertex/screen.vert.glsl", "./shader/fragment/yuv.frag.glsl");
+    }
+    /* the cells around the camera are loaded before the first frame */
+    this->env->stream(this->camera.getPosition(), this->camera.getCameraFront(), true);
+    /* the raymarch permutations of the scene without shadows, so that the first frame does not stall */
+    for (size_t i = 0; this->env->getRaymarched() && i < this->env->getRaymarched()->getObjects().size(); ++i) {
+        this->raymarchVariants.get(this->env->getRaymarched()->getDefines(i, false));
+        if (this->offline)
+            this->raymarchVariants.get(this->env->getRaymarched()->getDefines(i, true));
+    }
+    size_t cached = 0;
+    for (auto it = this->shader.begin(); it != this->shader.end(); ++it)
+        cached += it->second->isFromBinaryCache();
+    std::cout << "shaders: " << this->shader.size() + this->raymarchVariants.size() << " programs issued in "
+              << tMilliseconds(std::chrono::steady_clock::now() - start).count() << " ms ("
+              << cached << "/" << this->shader.size() << " from the binary cache)" << std::endl;
     this->lastTime = std::chrono::steady_clock::now();
     this->framerate = 60.0;
+    this->time = 0.0;
+    this->frame = 0;
+
+    /* the screen pass generates its vertices, but core profile still requires a bound VAO */
+    glGenVertexArrays(1, &this->screenVao);
+
+    this->useShadows = 0;
+    this->shadowUpdateAngle = SHADOW_UPDATE_ANGLE;
+    this->shadowCache.lightDir = glm::vec3(0.0f);
+    this->raymarchShadowDir = glm::vec3(0.0f);
+    this->raymarchShadowGeneration = 0;
+    this->raymarchShadowTime = 0.0;
+    this->raymarchShadersGeneration = 0;
+    this->raymarchVariantsGeneration = 0;
+    for (size_t i = 0; i < RAYMARCH_MAX_OBJECTS; ++i)
+        this->raymarchLightSpaceMat[i] = glm::mat4(1.0f);
+    for (size_t c = 0; c < SHADOW_CASCADES; ++c) {
+        this->lightSpaceMat[c] = glm::mat4(1.0f);
+        this->shadowCache.valid[c] = false;
+    }
 
-    this->initDepthMap();
-    this->initShadowDepthMap(4096, 4096);
-    this->initRenderbuffer();
-    this->initIntermediateTexture();
-    
     this->videoCapture = NULL;
+    this->cameraPath = NULL;
+    this->simulation = NULL;
+    this->captureFbo = 0;
+    this->captureTexture = 0;
+    if (this->offline) {
+        this->renderToFile = *renderToFile;
+        this->initCapture();
+    }
+    else
+        this->simulation = new Simulation(this->env, this->camera);
+    this->initFrameGraph();
+    GlState::enable(GL_DEPTH_TEST); /* z-buffering */
+    GlState::enable(GL_FRAMEBUFFER_SRGB); /* gamma correction */
+    GlState::enable(GL_BLEND); /* transparency */
+    GlState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     #if 0
     this->videoCapture = new VideoCapture(
         "./test.mp4", // .mov
@@ -30,338 +85,728 @@ camera(75, (float)env->getWindow().width / (float)env->getWindow().height) {
         16.0
     );
     #endif
-
-    this->useShadows = 0;
 }
 
 Renderer::~Renderer( void ) {
     if (this->videoCapture)
         delete this->videoCapture;
+    if (this->cameraPath)
+        delete this->cameraPath;
+    if (this->simulation)
+        delete this->simulation;
+    if (this->captureFbo) {
+        GlState::deleteFramebuffers(1, &this->captureFbo);
+        GlState::deleteTextures(1, &this->captureTexture);
+    }
+    GlState::deleteVertexArrays(1, &this->screenVao);
+}
+
+/*  The output target of the offline render, in sRGB so that GL_FRAMEBUFFER_SRGB encodes the
+    frames like it does for the window. Nothing may be missing from the first frame, so all the
+    programs (shadowed raymarch variants included) are waited for.
+*/
+void    Renderer::initCapture( void ) {
+    const tRenderToFile& settings = this->renderToFile;
+    this->cameraPath = new CameraPath(settings.cameraPath);
+    this->camera.setAspect((float)settings.width / (float)settings.height);
+    this->framerate = settings.framerate;
+    this->useShadows = 1;
+
+    const std::string& output = settings.output;
+    bool yuv = (output.size() > 4 && output.compare(output.size() - 4, 4, ".y4m") == 0);
+    this->videoCapture = new VideoCapture(
+        output,
+        settings.width,
+        settings.height,
+        settings.framerate,
+        (yuv ? eCodec::y4m : eCodec::avc1),
+        this->cameraPath->getDuration()
+    );
+
+    /* I420 is packed in a single channel target, the Y plane followed by the U and V planes */
+    glGenTextures(1, &this->captureTexture);
+    GlState::bindTexture(0, GL_TEXTURE_2D, this->captureTexture);
+    if (yuv)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, settings.width, settings.height * 3 / 2, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, settings.width, settings.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    GlState::bindTexture(0, GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &this->captureFbo);
+    GlState::bindFramebuffer(GL_FRAMEBUFFER, this->captureFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->captureTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        throw Exception::InitError("capture framebuffer is incomplete");
+    GlState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+    this->waitForShaders();
+}
+
+void    Renderer::waitForShaders( void ) {
+    for (auto it = this->shader.begin(); it != this->shader.end(); it++)
+        while (!it->second->isReady())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    while (!this->raymarchVariants.isReady())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
 }
 
 void	Renderer::loop( void ) {
     static int frames = 0;
-    static double last = 0.0;
-    glEnable(GL_DEPTH_TEST); /* z-buffering */
-    glEnable(GL_FRAMEBUFFER_SRGB); /* gamma correction */
-    glEnable(GL_BLEND); /* transparency */
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     while (!glfwWindowShouldClose(this->env->getWindow().ptr)) {
-        glfwPollEvents();
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        this->env->getController()->update();
-        this->camera.speedmod = this->env->getRaymarched()->computeSpeedModifier(this->camera.getPosition());
-        this->camera.handleInputs(this->env->getController()->getKeys(), this->env->getController()->getMouse());
-        this->useShadows = this->env->getController()->getKeyValue(GLFW_KEY_P);
-
-        this->env->getDirectionalLight()->setPosition(
-            glm::vec3(glm::sin(glfwGetTime() * 0.125 + 2.) * 50., 20., glm::cos(glfwGetTime()*0.125 + 2.) * 50.)
-        );
-        /* rendering passes */
-        this->updateShadowDepthMap();
-        this->renderLights();
-        this->renderMeshes();
-        this->renderSkybox();
-
-        /* dumb renderbuffer pass... */
-        glBindFramebuffer(GL_FRAMEBUFFER, this->renderbuffer.fbo);
-        glClear(GL_COLOR_BUFFER_BIT);
-        this->render2Dtexture();
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->renderbuffer.fbo);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->intermediateTexture.fbo);
-        glBlitFramebuffer(0, 0, this->renderbuffer.width, this->renderbuffer.height, 0, 0, this->renderbuffer.width, this->renderbuffer.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        this->renderBlendTexture();
-        /* order has importance for occlusion */
-        this->renderRaymarchedSurfaces();
-        this->renderRaymarched();
-
-        glfwSwapBuffers(this->env->getWindow().ptr);
-        /* capture video frames */
-        if (this->videoCapture)
-            this->videoCapture->write();
+        this->renderFrame();
         /* display framerate */
         tTimePoint current = std::chrono::steady_clock::now();
         frames++;
         if ((static_cast<tMilliseconds>(current - this->lastTime)).count() > 999) {
             std::cout << frames << " fps" << std::endl;
+            this->gpuTimer.print(std::cout);
+            this->gpuTimer.reset();
+            GlState::print(std::cout);
+            GlState::reset();
+            FrameArena::print(std::cout);
+            this->env->getWorld()->print(std::cout);
+            std::cout << "culling: " << this->inView.size() << "/" << this->env->getWorld()->getIndex().getCount() << " objects in view" << std::endl;
+            if (!this->offline) {
+                this->framePacer.print(std::cout);
+                this->framePacer.reset();
+            }
             this->lastTime = current;
             frames = 0;
         }
-        /* cap framerate */
-        double delta = std::abs(glfwGetTime()/1000.0 - last);
-        if (delta < (1000. / this->framerate))
-            std::this_thread::sleep_for(std::chrono::milliseconds((uint64_t)(1000. / this->framerate - delta)));
-        last = glfwGetTime()/1000.0;
+        /* offline, as fast as the GPU allows until the whole path is recorded */
+        if (this->offline && !this->videoCapture->isRecording())
+            glfwSetWindowShouldClose(this->env->getWindow().ptr, GLFW_TRUE);
+    }
+}
+
+/*  Once the programs are ready and the scene around the camera is loaded, a frame allocates
+    nothing (see test/AllocationTest.cpp): the temporaries go in the FrameArena, the handles of the
+    programs, targets, passes and command lists are resolved by initFrameGraph, and the recording
+    jobs are reused.
+*/
+void    Renderer::renderFrame( void ) {
+    if (!this->offline)
+        this->framePacer.beginFrame();
+    glfwPollEvents();
+
+    Controller* controller = this->env->getController();
+    controller->update();
+    if (this->offline) {
+        glm::vec3 position, target;
+        this->time = this->frame / this->renderToFile.framerate;
+        this->cameraPath->sample(this->time, position, target);
+        this->camera.lookAt(position, target);
+        this->env->getDirectionalLight()->setPosition(Simulation::getSunPosition(this->time));
     }
+    else {
+        /* the simulation ticks at its own rate, draw its interpolated state */
+        this->simulation->pushInput((tSimInput){
+            Camera::getMoveAxes(controller->getKeys()),
+            glm::vec2(controller->getMouse().pos - controller->getMouse().prevPos)
+        });
+        this->simulation->update();
+        tSimSnapshot snapshot = this->simulation->getSnapshot();
+        this->time = snapshot.time;
+        this->camera.place(snapshot.cameraPosition, snapshot.pitch, snapshot.yaw);
+        this->camera.speedmod = snapshot.speedmod;
+        this->env->getDirectionalLight()->setPosition(snapshot.lightPosition);
+
+        this->useShadows = controller->getKeyValue(GLFW_KEY_P);
+        eSyncMode sync = static_cast<eSyncMode>(controller->getKeyValue(GLFW_KEY_V));
+        if (sync != this->framePacer.getSyncMode())
+            this->framePacer.setSyncMode(sync);
+        this->framePacer.setLowLatency(controller->getKeyValue(GLFW_KEY_L));
+        if (controller->getKeyValue(GLFW_KEY_I))
+            this->pick();
+        if (controller->getKeyValue(GLFW_KEY_G))
+            this->frameGraph.dump(std::cout);
+    }
+    this->reloadShaders();
+    /* the lists are only changed once the recording of the previous frame is over */
+    this->waitForCommands();
+    this->env->stream(this->camera.getPosition(), this->camera.getCameraFront(), this->offline);
+    this->recordCommands();
+    /* rendering passes */
+    this->updatePasses();
+    this->gpuTimer.begin("frame");
+    this->frameGraph.execute();
+    this->gpuTimer.end("frame");
+
+    /* capture video frames (the readback is asynchronous), offline the capture pass does it */
+    if (this->videoCapture && !this->offline)
+        this->videoCapture->write();
+    glfwSwapBuffers(this->env->getWindow().ptr);
+    this->gpuTimer.update();
+    GlState::endFrame();
+    FrameArena::reset();
+    if (!this->offline)
+        this->framePacer.endFrame();
+    this->frame++;
 }
 
+/*  The static models are rendered in the persistent shadowDepth layers, a cascade is only
+    re-rendered when its projection changed, when the sun moved by more than shadowUpdateAngle
+    since the last render or when a static model moved. Most frames draw nothing here.
+*/
 void    Renderer::updateShadowDepthMap( void ) {
     Light*  directionalLight = this->env->getDirectionalLight();
     if (this->useShadows && directionalLight) {
-        glm::mat4 lightProjection, lightView;
-        lightProjection = glm::ortho(-40.0f, 40.0f, -40.0f, 40.0f, this->camera.getNear(), this->camera.getFar());
-        lightView = glm::lookAt(directionalLight->getPosition(), glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
-        this->lightSpaceMat = lightProjection * lightView;
-        /* render scene from light's point of view */
-        this->shader["shadowMap"]->use();
-        this->shader["shadowMap"]->setMat4UniformValue("lightSpaceMat", this->lightSpaceMat);
-
-        glViewport(0, 0, this->shadowDepthMap.width, this->shadowDepthMap.height);
-        glBindFramebuffer(GL_FRAMEBUFFER, this->shadowDepthMap.fbo);
-        glClear(GL_DEPTH_BUFFER_BIT);
-
-        if (this->env->getModels().size() != 0)
-            /* render meshes on shadowMap shader */
-            for (auto it = this->env->getModels().begin(); it != this->env->getModels().end(); it++)
-                (*it)->render(*this->shader["shadowMap"]);
-
-        /* reset viewport and framebuffer*/
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, this->env->getWindow().width, this->env->getWindow().height);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        this->invalidateShadowCache(glm::normalize(directionalLight->getPosition()));
+        glm::mat4 previous[SHADOW_CASCADES];
+        std::copy(this->lightSpaceMat, this->lightSpaceMat + SHADOW_CASCADES, previous);
+        this->updateShadowCascades(this->shadowCache.lightDir);
+
+        /* render scene from light's point of view, once per outdated cascade */
+        this->programs.shadowMap->use();
+        for (size_t c = 0; c < SHADOW_CASCADES; ++c) {
+            if (this->shadowCache.valid[c] && this->lightSpaceMat[c] == previous[c])
+                continue;
+            this->frameGraph.attachLayer(this->targets.shadowDepth, c);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            this->programs.shadowMap->setMat4UniformValue("lightSpaceMat", this->lightSpaceMat[c]);
+            this->backend.execute(this->getCommands(eCommandList::staticDepth), *this->programs.shadowMap);
+            this->shadowCache.valid[c] = true;
+        }
     }
 }
 
-void    Renderer::renderLights( void ) {
-    /* update shader uniforms */
-    this->shader["default"]->use();
-    this->shader["default"]->setIntUniformValue("nPointLights", Light::pointLightCount);
-
-    /* render lights for meshes */
-    for (auto it = this->env->getLights().begin(); it != this->env->getLights().end(); it++)
-        (*it)->render(*this->shader["default"]);
+/*  the dynamic models are rendered every frame with the cascades of the static layers, the
+    shaders keep the closest of the two depths.
+*/
+void    Renderer::updateDynamicShadowDepthMap( void ) {
+    this->programs.shadowMap->use();
+    for (size_t c = 0; c < SHADOW_CASCADES; ++c) {
+        this->frameGraph.attachLayer(this->targets.dynamicShadowDepth, c);
+        this->programs.shadowMap->setMat4UniformValue("lightSpaceMat", this->lightSpaceMat[c]);
+        this->backend.execute(this->getCommands(eCommandList::dynamicDepth), *this->programs.shadowMap);
+    }
+}
 
-    /* render lights for raymarched objects */
-    this->shader["raymarch"]->use();
-    for (auto it = this->env->getLights().begin(); it != this->env->getLights().end(); it++)
-        (*it)->render(*this->shader["raymarch"]);
-    
-    /* render lights for raymarched object on surfaces */
-    this->shader["raymarchOnSurface"]->use();
-    for (auto it = this->env->getLights().begin(); it != this->env->getLights().end(); it++)
-        (*it)->render(*this->shader["raymarchOnSurface"]);
+void    Renderer::invalidateShadowCache( const glm::vec3& lightDir ) {
+    bool changed = (glm::dot(lightDir, this->shadowCache.lightDir) < std::cos(glm::radians(this->shadowUpdateAngle)));
+    std::vector<tTransformId>& casters = this->shadowCache.casters;
+    size_t n = 0;
+    for (auto it = this->env->getModels().begin(); it != this->env->getModels().end(); it++) {
+        if ((*it)->isDynamic())
+            continue;
+        tTransformId caster = (*it)->getTransformId();
+        if (n == casters.size())
+            casters.push_back(TRANSFORM_NONE);
+        changed = changed || (casters[n] != caster) || TransformStore::isChanged(caster);
+        casters[n++] = caster;
+    }
+    changed = changed || (n != casters.size());
+    casters.resize(n);
+    if (changed) {
+        this->shadowCache.lightDir = lightDir;
+        for (size_t c = 0; c < SHADOW_CASCADES; ++c)
+            this->shadowCache.valid[c] = false;
+    }
 }
 
-void    Renderer::renderMeshes( void ) {
-    /* update shader uniforms */
-    this->shader["default"]->use();
-    this->shader["default"]->setMat4UniformValue("projection", this->camera.getProjectionMatrix());
-    this->shader["default"]->setMat4UniformValue("view", this->camera.getViewMatrix());
-    this->shader["default"]->setVec3UniformValue("viewPos", this->camera.getPosition());
-    this->shader["default"]->setMat4UniformValue("lightSpaceMat", this->lightSpaceMat);
-    glActiveTexture(GL_TEXTURE0);
-    this->shader["default"]->setIntUniformValue("shadowMap", 0);
-    this->shader["default"]->setIntUniformValue("state.use_shadows", this->useShadows);
-    glBindTexture(GL_TEXTURE_2D, this->shadowDepthMap.id);
-
-    if (this->env->getModels().size() != 0)
-        /* render models */
-        for (auto it = this->env->getModels().begin(); it != this->env->getModels().end(); it++)
-            (*it)->render(*this->shader["default"]);
+/*  Render the shadow rays of each raymarched object from the sun (see raymarchShadow.frag.glsl),
+    the raymarch pass then only does a texture lookup per object instead of marching the whole
+    scene toward the light for every pixel. Every layer is refreshed when the sun moved enough or
+    the objects changed. The animated objects (see Raymarched::isAnimated) change shape with
+    uTime, their layers are also refreshed every RAYMARCH_SHADOW_REFRESH seconds, and every
+    frame offline.
+*/
+void    Renderer::updateRaymarchedShadowMap( void ) {
+    Raymarched* raymarched = this->env->getRaymarched();
+    glm::vec3   lightDir = glm::normalize(this->env->getDirectionalLight()->getPosition());
+    bool        all = (glm::dot(lightDir, this->raymarchShadowDir) < std::cos(glm::radians(this->shadowUpdateAngle))
+                       || raymarched->getGeneration() != this->raymarchShadowGeneration);
+    bool        animated = false;
+    for (size_t i = 0; i < raymarched->getObjects().size(); ++i)
+        animated = animated || (raymarched->castsShadow(i) && raymarched->isAnimated(i));
+    animated = animated && std::abs(this->time - this->raymarchShadowTime) >= (this->offline ? 0.0 : RAYMARCH_SHADOW_REFRESH);
+    if (!all && !animated)
+        return;
+    this->raymarchShadowTime = this->time;
+    if (all) {
+        this->raymarchShadowDir = lightDir;
+        this->raymarchShadowGeneration = raymarched->getGeneration();
+        raymarched->updateShadowCasters(lightDir);
+    }
+    /* the layers refreshed alone must match the others */
+    lightDir = this->raymarchShadowDir;
+
+    GlState::disable(GL_DEPTH_TEST);
+    this->programs.raymarchShadow->use();
+    this->programs.raymarchShadow->setVec3UniformValue("lightDir", lightDir);
+    this->programs.raymarchShadow->setFloatUniformValue("uTime", this->time);
+    raymarched->setObjectUniforms(*this->programs.raymarchShadow);
+    GlState::bindVertexArray(this->screenVao);
+    for (size_t i = 0; i < raymarched->getObjects().size() && i < RAYMARCH_MAX_OBJECTS; ++i) {
+        this->raymarchLightSpaceMat[i] = raymarched->getLightSpaceMatrix(i, lightDir);
+        if (!raymarched->castsShadow(i) || (!all && !raymarched->isAnimated(i)))
+            continue;
+        this->frameGraph.attachLayer(this->targets.raymarchedShadow, i);
+        this->programs.raymarchShadow->setIntUniformValue("layer", i);
+        this->programs.raymarchShadow->setMat4UniformValue("invLightSpaceMat", glm::inverse(this->raymarchLightSpaceMat[i]));
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    GlState::enable(GL_DEPTH_TEST);
+}
 
-    /* copy the depth buffer to a texture (used in raymarch shader for geometry occlusion of raymarched objects) */
-    glBindTexture(GL_TEXTURE_2D, this->depthMap.id);
-    glReadBuffer(GL_FRONT);
-    glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 0, 0, this->depthMap.width, this->depthMap.height, 0);
+bool    Renderer::hasDynamicModels( void ) {
+    for (auto it = this->env->getModels().begin(); it != this->env->getModels().end(); it++)
+        if ((*it)->isDynamic())
+            return (true);
+    return (false);
 }
 
-void    Renderer::renderSkybox( void ) {
-    glDepthFunc(GL_LEQUAL);
-    this->shader["skybox"]->use();
-    this->shader["skybox"]->setMat4UniformValue("view", glm::mat4(glm::mat3(this->camera.getViewMatrix())));
-    this->shader["skybox"]->setMat4UniformValue("projection", this->camera.getProjectionMatrix());
-    /* render skybox */
-    this->env->getSkybox()->render(*this->shader["skybox"]);
-    glDepthFunc(GL_LESS);
+/*  Split the view frustum up to SHADOW_DISTANCE (mix of logarithmic and uniform splits) and
+    fit an orthographic projection around the bounding sphere of each slice. The sphere only
+    depends on the split distances, so the projection size stays the same when the camera
+    rotates. Its center is snapped to a grid of an eighth of the radius (in whole texels) and
+    the projection padded by as much, so a cascade stays valid, and cached, until the camera
+    has moved across a cell, and the shadow edges do not shimmer.
+*/
+void    Renderer::updateShadowCascades( const glm::vec3& lightDir ) {
+    const float lambda = 0.75f;
+    const float depthRange = 100.0f; // casters up to that distance toward the light are kept
+    float near = this->camera.getNear();
+    float far = std::min(this->camera.getFar(), SHADOW_DISTANCE);
+    float tanY = std::tan(glm::radians(this->camera.getFov()) * 0.5f);
+    float tanX = tanY * this->camera.getAspect();
+    glm::vec3 up = (std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -lightDir, up);
+
+    float splitNear = near;
+    for (size_t c = 0; c < SHADOW_CASCADES; ++c) {
+        float i = static_cast<float>(c + 1) / SHADOW_CASCADES;
+        float splitFar = lambda * near * std::pow(far / near, i) + (1.0f - lambda) * (near + (far - near) * i);
+        /* corners of the slice in world-space */
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (size_t k = 0; k < 8; ++k) {
+            float d = (k < 4 ? splitNear : splitFar);
+            glm::vec4 corner(d * tanX * (k & 1 ? 1.0f : -1.0f), d * tanY * (k & 2 ? 1.0f : -1.0f), -d, 1.0f);
+            corners[k] = glm::vec3(this->camera.getInvViewMatrix() * corner);
+            center += corners[k] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (size_t k = 0; k < 8; ++k)
+            radius = std::max(radius, glm::length(corners[k] - center));
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+        float pad = radius / 8.0f;
+        radius += pad;
+        /* move the center by whole cells of whole texels in light-space */
+        float texel = (2.0f * radius) / SHADOW_CASCADE_SIZE;
+        float cell = std::max(std::floor(pad / texel), 1.0f) * texel;
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        lightCenter = glm::floor(lightCenter / cell + 0.5f) * cell;
+        glm::mat4 lightProjection = glm::ortho(
+            lightCenter.x - radius, lightCenter.x + radius,
+            lightCenter.y - radius, lightCenter.y + radius,
+            -lightCenter.z - depthRange, -lightCenter.z + radius
+        );
+        this->lightSpaceMat[c] = lightProjection * lightView;
+        splitNear = splitFar;
+    }
 }
 
-void    Renderer::renderRaymarched( void ) {
-    glDisable(GL_DEPTH_TEST);
+/*  the light uniforms, set by the passes on the program they already use */
+void    Renderer::renderLights( Shader& shader ) {
+    for (auto it = this->env->getLights().begin(); it != this->env->getLights().end(); it++)
+        (*it)->render(shader);
+}
 
-    this->shader["raymarch"]->use();
-    this->shader["raymarch"]->setMat4UniformValue("lightSpaceMat", this->lightSpaceMat);
-    this->shader["raymarch"]->setIntUniformValue("use_shadows", this->useShadows);
-    this->shader["raymarch"]->setMat4UniformValue("invProjection", this->camera.getInvProjectionMatrix());
-    this->shader["raymarch"]->setMat4UniformValue("invView", this->camera.getInvViewMatrix());
-    this->shader["raymarch"]->setFloatUniformValue("near", this->camera.getNear());
-    this->shader["raymarch"]->setFloatUniformValue("far", this->camera.getFar());
-    this->shader["raymarch"]->setVec3UniformValue("cameraPos", this->camera.getPosition());
+/*  Hot-reload of the edited shader sources: the programs using a modified file (directly or through
+    an #include) are recompiled in the background and swapped in here, between two frames, once they
+    linked successfully. On an error (compilation, or an #include that cannot be resolved) the log is
+    printed and the previous program stays in use.
+*/
+void    Renderer::reloadShaders( void ) {
+    std::vector<std::string> changes = this->shaderWatcher.getChanges();
+    if (changes.size() != 0) {
+        for (size_t i = 0; i < changes.size(); ++i) {
+            std::cout << "reloading " << changes[i] << std::endl;
+            Shader::invalidateSource(changes[i]);
+        }
+        for (auto it = this->shader.begin(); it != this->shader.end(); it++)
+            if (it->second->dependsOn(changes))
+                it->second->reload();
+        this->raymarchVariants.reload(changes);
+    }
+    for (auto it = this->shader.begin(); it != this->shader.end(); it++) {
+        if (!it->second->update())
+            continue;
+        /* the cached shadows were rendered by the previous program */
+        if (it->first == "shadowMap")
+            for (size_t c = 0; c < SHADOW_CASCADES; ++c)
+                this->shadowCache.valid[c] = false;
+        if (it->first == "raymarchShadow")
+            this->raymarchShadowDir = glm::vec3(0.0f);
+    }
+    this->raymarchVariants.update();
+}
 
-    this->shader["raymarch"]->setVec2UniformValue("uMouse", this->env->getController()->getMousePosition());
-    this->shader["raymarch"]->setFloatUniformValue("uTime", glfwGetTime());
+/*  The draws of the model passes are recorded on the workers while the GL thread renders the
+    lights and the first passes, each pass only waits for its own list (getCommands). The
+    transforms, the spatial index and the culling are updated here first, so that recording
+    only reads the scene. The shadow lists are not culled: the cascades are cached.
+*/
+void    Renderer::waitForCommands( void ) {
+    for (size_t i = 0; i < static_cast<size_t>(eCommandList::count); ++i)
+        this->workers.wait(this->commandLists[i].recording);
+}
 
-    /* geometry depth-buffer */
-    glActiveTexture(GL_TEXTURE0);
-    this->shader["raymarch"]->setIntUniformValue("depthBuffer", 0);
-    glBindTexture(GL_TEXTURE_2D, this->depthMap.id);
+void    Renderer::recordCommands( void ) {
+    TransformStore::update();
+    this->env->getWorld()->updateBounds();
+    this->cullObjects();
+    for (size_t i = 0; i < static_cast<size_t>(eCommandList::count); ++i)
+        this->workers.run(this->commandLists[i].recording);
+}
 
-    glActiveTexture(GL_TEXTURE1);
-    this->shader["raymarch"]->setIntUniformValue("shadowMap", 1);
-    glBindTexture(GL_TEXTURE_2D, this->shadowDepthMap.id);
+/*  the recording job of each list is made once, every frame queues the same jobs again */
+void    Renderer::initCommandLists( void ) {
+    this->setCommandList(eCommandList::staticDepth, [this]( CommandBuffer& commands ) {
+        for (auto it = this->env->getModels().begin(); it != this->env->getModels().end(); it++)
+            if (!(*it)->isDynamic())
+                (*it)->recordDepth(commands);
+    });
+    this->setCommandList(eCommandList::dynamicDepth, [this]( CommandBuffer& commands ) {
+        for (auto it = this->env->getModels().begin(); it != this->env->getModels().end(); it++)
+            if ((*it)->isDynamic())
+                (*it)->recordDepth(commands);
+    });
+    this->setCommandList(eCommandList::opaqueDepth, [this]( CommandBuffer& commands ) {
+        for (auto it = this->env->getModels().begin(); it != this->env->getModels().end(); it++)
+            if (this->isVisible((*it)->getSpatialId()))
+                (*it)->recordDepth(commands, true);
+    });
+    this->setCommandList(eCommandList::meshes, [this]( CommandBuffer& commands ) {
+        for (auto it = this->env->getModels().begin(); it != this->env->getModels().end(); it++)
+            if (this->isVisible((*it)->getSpatialId()))
+                (*it)->record(commands);
+    });
+    this->setCommandList(eCommandList::raymarchedSurfaces, [this]( CommandBuffer& commands ) {
+        for (auto it = this->env->getRaymarchedSurfaces().begin(); it != this->env->getRaymarchedSurfaces().end(); it++)
+            if (this->isVisible((*it)->getSpatialId()))
+                (*it)->record(commands);
+    });
+    this->setCommandList(eCommandList::texturedSurfaces, [this]( CommandBuffer& commands ) {
+        for (auto it = this->env->getTexturedSurfaces().begin(); it != this->env->getTexturedSurfaces().end(); it++)
+            if (this->isVisible((*it)->getSpatialId()))
+                (*it)->record(commands);
+    });
+}
 
-    if (this->env->getRaymarched())
-        this->env->getRaymarched()->render(*this->shader["raymarch"]);
+/*  the models and surfaces whose bounds are in the view frustum, the lists keep their order */
+void    Renderer::cullObjects( void ) {
+    const SpatialIndex& index = this->env->getWorld()->getIndex();
+    this->inView.clear();
+    index.query(getFrustum(this->camera.getProjectionMatrix() * this->camera.getViewMatrix()), this->inView, WORLD_MODELS | WORLD_SURFACES);
+    this->visible.assign(index.getCapacity(), 0);
+    for (size_t i = 0; i < this->inView.size(); ++i)
+        this->visible[this->inView[i]] = 1;
+}
 
-    glEnable(GL_DEPTH_TEST);
+/*  prints the scene entry of the object in the center of the view */
+void    Renderer::pick( void ) {
+    float               distance;
+    const tSceneEntry*  entry = this->env->getWorld()->pick(this->camera.getPosition(), this->camera.getCameraFront(), distance);
+    if (!entry)
+        std::cout << "pick: nothing in range" << std::endl;
+    else
+        std::cout << "pick: scene line " << entry->line << (entry->name.empty() ? "" : " (" + entry->name + ")")
+                  << ", " << distance << " units away" << std::endl;
 }
 
-void    Renderer::renderRaymarchedSurfaces( void ) {
-    this->shader["raymarchOnSurface"]->use();
-    this->shader["raymarchOnSurface"]->setMat4UniformValue("projection", this->camera.getProjectionMatrix());
-    this->shader["raymarchOnSurface"]->setMat4UniformValue("view", this->camera.getViewMatrix());
-    this->shader["raymarchOnSurface"]->setVec3UniformValue("cameraPos", this->camera.getPosition());
-    this->shader["raymarchOnSurface"]->setMat4UniformValue("lightSpaceMat", this->lightSpaceMat);
-
-    this->shader["raymarchOnSurface"]->setIntUniformValue("use_shadows", this->useShadows);
-    this->shader["raymarchOnSurface"]->setMat4UniformValue("invProjection", this->camera.getInvProjectionMatrix());
-    this->shader["raymarchOnSurface"]->setMat4UniformValue("invView", this->camera.getInvViewMatrix());
-    this->shader["raymarchOnSurface"]->setFloatUniformValue("near", this->camera.getNear());
-    this->shader["raymarchOnSurface"]->setFloatUniformValue("far", this->camera.getFar());
-    this->shader["raymarchOnSurface"]->setFloatUniformValue("uTime", glfwGetTime());
-
-    glActiveTexture(GL_TEXTURE0);
-    this->shader["raymarchOnSurface"]->setIntUniformValue("shadowMap", 0);
-    glBindTexture(GL_TEXTURE_2D, this->shadowDepthMap.id);
-
-    if (this->env->getRaymarchedSurfaces().size() != 0)
-        /* render models */
-        for (auto it = this->env->getRaymarchedSurfaces().begin(); it != this->env->getRaymarchedSurfaces().end(); it++)
-            (*it)->render(*this->shader["raymarchOnSurface"]);
+void    Renderer::setCommandList( eCommandList list, const std::function<void(CommandBuffer&)>& record ) {
+    tCommandList& commandList = this->commandLists[static_cast<int>(list)];
+    commandList.recording.pending = false;
+    commandList.recording.function = [&commandList, record]( void ) {
+        commandList.commands.reset();
+        record(commandList.commands);
+    };
 }
 
-void    Renderer::render2Dtexture( void ) {
-    this->shader["2Dtexture"]->use();
-    this->shader["2Dtexture"]->setMat4UniformValue("lightSpaceMat", this->lightSpaceMat);
-    this->shader["2Dtexture"]->setMat4UniformValue("projection", this->camera.getProjectionMatrix());
-    this->shader["2Dtexture"]->setMat4UniformValue("view", this->camera.getViewMatrix());
-    this->shader["2Dtexture"]->setFloatUniformValue("near", this->camera.getNear());
-    this->shader["2Dtexture"]->setFloatUniformValue("far", this->camera.getFar());
-    this->shader["2Dtexture"]->setFloatUniformValue("uTime", glfwGetTime());
-
-    glActiveTexture(GL_TEXTURE0);
-    this->shader["2Dtexture"]->setIntUniformValue("shadowMap", 0);
-    glBindTexture(GL_TEXTURE_2D, this->shadowDepthMap.id);
-
-    if (this->env->getTexturedSurfaces().size() != 0)
-        for (auto it = this->env->getTexturedSurfaces().begin(); it != this->env->getTexturedSurfaces().end(); it++)
-            (*it)->render(*this->shader["2Dtexture"]);
+/*  waits for the list to be recorded, rethrows what the recording threw */
+const CommandBuffer&    Renderer::getCommands( eCommandList list ) {
+    tCommandList& commandList = this->commandLists[static_cast<int>(list)];
+    this->workers.wait(commandList.recording);
+    return (commandList.commands);
 }
 
-void    Renderer::renderBlendTexture( void ) {
-    this->shader["blendTexture"]->use();
-    this->shader["blendTexture"]->setFloatUniformValue("near", this->camera.getNear());
-    this->shader["blendTexture"]->setFloatUniformValue("far", this->camera.getFar());
+/*  lay down the depth of the opaque meshes first, so that the shading pass only runs the
+    fragment shader once per pixel (the Inn interior has a lot of overdraw)
+*/
+void    Renderer::renderDepthPrepass( void ) {
+    GlState::colorMask(false);
+    this->programs.depthPrepass->use();
+    this->programs.depthPrepass->setMat4UniformValue("projection", this->camera.getProjectionMatrix());
+    this->programs.depthPrepass->setMat4UniformValue("view", this->camera.getViewMatrix());
+    this->backend.execute(this->getCommands(eCommandList::opaqueDepth), *this->programs.depthPrepass);
+    GlState::colorMask(true);
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    this->shader["blendTexture"]->setIntUniformValue("tex", 0);
-    glBindTexture(GL_TEXTURE_2D, this->intermediateTexture.id);
+void    Renderer::renderMeshes( void ) {
+    /* update shader uniforms */
+    this->programs.meshes->use();
+    this->programs.meshes->setMat4UniformValue("projection", this->camera.getProjectionMatrix());
+    this->programs.meshes->setMat4UniformValue("view", this->camera.getViewMatrix());
+    this->programs.meshes->setVec3UniformValue("viewPos", this->camera.getPosition());
+    this->programs.meshes->setMat4ArrayUniformValue("lightSpaceMat", this->lightSpaceMat, SHADOW_CASCADES);
+    this->programs.meshes->setIntUniformValue("nPointLights", Light::pointLightCount);
+    this->renderLights(*this->programs.meshes);
+    /* texture units of the mesh samplers */
+    this->programs.meshes->setIntUniformValue("texture_diffuse1", 1);
+    this->programs.meshes->setIntUniformValue("texture_normal1", 2);
+    this->programs.meshes->setIntUniformValue("texture_specular1", 3);
+    this->programs.meshes->setIntUniformValue("texture_emissive1", 4);
+    this->programs.meshes->setIntUniformValue("shadowMap", 0);
+    this->programs.meshes->setIntUniformValue("state.use_shadows", !this->frameGraph.isCulled(this->passes.shadows));
+    GlState::bindTexture(0, GL_TEXTURE_2D_ARRAY, this->frameGraph.getTexture(this->targets.shadowDepth));
+    this->programs.meshes->setIntUniformValue("dynamicShadowMap", 5);
+    this->programs.meshes->setIntUniformValue("use_dynamic_shadows", !this->frameGraph.isCulled(this->passes.dynamicShadows));
+    GlState::bindTexture(5, GL_TEXTURE_2D_ARRAY, this->frameGraph.getTexture(this->targets.dynamicShadowDepth));
+
+    /* the depth prepass already wrote the opaque depths */
+    GlState::depthFunc(GL_LEQUAL);
+    this->backend.execute(this->getCommands(eCommandList::meshes), *this->programs.meshes);
+    GlState::depthFunc(GL_LESS);
+}
 
-    if (this->env->getRaymarched())
-        this->env->getRaymarched()->render(*this->shader["blendTexture"]);
+void    Renderer::renderSkybox( void ) {
+    GlState::depthFunc(GL_LEQUAL);
+    this->programs.skybox->use();
+    this->programs.skybox->setMat4UniformValue("view", glm::mat4(glm::mat3(this->camera.getViewMatrix())));
+    this->programs.skybox->setMat4UniformValue("projection", this->camera.getProjectionMatrix());
+    /* render skybox */
+    this->env->getSkybox()->render(*this->programs.skybox);
+    GlState::depthFunc(GL_LESS);
 }
 
-void    Renderer::initShadowDepthMap( const size_t width, const size_t height ) {
-    this->shadowDepthMap.width = width;
-    this->shadowDepthMap.height = height;
+/*  each object is drawn with the permutation of the raymarch shader specialized for it, the
+    variants are compiled the first time they are needed. Until the shadowed variant of an object
+    is ready it is drawn without shadows, and skipped while no variant is ready. A variant that
+    failed to compile (a source mid-edit) is never ready, it is compiled again on the next reload.
+*/
+void    Renderer::renderRaymarched( void ) {
+    Raymarched* raymarched = this->env->getRaymarched();
+    GlState::disable(GL_DEPTH_TEST);
 
-    glGenFramebuffers(1, &this->shadowDepthMap.fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, this->shadowDepthMap.fbo);
-    /* create depth texture */
-    glGenTextures(1, &this->shadowDepthMap.id);
-    glBindTexture(GL_TEXTURE_2D, this->shadowDepthMap.id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    // attach depth texture as FBO's depth buffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->shadowDepthMap.id, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    this->shader["default"]->use();
-    this->shader["default"]->setIntUniformValue("shadowMap", 0);
-    this->shader["default"]->setIntUniformValue("texture_diffuse1", 1);
-    this->shader["default"]->setIntUniformValue("texture_normal1", 2);
-    this->shader["default"]->setIntUniformValue("texture_specular1", 3);
-    this->shader["default"]->setIntUniformValue("texture_emissive1", 4);
+    /* geometry depth-buffer */
+    GlState::bindTexture(0, GL_TEXTURE_2D, this->frameGraph.getTexture(this->targets.sceneDepth));
+    GlState::bindTexture(1, GL_TEXTURE_2D_ARRAY, this->frameGraph.getTexture(this->targets.shadowDepth));
+    GlState::bindTexture(4, GL_TEXTURE_2D_ARRAY, this->frameGraph.getTexture(this->targets.dynamicShadowDepth));
+    GlState::bindTexture(5, GL_TEXTURE_2D_ARRAY, this->frameGraph.getTexture(this->targets.raymarchedShadow));
+
+    bool shadows = !this->frameGraph.isCulled(this->passes.shadows) && !this->frameGraph.isCulled(this->passes.raymarchedShadows);
+    /* the variants are looked up by their defines only when the objects or the failed variants change */
+    if (this->raymarchShadersGeneration != raymarched->getGeneration()
+        || this->raymarchVariantsGeneration != this->raymarchVariants.getGeneration()
+        || this->raymarchShaders[0].size() != raymarched->getObjects().size()) {
+        for (size_t s = 0; s < 2; ++s) {
+            this->raymarchShaders[s].clear();
+            for (size_t i = 0; i < raymarched->getObjects().size(); ++i)
+                this->raymarchShaders[s].push_back(this->raymarchVariants.get(raymarched->getDefines(i, s != 0)));
+        }
+        this->raymarchShadersGeneration = raymarched->getGeneration();
+        this->raymarchVariantsGeneration = this->raymarchVariants.getGeneration();
+    }
+    std::vector<size_t>& order = this->raymarchOrder;
+    raymarched->getDrawOrder(this->camera.getPosition(), order);
+    for (size_t o = 0; o < order.size(); ++o) {
+        Shader* shader = this->raymarchShaders[shadows][order[o]];
+        if (shadows && !this->raymarchVariants.isReady(shader))
+            shader = this->raymarchShaders[0][order[o]];
+        if (!this->raymarchVariants.isReady(shader))
+            continue;
+        shader->use();
+        shader->setMat4ArrayUniformValue("lightSpaceMat", this->lightSpaceMat, SHADOW_CASCADES);
+        shader->setMat4UniformValue("invProjection", this->camera.getInvProjectionMatrix());
+        shader->setMat4UniformValue("invView", this->camera.getInvViewMatrix());
+        shader->setFloatUniformValue("near", this->camera.getNear());
+        shader->setFloatUniformValue("far", this->camera.getFar());
+        shader->setVec3UniformValue("cameraPos", this->camera.getPosition());
+        shader->setVec2UniformValue("uMouse", this->env->getController()->getMousePosition());
+        shader->setFloatUniformValue("uTime", this->time);
+        shader->setIntUniformValue("depthBuffer", 0);
+        shader->setIntUniformValue("shadowMap", 1);
+        shader->setIntUniformValue("dynamicShadowMap", 4);
+        shader->setIntUniformValue("use_dynamic_shadows", !this->frameGraph.isCulled(this->passes.dynamicShadows));
+        shader->setIntUniformValue("raymarchShadowMap", 5);
+        shader->setMat4ArrayUniformValue("raymarchLightSpaceMat", this->raymarchLightSpaceMat, RAYMARCH_MAX_OBJECTS);
+        this->renderLights(*shader);
+        raymarched->renderObject(*shader, order[o]);
+    }
+    GlState::enable(GL_DEPTH_TEST);
 }
 
-void    Renderer::initDepthMap( void ) {
-    this->depthMap.width = this->env->getWindow().width;
-    this->depthMap.height = this->env->getWindow().height;
-
-    glGenFramebuffers(1, &this->depthMap.fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, this->depthMap.fbo);
-    /* create depth texture */
-    glGenTextures(1, &this->depthMap.id);
-    glBindTexture(GL_TEXTURE_2D, this->depthMap.id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, this->depthMap.width, this->depthMap.height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // GL_NEAREST
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    // attach depth texture as FBO's depth buffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->depthMap.id, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    this->shader["raymarch"]->use();
-    this->shader["raymarch"]->setIntUniformValue("depthBuffer", 0);
+void    Renderer::renderRaymarchedSurfaces( void ) {
+    this->programs.raymarchOnSurface->use();
+    this->programs.raymarchOnSurface->setMat4UniformValue("projection", this->camera.getProjectionMatrix());
+    this->programs.raymarchOnSurface->setMat4UniformValue("view", this->camera.getViewMatrix());
+    this->programs.raymarchOnSurface->setVec3UniformValue("cameraPos", this->camera.getPosition());
+    this->programs.raymarchOnSurface->setMat4ArrayUniformValue("lightSpaceMat", this->lightSpaceMat, SHADOW_CASCADES);
+    this->renderLights(*this->programs.raymarchOnSurface);
+
+    this->programs.raymarchOnSurface->setIntUniformValue("use_shadows", !this->frameGraph.isCulled(this->passes.shadows));
+    this->programs.raymarchOnSurface->setMat4UniformValue("invProjection", this->camera.getInvProjectionMatrix());
+    this->programs.raymarchOnSurface->setMat4UniformValue("invView", this->camera.getInvViewMatrix());
+    this->programs.raymarchOnSurface->setFloatUniformValue("near", this->camera.getNear());
+    this->programs.raymarchOnSurface->setFloatUniformValue("far", this->camera.getFar());
+    this->programs.raymarchOnSurface->setFloatUniformValue("uTime", this->time);
+
+    this->programs.raymarchOnSurface->setIntUniformValue("shadowMap", 0);
+    GlState::bindTexture(0, GL_TEXTURE_2D_ARRAY, this->frameGraph.getTexture(this->targets.shadowDepth));
+    this->programs.raymarchOnSurface->setIntUniformValue("dynamicShadowMap", 3);
+    this->programs.raymarchOnSurface->setIntUniformValue("use_dynamic_shadows", !this->frameGraph.isCulled(this->passes.dynamicShadows));
+    GlState::bindTexture(3, GL_TEXTURE_2D_ARRAY, this->frameGraph.getTexture(this->targets.dynamicShadowDepth));
+
+    this->backend.execute(this->getCommands(eCommandList::raymarchedSurfaces), *this->programs.raymarchOnSurface);
 }
 
-void    Renderer::initRenderbuffer( void ) { 
-    this->renderbuffer.width = this->env->getWindow().width;
-    this->renderbuffer.height = this->env->getWindow().height;
-
-    /* create RenderBuffer */
-    glGenRenderbuffers(1, &this->renderbuffer.id);
-    glBindRenderbuffer(GL_RENDERBUFFER, this->renderbuffer.id);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, this->renderbuffer.width, this->renderbuffer.height);
+void    Renderer::render2Dtexture( void ) {
+    this->programs.texture2D->use();
+    this->programs.texture2D->setMat4ArrayUniformValue("lightSpaceMat", this->lightSpaceMat, SHADOW_CASCADES);
+    this->programs.texture2D->setMat4UniformValue("projection", this->camera.getProjectionMatrix());
+    this->programs.texture2D->setMat4UniformValue("view", this->camera.getViewMatrix());
+    this->programs.texture2D->setFloatUniformValue("near", this->camera.getNear());
+    this->programs.texture2D->setFloatUniformValue("far", this->camera.getFar());
+    this->programs.texture2D->setFloatUniformValue("uTime", this->time);
+
+    this->programs.texture2D->setIntUniformValue("shadowMap", 0);
+    GlState::bindTexture(0, GL_TEXTURE_2D_ARRAY, this->frameGraph.getTexture(this->targets.shadowDepth));
+    this->programs.texture2D->setIntUniformValue("dynamicShadowMap", 3);
+    this->programs.texture2D->setIntUniformValue("use_dynamic_shadows", !this->frameGraph.isCulled(this->passes.dynamicShadows));
+    GlState::bindTexture(3, GL_TEXTURE_2D_ARRAY, this->frameGraph.getTexture(this->targets.dynamicShadowDepth));
+
+    this->backend.execute(this->getCommands(eCommandList::texturedSurfaces), *this->programs.texture2D);
+}
 
-    /* create FrameBuffer, with renderbuffer binded */
-    glGenFramebuffers(1, &this->renderbuffer.fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, this->renderbuffer.fbo);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->renderbuffer.id);
-    /* attach depth-buffer component that is also associated to another FBO (one depth-buffer, multiple Fbos) */
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->depthMap.id, 0);
+/*  resolve the offscreen scene to the default framebuffer (GL_FRAMEBUFFER_SRGB encodes on the way) */
+void    Renderer::renderScreen( void ) {
+    GlState::disable(GL_DEPTH_TEST);
+    this->programs.screen->use();
+    this->programs.screen->setIntUniformValue("screenTexture", 0);
+    GlState::bindTexture(0, GL_TEXTURE_2D, this->frameGraph.getTexture(this->targets.sceneColor));
 
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        return;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    GlState::bindVertexArray(this->screenVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    GlState::enable(GL_DEPTH_TEST);
 }
 
-void    Renderer::initIntermediateTexture( void ) {
-    this->intermediateTexture.width = this->env->getWindow().width;
-    this->intermediateTexture.height = this->env->getWindow().height;
+/*  offline, box filter the supersampled scene to the output resolution and read it back. For
+    y4m the conversion to I420 happens in the same pass, already flipped to the top-down order.
+*/
+void    Renderer::renderCapture( void ) {
+    bool yuv = this->videoCapture->isYuv();
+    Shader* program = (yuv ? this->programs.yuv : this->programs.downsample);
+
+    GlState::disable(GL_DEPTH_TEST);
+    program->use();
+    program->setIntUniformValue("screenTexture", 0);
+    program->setIntUniformValue("factor", this->renderToFile.supersampling);
+    if (yuv)
+        program->setIVec2UniformValue("size", glm::ivec2(this->renderToFile.width, this->renderToFile.height));
+    GlState::bindTexture(0, GL_TEXTURE_2D, this->frameGraph.getTexture(this->targets.sceneColor));
+
+    GlState::bindVertexArray(this->screenVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    GlState::enable(GL_DEPTH_TEST);
+    this->videoCapture->write(!yuv, this->captureFbo);
+}
 
-    glGenFramebuffers(1, &this->intermediateTexture.fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, this->intermediateTexture.fbo);
-    /* create depth texture */
-    glGenTextures(1, &this->intermediateTexture.id);
-    glBindTexture(GL_TEXTURE_2D, this->intermediateTexture.id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, this->intermediateTexture.width, this->intermediateTexture.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+/*  The conditions of the passes, evaluated on the GL thread before the graph runs: a pass is
+    culled while its program is not ready (they compile in the background, see Shader::isReady)
+    or while it has nothing to draw.
+*/
+void    Renderer::updatePasses( void ) {
+    Raymarched* raymarched = this->env->getRaymarched();
+    bool        shadows = (this->useShadows && this->env->getDirectionalLight());
+    bool        objects = (raymarched && raymarched->getObjects().size() != 0);
+    this->frameGraph.setEnabled(this->passes.shadows, shadows && this->programs.shadowMap->isReady());
+    this->frameGraph.setEnabled(this->passes.raymarchedShadows, shadows && objects && this->programs.raymarchShadow->isReady());
+    this->frameGraph.setEnabled(this->passes.dynamicShadows, shadows && this->hasDynamicModels() && this->programs.shadowMap->isReady());
+    this->frameGraph.setEnabled(this->passes.depthPrepass, this->programs.depthPrepass->isReady());
+    this->frameGraph.setEnabled(this->passes.meshes, this->programs.meshes->isReady());
+    this->frameGraph.setEnabled(this->passes.skybox, this->env->getSkybox() != nullptr && this->programs.skybox->isReady());
+    this->frameGraph.setEnabled(this->passes.texturedSurfaces, this->env->getTexturedSurfaces().size() != 0 && this->programs.texture2D->isReady());
+    this->frameGraph.setEnabled(this->passes.raymarchedSurfaces, this->env->getRaymarchedSurfaces().size() != 0 && this->programs.raymarchOnSurface->isReady());
+    this->frameGraph.setEnabled(this->passes.raymarched, objects);
+    if (this->offline)
+        this->frameGraph.setEnabled(this->passes.capture, this->videoCapture->isRecording());
+    this->frameGraph.setEnabled(this->passes.screen, this->programs.screen->isReady());
+}
 
-    // attach depth texture as FBO's color buffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->intermediateTexture.id, 0);
-    
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        return;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+/*  The passes in execution order (order has importance for occlusion). The scene is rendered
+    offscreen in a linear HDR color texture and a depth texture, the raymarch pass samples that
+    depth directly (the graph never attaches a texture that a pass reads).
+    The programs, targets, passes and command lists are resolved to handles here, once: a frame
+    looks nothing up by name.
+*/
+void    Renderer::initFrameGraph( void ) {
+    size_t width = this->env->getWindow().width;
+    size_t height = this->env->getWindow().height;
+    if (this->offline) {
+        width = this->renderToFile.width * this->renderToFile.supersampling;
+        height = this->renderToFile.height * this->renderToFile.supersampling;
+    }
 
-    this->shader["blendTexture"]->use();
-    this->shader["blendTexture"]->setIntUniformValue("tex", 0);
-}
\ No newline at end of file
+    this->programs.meshes = this->shader.at("default");
+    this->programs.skybox = this->shader.at("skybox");
+    this->programs.shadowMap = this->shader.at("shadowMap");
+    this->programs.raymarchOnSurface = this->shader.at("raymarchOnSurface");
+    this->programs.texture2D = this->shader.at("2Dtexture");
+    this->programs.depthPrepass = this->shader.at("depthPrepass");
+    this->programs.screen = this->shader.at("screen");
+    this->programs.raymarchShadow = this->shader.at("raymarchShadow");
+    this->programs.downsample = (this->offline ? this->shader.at("downsample") : nullptr);
+    this->programs.yuv = (this->offline ? this->shader.at("yuv") : nullptr);
+    this->initCommandLists();
+
+    this->targets.shadowDepth = this->frameGraph.addResource("shadowDepth", (tFrameResourceDesc){ SHADOW_CASCADE_SIZE, SHADOW_CASCADE_SIZE, SHADOW_CASCADES, GL_DEPTH_COMPONENT24, false });
+    this->targets.raymarchedShadow = this->frameGraph.addResource("raymarchedShadow", (tFrameResourceDesc){ RAYMARCH_SHADOW_SIZE, RAYMARCH_SHADOW_SIZE, RAYMARCH_MAX_OBJECTS, GL_RGBA16F, false });
+    this->targets.dynamicShadowDepth = this->frameGraph.addResource("dynamicShadowDepth", (tFrameResourceDesc){ SHADOW_DYNAMIC_SIZE, SHADOW_DYNAMIC_SIZE, SHADOW_CASCADES, GL_DEPTH_COMPONENT24, true });
+    this->targets.sceneColor = this->frameGraph.addResource("sceneColor", (tFrameResourceDesc){ width, height, 1, GL_RGBA16F, true });
+    this->targets.sceneDepth = this->frameGraph.addResource("sceneDepth", (tFrameResourceDesc){ width, height, 1, GL_DEPTH_COMPONENT24, true });
+    this->targets.backbuffer = this->frameGraph.importResource("backbuffer", 0, this->env->getWindow().width, this->env->getWindow().height);
+    if (this->offline)
+        this->targets.capture = this->frameGraph.importResource("capture", this->captureFbo, this->renderToFile.width,
+            this->renderToFile.height * (this->videoCapture->isYuv() ? 3 : 2) / 2);
+
+    this->passes.shadows = this->frameGraph.addPass((tFramePass){ "shadows", {}, { "shadowDepth" },
+        [this]( void ) { this->updateShadowDepthMap(); }
+    });
+    this->passes.raymarchedShadows = this->frameGraph.addPass((tFramePass){ "raymarchedShadows", {}, { "raymarchedShadow" },
+        [this]( void ) { this->updateRaymarchedShadowMap(); }
+    });
+    this->passes.dynamicShadows = this->frameGraph.addPass((tFramePass){ "dynamicShadows", {}, { "dynamicShadowDepth" },
+        [this]( void ) { this->updateDynamicShadowDepthMap(); }
+    });
+    this->passes.depthPrepass = this->frameGraph.addPass((tFramePass){ "depthPrepass", {}, { "sceneDepth" },
+        [this]( void ) { this->renderDepthPrepass(); }
+    });
+    this->passes.meshes = this->frameGraph.addPass((tFramePass){ "meshes", { "shadowDepth", "dynamicShadowDepth" }, { "sceneColor", "sceneDepth" },
+        [this]( void ) { this->renderMeshes(); }
+    });
+    this->passes.skybox = this->frameGraph.addPass((tFramePass){ "skybox", {}, { "sceneColor", "sceneDepth" },
+        [this]( void ) { this->renderSkybox(); }
+    });
+    this->passes.texturedSurfaces = this->frameGraph.addPass((tFramePass){ "texturedSurfaces", { "shadowDepth", "dynamicShadowDepth" }, { "sceneColor", "sceneDepth" },
+        [this]( void ) { this->render2Dtexture(); }
+    });
+    this->passes.raymarchedSurfaces = this->frameGraph.addPass((tFramePass){ "raymarchedSurfaces", { "shadowDepth", "dynamicShadowDepth" }, { "sceneColor", "sceneDepth" },
+        [this]( void ) { this->renderRaymarchedSurfaces(); }
+    });
+    this->passes.raymarched = this->frameGraph.addPass((tFramePass){ "raymarched", { "sceneDepth", "shadowDepth", "dynamicShadowDepth", "raymarchedShadow" }, { "sceneColor" },
+        [this]( void ) { this->renderRaymarched(); }
+    });
+    if (this->offline)
+        this->passes.capture = this->frameGraph.addPass((tFramePass){ "capture", { "sceneColor" }, { "capture" },
+            [this]( void ) { this->renderCapture(); }
+        });
+    this->passes.screen = this->frameGraph.addPass((tFramePass){ "screen", { "sceneColor" }, { "backbuffer" },
+        [this]( void ) { this->renderScreen(); }
+    });
+    this->frameGraph.setTimer(&this->gpuTimer);
+    this->updatePasses();
+    this->frameGraph.compile();
+    this->frameGraph.realize();
+}
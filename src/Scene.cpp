@@ -0,0 +1,178 @@
+#include "Scene.hpp"
+
+Scene::Scene( const std::string& filename ) : filename(filename), ifs(filename), line(0) {
+    if (!this->ifs.is_open())
+        throw Exception::InitError("could not open scene " + filename);
+}
+
+Scene::~Scene( void ) {
+}
+
+static bool         readVec3( std::istream& is, glm::vec3& v ) {
+    return (static_cast<bool>(is >> v.x >> v.y >> v.z));
+}
+
+static const char*  objectNames[] = { "mandelbox", "mandelbulb", "ifs", "marble", "cloud", "blob" };
+
+/*  reads the next entry of the file, returns false at the end of the scene */
+bool    Scene::next( tSceneEntry& entry ) {
+    std::string str;
+    while (std::getline(this->ifs, str)) {
+        this->line++;
+        size_t first = str.find_first_not_of(" \t\r");
+        if (first == std::string::npos || str[first] == '#')
+            continue;
+        std::istringstream  iss(str);
+        std::string         keyword;
+        iss >> keyword;
+        entry.name.clear();
+        entry.paths.clear();
+        entry.scale = glm::vec3(1.0f);
+        entry.line = this->line;
+        this->parse(keyword, iss, entry);
+        if (iss >> str)
+            throw Exception::InitError(this->error("unexpected \"" + str + "\""));
+        return (true);
+    }
+    return (false);
+}
+
+void    Scene::parse( const std::string& keyword, std::istringstream& iss, tSceneEntry& entry ) {
+    std::string str;
+    if (keyword == "environment" || keyword == "skybox") {
+        entry.type = (keyword == "skybox" ? eSceneEntry::skybox : eSceneEntry::environment);
+        while (entry.paths.size() < 6 && iss >> str)
+            entry.paths.push_back(str);
+        if (entry.paths.size() != 6)
+            throw Exception::InitError(this->error(keyword + " needs the 6 faces of a cubemap"));
+    }
+    else if (keyword == "noise") {
+        entry.type = eSceneEntry::noise;
+        if (!(iss >> str))
+            throw Exception::InitError(this->error("noise needs a texture"));
+        entry.paths.push_back(str);
+    }
+    else if (keyword == "model" || keyword == "instance" || keyword == "billboard") {
+        entry.type = (keyword == "model" ? eSceneEntry::model : (keyword == "instance" ? eSceneEntry::instance : eSceneEntry::billboard));
+        if (entry.type != eSceneEntry::billboard && !(iss >> entry.name))
+            throw Exception::InitError(this->error(keyword + " needs a name"));
+        if (entry.type == eSceneEntry::model) {
+            if (!(iss >> str))
+                throw Exception::InitError(this->error("model needs a file"));
+            entry.paths.push_back(str);
+        }
+        if (!readVec3(iss, entry.position) || !readVec3(iss, entry.orientation) || !readVec3(iss, entry.scale))
+            throw Exception::InitError(this->error(keyword + " needs a position, an orientation and a scale"));
+    }
+    else if (keyword == "raymarched") {
+        entry.type = eSceneEntry::raymarched;
+        iss >> str;
+        size_t id = 0;
+        while (id < 6 && str != objectNames[id])
+            id++;
+        if (id == 6)
+            throw Exception::InitError(this->error("unknown raymarched object \"" + str + "\""));
+        tObject& object = entry.object;
+        object.id = static_cast<eRaymarchObject>(id);
+        if (!readVec3(iss, object.position) || !readVec3(iss, object.orientation)
+            || !(iss >> object.scale >> object.boundingSphereScale >> object.speedMod)
+            || !readVec3(iss, object.material.ambient) || !readVec3(iss, object.material.diffuse) || !readVec3(iss, object.material.specular)
+            || !(iss >> object.material.shininess >> object.material.opacity))
+            throw Exception::InitError(this->error("malformed raymarched object"));
+        entry.position = object.position;
+        entry.orientation = object.orientation;
+    }
+    else if (keyword == "surface") {
+        iss >> str;
+        if (str != "raymarched" && str != "textured")
+            throw Exception::InitError(this->error("surface is either raymarched or textured"));
+        entry.type = (str == "textured" ? eSceneEntry::texturedSurface : eSceneEntry::surface);
+        if (!readVec3(iss, entry.position) || !readVec3(iss, entry.orientation) || !readVec3(iss, entry.scale))
+            throw Exception::InitError(this->error("surface needs a position, an orientation and a scale"));
+    }
+    else if (keyword == "light") {
+        entry.type = eSceneEntry::light;
+        iss >> str;
+        if (str != "directional" && str != "point")
+            throw Exception::InitError(this->error("light is either directional or point"));
+        entry.lightType = (str == "point" ? eLightType::point : eLightType::directional);
+        if (!readVec3(iss, entry.position) || !readVec3(iss, entry.ambient) || !readVec3(iss, entry.diffuse) || !readVec3(iss, entry.specular))
+            throw Exception::InitError(this->error("light needs a position, an ambient, a diffuse and a specular color"));
+        entry.attenuation = glm::vec3(1.0f, 0.09f, 0.032f);
+        if (entry.lightType == eLightType::point && !(iss >> std::ws).eof() && !readVec3(iss, entry.attenuation))
+            throw Exception::InitError(this->error("malformed point light attenuation"));
+    }
+    else
+        throw Exception::InitError(this->error("unknown entry \"" + keyword + "\""));
+}
+
+std::string     Scene::error( const std::string& message ) const {
+    return (this->filename + ":" + std::to_string(this->line) + ": " + message);
+}
+
+/*  Synthetic stress scene: the inn, a grid of crystal stands around it (one model, every other
+    stand an instance sharing its meshes) and raymarched exhibits on the stands closest to the
+    center. The same seed always generates the same scene.
+*/
+void    Scene::generate( const std::string& filename, size_t instances, size_t exhibits, unsigned int seed ) {
+    /* default look of each object type, as in the gallery: scale, bounding sphere scale, speed modifier, height above the stand, specular, shininess */
+    static const float  looks[6][6] = {
+        { 0.5f, 2.0f, 0.015f, 2.75f, 1.0f, 256.0f },
+        { 1.0f, 1.15f, 0.1f, 3.5f, 0.35f, 82.0f },
+        { 0.5f, 3.0f, 0.03f, 3.85f, 0.35f, 128.0f },
+        { 1.0f, 1.0f, 1.0f, 3.25f, 1.0f, 2048.0f },
+        { 2.0f, 1.0f, 1.0f, 4.2f, 0.0f, 1.0f },
+        { 0.5f, 2.5f, 1.0f, 2.75f, 2.0f, 1024.0f },
+    };
+    const float         spacing = 8.0f;     // between the stands, more than twice the largest bounding sphere
+    const float         clearing = 40.0f;   // no stand inside the inn
+    std::ofstream       ofs(filename);
+    std::mt19937        rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    if (!ofs.is_open())
+        throw Exception::InitError("could not write scene " + filename);
+    instances = std::max(instances, exhibits);
+    ofs << "# generated stress scene: " << instances << " stands, " << exhibits << " exhibits, seed " << seed << std::endl;
+    ofs << "environment ./resource/CloudyLightRays/CloudyLightRaysLeft2048.png ./resource/CloudyLightRays/CloudyLightRaysRight2048.png"
+        << " ./resource/CloudyLightRays/CloudyLightRaysUp2048.png ./resource/CloudyLightRays/CloudyLightRaysDown2048.png"
+        << " ./resource/CloudyLightRays/CloudyLightRaysFront2048.png ./resource/CloudyLightRays/CloudyLightRaysBack2048.png" << std::endl;
+    ofs << "skybox ./resource/ThickCloudsWater/ThickCloudsWaterLeft2048.png ./resource/ThickCloudsWater/ThickCloudsWaterRight2048.png"
+        << " ./resource/ThickCloudsWater/ThickCloudsWaterUp2048.png ./resource/ThickCloudsWater/ThickCloudsWaterDown2048.png"
+        << " ./resource/ThickCloudsWater/ThickCloudsWaterFront2048.png ./resource/ThickCloudsWater/ThickCloudsWaterBack2048.png" << std::endl;
+    ofs << "noise ./resource/RGBAnoiseMedium.png" << std::endl;
+    ofs << "light directional 30 30 18  0.05775 0.066 0.075  1 0.964 0.77  1 1 1" << std::endl;
+    ofs << "model inn ./resource/models/Inn/theInn.FBX.obj  0 2 0  0 0 0  75 75 75" << std::endl;
+
+    /* the cells of a square grid sorted by distance to the center, the first ones get the exhibits */
+    std::vector<glm::vec2>  cells;
+    int                     side = 1;
+    while (cells.size() < instances) {
+        cells.clear();
+        side += 2;
+        for (int x = -side / 2; x <= side / 2; ++x)
+            for (int z = -side / 2; z <= side / 2; ++z)
+                if (glm::length(glm::vec2(x, z) * spacing) > clearing)
+                    cells.push_back(glm::vec2(x, z) * spacing);
+    }
+    std::stable_sort(cells.begin(), cells.end(), []( const glm::vec2& a, const glm::vec2& b ) {
+        return (glm::length(a) < glm::length(b));
+    });
+    for (size_t i = 0; i < instances; ++i) {
+        float yaw = unit(rng) * 6.2831853f;
+        float scale = 2.0f + unit(rng);
+        ofs << (i == 0 ? "model crystal ./resource/models/Crystal/crystal.obj  " : "instance crystal  ")
+            << cells[i].x << " -0.75 " << cells[i].y << "  0 " << yaw << " 0  "
+            << scale << " " << scale << " " << scale << std::endl;
+        if (i >= exhibits)
+            continue;
+        size_t          type = static_cast<size_t>(unit(rng) * 6.0f) % 6;
+        const float*    look = looks[type];
+        ofs << "raymarched " << objectNames[type] << "  " << cells[i].x << " " << -0.75f + look[3] * scale / 2.5f << " " << cells[i].y
+            << "  0 0 0  " << look[0] << " " << look[1] << " " << look[2]
+            << "  0 0 0  " << unit(rng) << " " << unit(rng) << " " << unit(rng)
+            << "  " << look[4] << " " << look[4] << " " << look[4] << "  " << look[5] << " 1" << std::endl;
+    }
+    if (exhibits > RAYMARCH_MAX_OBJECTS)
+        std::cout << "scene: " << exhibits << " exhibits, only the " << RAYMARCH_MAX_OBJECTS << " closest to the center fit in the raymarch shaders" << std::endl;
+}
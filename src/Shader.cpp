@@ -1,27 +1,347 @@
 #include "Shader.hpp"
 
-Shader::Shader( const std::string& vertexShader, const std::string& fragmentShader ) {
-    std::string vSrc = getFromFile(vertexShader);
-    std::string fSrc = getFromFile(fragmentShader);
+std::string Shader::binaryCache = "";
+std::unordered_map<std::string, tShaderSource> Shader::sources;
+std::unordered_map<tUniformId, std::string> Shader::uniformNames;
 
-    GLuint vertShader = this->create(vSrc.c_str(), GL_VERTEX_SHADER);
-    GLuint fragShader = this->create(fSrc.c_str(), GL_FRAGMENT_SHADER);
-    this->id = this->createProgram({{ vertShader, fragShader }});
+Shader::Shader( const std::string& vertexShader, const std::string& fragmentShader ) :
+vertexShader(vertexShader), fragmentShader(fragmentShader), reloaded(nullptr) {
+    this->load(vertexShader, fragmentShader, {});
+}
+
+/*  a permutation of the shader, each define is a "NAME" or "NAME VALUE" string */
+Shader::Shader( const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines ) :
+vertexShader(vertexShader), fragmentShader(fragmentShader), defines(defines), reloaded(nullptr) {
+    this->load(vertexShader, fragmentShader, defines);
 }
 
 Shader::~Shader( void ) {
+    for (std::forward_list<GLuint>::const_iterator it = this->pending.begin(); it != this->pending.end(); ++it)
+        glDeleteShader(*it);
+    if (this->reloaded)
+        delete this->reloaded;
+}
+
+bool    Shader::dependsOn( const std::vector<std::string>& filenames ) const {
+    for (size_t i = 0; i < filenames.size(); ++i)
+        if (this->dependencies.count(filenames[i]))
+            return (true);
+    return (false);
+}
+
+/*  compile the sources again in the background, the current program keeps being used until
+    update() swaps the new one in. Sources that cannot be resolved (a missing or malformed
+    #include) are reported and the current program kept, like a compilation error.
+*/
+void    Shader::reload( void ) {
+    if (this->reloaded) {
+        GlState::deleteProgram(this->reloaded->id);
+        delete this->reloaded;
+        this->reloaded = nullptr;
+    }
+    try {
+        this->reloaded = new Shader(this->vertexShader, this->fragmentShader, this->defines);
+    }
+    catch (const Exception::ShaderError& err) {
+        std::cout << err.what() << std::endl;
+    }
+}
+
+/*  Called between frames: once the reloaded program is ready it replaces the current one (and
+    its uniform locations and the files it includes with it, an edit may have added an #include).
+    A program that fails to compile is discarded and the current one kept. Returns true when the
+    program changed.
+*/
+bool    Shader::update( void ) {
+    if (!this->reloaded)
+        return (false);
+    try {
+        if (!this->reloaded->isReady())
+            return (false);
+    }
+    catch (const Exception::ShaderError& err) {
+        std::cout << err.what() << std::endl;
+        /* fixing the error in a newly included file must trigger a reload too */
+        this->dependencies.insert(this->reloaded->dependencies.begin(), this->reloaded->dependencies.end());
+        GlState::deleteProgram(this->reloaded->id);
+        delete this->reloaded;
+        this->reloaded = nullptr;
+        return (false);
+    }
+    GlState::deleteProgram(this->id);
+    this->id = this->reloaded->id;
+    this->fromBinaryCache = this->reloaded->fromBinaryCache;
+    this->uniformLocations.swap(this->reloaded->uniformLocations);
+    this->dependencies.swap(this->reloaded->dependencies);
+    delete this->reloaded;
+    this->reloaded = nullptr;
+    return (true);
+}
+
+/*  programs created after this call are saved in the directory and loaded back from it instead
+    of compiled the next runs (needs ARB_get_program_binary, core since 4.1).
+*/
+void    Shader::setBinaryCache( const std::string& directory ) {
+    if (!directory.empty())
+        mkdir(directory.c_str(), 0755);
+    Shader::binaryCache = (GLAD_GL_ARB_get_program_binary ? directory : "");
+}
+
+/*  lets the driver compile and link on its own threads, the status of the programs created after
+    this call is then only checked once they are done (see isReady)
+*/
+void    Shader::setParallelCompile( void ) {
+    if (GLAD_GL_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+}
+
+/*  FNV-1a, stable across runs and platforms unlike std::hash */
+static uint64_t hashString( const std::string& str, uint64_t hash = 14695981039346656037ULL ) {
+    for (size_t i = 0; i < str.size(); ++i)
+        hash = (hash ^ static_cast<unsigned char>(str[i])) * 1099511628211ULL;
+    return (hash);
+}
+
+/*  A binary is only valid for the exact sources and the driver that produced it, so the cache
+    key hashes both. The driver may still refuse a binary, then the sources are compiled again.
+    The compilation is only issued here, querying its status would wait for it to complete.
+*/
+void    Shader::load( const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines ) {
+    const tShaderSource& vSource = Shader::getSource(vertexShader);
+    const tShaderSource& fSource = Shader::getSource(fragmentShader);
+    std::string vSrc = this->addDefines(vSource.code, defines);
+    std::string fSrc = this->addDefines(fSource.code, defines);
+
+    this->dependencies = { vertexShader, fragmentShader };
+    this->dependencies.insert(vSource.dependencies.begin(), vSource.dependencies.end());
+    this->dependencies.insert(fSource.dependencies.begin(), fSource.dependencies.end());
+
+    this->fromBinaryCache = false;
+    this->ready = false;
+    this->binaryKey = 0;
+    if (!Shader::binaryCache.empty()) {
+        std::stringstream ss;
+        uint64_t key = hashString(vSrc + '\0' + fSrc);
+        key = hashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), key);
+        key = hashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), key);
+        key = hashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), key);
+        ss << Shader::binaryCache << "/" << std::hex << key << ".bin";
+        if (this->loadBinary(ss.str(), key)) {
+            this->fromBinaryCache = true;
+            this->ready = true;
+            this->resolveUniforms();
+            return;
+        }
+        this->binaryFile = ss.str();
+        this->binaryKey = key;
+    }
+    this->pending.push_front(this->create(fSrc.c_str(), GL_FRAGMENT_SHADER));
+    this->pending.push_front(this->create(vSrc.c_str(), GL_VERTEX_SHADER));
+    this->id = this->createProgram(this->pending, !this->binaryFile.empty());
+}
+
+/*  Without KHR_parallel_shader_compile the first call waits for the program, so the renderer
+    should only ask once everything has been issued. Compilation errors are thrown from here.
+*/
+bool    Shader::isReady( void ) {
+    if (this->ready)
+        return (true);
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(this->id, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed)
+            return (false);
+    }
+    this->finish();
+    return (true);
+}
+
+void    Shader::finish( void ) {
+    GLint   success;
+    GLint   shaderType;
+    for (std::forward_list<GLuint>::const_iterator it = this->pending.begin(); it != this->pending.end(); ++it) {
+        glGetShaderiv(*it, GL_COMPILE_STATUS, &success);
+        glGetShaderiv(*it, GL_SHADER_TYPE, &shaderType);
+        this->isCompilationSuccess(*it, success, shaderType);
+    }
+    glGetProgramiv(this->id, GL_LINK_STATUS, &success);
+    this->isCompilationSuccess(this->id, success, -1);
+    for (std::forward_list<GLuint>::const_iterator it = this->pending.begin(); it != this->pending.end(); ++it) {
+        glDetachShader(this->id, *it);
+        glDeleteShader(*it);
+    }
+    this->pending.clear();
+    if (!this->binaryFile.empty())
+        this->saveBinary(this->binaryFile, this->binaryKey);
+    this->ready = true;
+    this->resolveUniforms();
+}
+
+/*  The locations of every active uniform by the hash of its name, so that setting one never
+    builds or compares a string. An array is listed as "name[0]" with its size, its elements and
+    the array itself ("name", for the setters of whole arrays) are added. The members of arrays
+    of structures are listed one by one ("object[2].scale").
+*/
+void    Shader::resolveUniforms( void ) {
+    GLint   count = 0;
+    GLchar  name[256];
+    GLsizei length;
+    GLint   size;
+    GLenum  type;
+    this->uniformLocations.clear();
+    glGetProgramiv(this->id, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint u = 0; u < count; ++u) {
+        glGetActiveUniform(this->id, u, sizeof(name), &length, &size, &type, name);
+        std::string str(name, length);
+        std::vector<std::string> names(1, str);
+        if (str.size() > 3 && str.compare(str.size() - 3, 3, "[0]") == 0) {
+            std::string base = str.substr(0, str.size() - 3);
+            names.push_back(base);
+            for (GLint e = 1; e < size; ++e)
+                names.push_back(base + "[" + std::to_string(e) + "]");
+        }
+        for (size_t n = 0; n < names.size(); ++n) {
+            tUniformId id = uniformId(names[n]);
+            this->uniformLocations[id] = glGetUniformLocation(this->id, names[n].c_str());
+            Shader::uniformNames[id] = names[n];
+        }
+    }
+}
+
+/*  the defines must come right after the #version directive */
+std::string Shader::addDefines( const std::string& source, const std::vector<std::string>& defines ) {
+    if (defines.empty())
+        return (source);
+    std::string lines;
+    for (size_t i = 0; i < defines.size(); ++i)
+        lines += "#define " + defines[i] + "\n";
+    size_t pos = source.find("#version");
+    if (pos == std::string::npos)
+        return (lines + source);
+    pos = source.find('\n', pos);
+    if (pos == std::string::npos)
+        return (source + "\n" + lines);
+    return (source.substr(0, pos + 1) + lines + source.substr(pos + 1));
+}
+
+/*  The binary file holds the key it was built for (guarding against hash collisions on the file
+    name), the binary format and the program binary.
+*/
+bool    Shader::loadBinary( const std::string& binaryFile, uint64_t key ) {
+    std::ifstream   ifs(binaryFile, std::ios::binary);
+    uint64_t        fileKey;
+    GLenum          format;
+    GLint           length;
+    GLint           success;
+    if (!ifs.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey)) || fileKey != key)
+        return (false);
+    if (!ifs.read(reinterpret_cast<char*>(&format), sizeof(format)) || !ifs.read(reinterpret_cast<char*>(&length), sizeof(length)))
+        return (false);
+    std::vector<char> binary(length);
+    if (!ifs.read(binary.data(), length))
+        return (false);
+    this->id = glCreateProgram();
+    glProgramBinary(this->id, format, binary.data(), length);
+    glGetProgramiv(this->id, GL_LINK_STATUS, &success);
+    if (!success)
+        GlState::deleteProgram(this->id);
+    return (success);
+}
+
+void    Shader::saveBinary( const std::string& binaryFile, uint64_t key ) {
+    GLint   length = 0;
+    GLenum  format;
+    glGetProgramiv(this->id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> binary(length);
+    glGetProgramBinary(this->id, length, nullptr, &format, binary.data());
+    std::ofstream ofs(binaryFile, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    ofs.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    ofs.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    ofs.write(binary.data(), length);
 }
 
 void    Shader::use( void ) const {
-    glUseProgram(this->id);
+    GlState::useProgram(this->id);
 }
 
 /*  we load the content of a file in a string (we need that because the shader compilation is done at
     runtime and glCompileShader expects a <const GLchar *> value)
 */
 std::string   Shader::getFromFile( const std::string& filename ) {
+    return (Shader::getSource(filename).code);
+}
+
+/*  the sources are resolved once and shared by all the programs (and permutations) using them */
+const tShaderSource&    Shader::getSource( const std::string& filename ) {
+    auto it = Shader::sources.find(filename);
+    if (it != Shader::sources.end())
+        return (it->second);
+    tShaderSource source;
+    source.code = Shader::resolveIncludes(filename, source.dependencies, 0);
+    return (Shader::sources[filename] = source);
+}
+
+/*  drop the resolved sources of the file and of every file including it */
+void    Shader::invalidateSource( const std::string& filename ) {
+    for (auto it = Shader::sources.begin(); it != Shader::sources.end(); ) {
+        if (it->first == filename || it->second.dependencies.count(filename))
+            it = Shader::sources.erase(it);
+        else
+            it++;
+    }
+}
+
+/*  "a/b/../c/./d" -> "a/c/d", so that includes name files the way the watcher does */
+static std::string  normalizePath( const std::string& path ) {
+    std::vector<std::string>    parts;
+    std::stringstream           ss(path);
+    std::string                 part;
+    while (std::getline(ss, part, '/')) {
+        if (part == ".." && !parts.empty() && parts.back() != "." && parts.back() != "..")
+            parts.pop_back();
+        else if (part != "." || parts.empty())
+            parts.push_back(part);
+    }
+    std::string result;
+    for (size_t i = 0; i < parts.size(); ++i)
+        result += (i ? "/" : "") + parts[i];
+    return (result);
+}
+
+/*  Replace the `#include "file"` lines by the content of the file (relative to the including one).
+    A file is only included once per source, like with #pragma once. The #line directives number
+    the included files in order of inclusion, so that compilation errors point at the right line.
+*/
+std::string Shader::resolveIncludes( const std::string& filename, std::set<std::string>& included, int sourceId ) {
     std::ifstream   ifs(filename);
-    std::string     content((std::istreambuf_iterator<char>(ifs)), (std::istreambuf_iterator<char>()));
+    std::string     line;
+    std::string     content;
+    size_t          lineNumber = 0;
+    if (!ifs.is_open() && sourceId != 0)
+        throw Exception::ShaderError(-1, "cannot open included file " + filename);
+    std::string directory = filename.substr(0, filename.find_last_of('/') + 1);
+    while (std::getline(ifs, line)) {
+        lineNumber++;
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+            content += line + "\n";
+            continue;
+        }
+        size_t first = line.find('"', start);
+        size_t last = line.find('"', first + 1);
+        if (first == std::string::npos || last == std::string::npos)
+            throw Exception::ShaderError(-1, "malformed #include in " + filename + ": " + line);
+        std::string file = normalizePath(directory + line.substr(first + 1, last - first - 1));
+        if (included.count(file))
+            continue;
+        included.insert(file);
+        content += "#line 1 " + std::to_string(included.size()) + "\n";
+        content += Shader::resolveIncludes(file, included, included.size());
+        content += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceId) + "\n";
+    }
     return (content);
 }
 
@@ -29,29 +349,23 @@ std::string   Shader::getFromFile( const std::string& filename ) {
     and it returns the id to the created shader (the shader object is allocated by OpenGL in the back)
 */
 GLuint  Shader::create( const char* shaderSource, GLenum shaderType ) {
-	GLint success;
 	GLuint shader = glCreateShader(shaderType);
 	glShaderSource(shader, 1, &shaderSource, nullptr);
 	glCompileShader(shader);
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    this->isCompilationSuccess(shader, success, shaderType);
 	return (shader);
 }
 
 /*  here we create the shader program that will be used to render our objects. It takes a list of shaders
-    that will instruct the GPU how to manage the vertices, etc... and we delete the compiled shaders at the
-    end because we no longer need them. We return the id of the created shader program.
+    that will instruct the GPU how to manage the vertices, etc... The compiled shaders are deleted once the
+    program is ready (see finish) because we no longer need them. We return the id of the created shader program.
 */
-GLuint  Shader::createProgram( const std::forward_list<GLuint>& shaders ) {
-	GLint success;
+GLuint  Shader::createProgram( const std::forward_list<GLuint>& shaders, bool retrievable ) {
 	GLuint shaderProgram = glCreateProgram();
+    if (retrievable)
+        glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     for (std::forward_list<GLuint>::const_iterator it = shaders.begin(); it != shaders.end(); ++it)
         glAttachShader(shaderProgram, *it);
 	glLinkProgram(shaderProgram);
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    this->isCompilationSuccess(shaderProgram, success, -1);
-    for (std::forward_list<GLuint>::const_iterator it = shaders.begin(); it != shaders.end(); ++it)
-        glDeleteShader(*it);
 	return (shaderProgram);
 }
 
@@ -72,35 +386,45 @@ void    Shader::isCompilationSuccess( GLint handle, GLint success, int shaderTyp
 /*  find the uniform location in the shader and store it in an unordered_map.
     next time we want to use it we just have to get the location from the map
 */
-unsigned int    Shader::getUniformLocation( const std::string& name ) {
-    if (this->uniformLocations.find(name) != this->uniformLocations.end())
-        return (this->uniformLocations[name]);
-    unsigned int newLoc = glGetUniformLocation(this->id, name.c_str());
-    this->uniformLocations[name] = newLoc;
-    return (newLoc);
+/*  -1 for the uniforms the program does not use (or not linked yet), which GL ignores */
+GLint   Shader::getUniformLocation( tUniformId id ) const {
+    auto it = this->uniformLocations.find(id);
+    return (it != this->uniformLocations.end() ? it->second : -1);
 }
 
-void    Shader::setIntUniformValue( const std::string& name, const int i ) {
-    glUniform1i(getUniformLocation(name), i);
+const std::string&  Shader::getUniformName( tUniformId id ) {
+    static const std::string unknown = "?";
+    auto it = Shader::uniformNames.find(id);
+    return (it != Shader::uniformNames.end() ? it->second : unknown);
+}
+
+void    Shader::setIntUniformValue( const tUniformName& name, const int i ) {
+    glUniform1i(getUniformLocation(name.id), i);
+}
+void    Shader::setFloatUniformValue( const tUniformName& name, const float f ) {
+    glUniform1f(getUniformLocation(name.id), f);
+}
+void    Shader::setMat2UniformValue( const tUniformName& name, const glm::mat2& m ) {
+    glUniformMatrix2fv(getUniformLocation(name.id), 1, GL_FALSE, glm::value_ptr(m));
 }
-void    Shader::setFloatUniformValue( const std::string& name, const float f ) {
-    glUniform1f(getUniformLocation(name), f);
+void    Shader::setMat3UniformValue( const tUniformName& name, const glm::mat3& m ) {
+    glUniformMatrix3fv(getUniformLocation(name.id), 1, GL_FALSE, glm::value_ptr(m));
 }
-void    Shader::setMat2UniformValue( const std::string& name, const glm::mat2& m ) {
-    glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(m));
+void    Shader::setMat4UniformValue( const tUniformName& name, const glm::mat4& m ) {
+    glUniformMatrix4fv(getUniformLocation(name.id), 1, GL_FALSE, glm::value_ptr(m));
 }
-void    Shader::setMat3UniformValue( const std::string& name, const glm::mat3& m ) {
-    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(m));
+void    Shader::setMat4ArrayUniformValue( const tUniformName& name, const glm::mat4* m, size_t count ) {
+    glUniformMatrix4fv(getUniformLocation(name.id), count, GL_FALSE, glm::value_ptr(m[0]));
 }
-void    Shader::setMat4UniformValue( const std::string& name, const glm::mat4& m ) {
-    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(m));
+void    Shader::setVec2UniformValue( const tUniformName& name, const glm::vec2& v ) {
+    glUniform2fv(getUniformLocation(name.id), 1, glm::value_ptr(v));
 }
-void    Shader::setVec2UniformValue( const std::string& name, const glm::vec2& v ) {
-    glUniform2fv(getUniformLocation(name), 1, glm::value_ptr(v));
+void    Shader::setIVec2UniformValue( const tUniformName& name, const glm::ivec2& v ) {
+    glUniform2iv(getUniformLocation(name.id), 1, glm::value_ptr(v));
 }
-void    Shader::setVec3UniformValue( const std::string& name, const glm::vec3& v ) {
-    glUniform3fv(getUniformLocation(name), 1, glm::value_ptr(v));
+void    Shader::setVec3UniformValue( const tUniformName& name, const glm::vec3& v ) {
+    glUniform3fv(getUniformLocation(name.id), 1, glm::value_ptr(v));
 }
-void    Shader::setVec4UniformValue( const std::string& name, const glm::vec4& v ) {
-    glUniform4fv(getUniformLocation(name), 1, glm::value_ptr(v));
+void    Shader::setVec4UniformValue( const tUniformName& name, const glm::vec4& v ) {
+    glUniform4fv(getUniformLocation(name.id), 1, glm::value_ptr(v));
 }
@@ -0,0 +1,92 @@
+#include "ShaderVariants.hpp"
+
+ShaderVariants::ShaderVariants( const std::string& vertexShader, const std::string& fragmentShader ) :
+vertexShader(vertexShader), fragmentShader(fragmentShader), generation(0) {
+}
+
+ShaderVariants::~ShaderVariants( void ) {
+    for (auto it = this->variants.begin(); it != this->variants.end(); it++)
+        delete it->second.shader;
+}
+
+Shader* ShaderVariants::get( std::vector<std::string> defines ) {
+    std::sort(defines.begin(), defines.end());
+    std::string key;
+    for (size_t i = 0; i < defines.size(); ++i)
+        key += defines[i] + ";";
+    auto it = this->variants.find(key);
+    if (it != this->variants.end())
+        return (it->second.shader);
+    tShaderVariant& variant = this->variants[key];
+    variant.shader = nullptr;
+    variant.defines = defines;
+    variant.failed = false;
+    this->compile(variant);
+    return (variant.shader);
+}
+
+void    ShaderVariants::compile( tShaderVariant& variant ) {
+    try {
+        variant.shader = new Shader(this->vertexShader, this->fragmentShader, variant.defines);
+    }
+    catch (const Exception::ShaderError& err) {
+        this->fail(variant, err);
+    }
+}
+
+void    ShaderVariants::fail( tShaderVariant& variant, const Exception::ShaderError& err ) {
+    std::cout << err.what() << std::endl;
+    variant.failed = true;
+    if (variant.shader)
+        this->failed.insert(variant.shader);
+}
+
+/*  every variant using one of the files is recompiled (see Shader::reload), the failed ones are
+    created again whatever changed
+*/
+void    ShaderVariants::reload( const std::vector<std::string>& filenames ) {
+    for (auto it = this->variants.begin(); it != this->variants.end(); it++) {
+        tShaderVariant& variant = it->second;
+        if (variant.failed) {
+            this->failed.erase(variant.shader);
+            delete variant.shader;
+            variant.shader = nullptr;
+            variant.failed = false;
+            this->compile(variant);
+            this->generation++;
+        }
+        else if (variant.shader->dependsOn(filenames))
+            variant.shader->reload();
+    }
+}
+
+void    ShaderVariants::update( void ) {
+    for (auto it = this->variants.begin(); it != this->variants.end(); it++)
+        if (!it->second.failed)
+            it->second.shader->update();
+}
+
+/*  false while the variant compiles, and once it failed */
+bool    ShaderVariants::isReady( Shader* variant ) {
+    if (!variant || this->failed.find(variant) != this->failed.end())
+        return (false);
+    try {
+        return (variant->isReady());
+    }
+    catch (const Exception::ShaderError& err) {
+        for (auto it = this->variants.begin(); it != this->variants.end(); it++)
+            if (it->second.shader == variant)
+                this->fail(it->second, err);
+        return (false);
+    }
+}
+
+bool    ShaderVariants::isReady( void ) {
+    bool ready = true;
+    for (auto it = this->variants.begin(); it != this->variants.end(); it++) {
+        tShaderVariant& variant = it->second;
+        if (!variant.failed && !this->isReady(variant.shader))
+            ready = ready && variant.failed;    // it failed just now
+    }
+    return (ready);
+}
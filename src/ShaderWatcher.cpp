@@ -0,0 +1,63 @@
+#include "ShaderWatcher.hpp"
+
+ShaderWatcher::ShaderWatcher( const std::string& directory, size_t intervalMs ) :
+directory(directory), interval(intervalMs), running(true) {
+    this->scan(this->directory, false);
+    this->thread = std::thread(&ShaderWatcher::watch, this);
+}
+
+ShaderWatcher::~ShaderWatcher( void ) {
+    this->running = false;
+    if (this->thread.joinable())
+        this->thread.join();
+}
+
+/*  the files modified since the last call, paths are given as "<directory>/<file>" which is how
+    the renderer names the shaders it loads
+*/
+std::vector<std::string>    ShaderWatcher::getChanges( void ) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::vector<std::string> changes(this->changes.begin(), this->changes.end());
+    this->changes.clear();
+    return (changes);
+}
+
+/*  there is no inotify on macOS (and kqueue needs a descriptor per file), polling a few dozen
+    stat() calls every interval is cheap enough for a tuning tool
+*/
+void    ShaderWatcher::watch( void ) {
+    while (this->running) {
+        std::this_thread::sleep_for(this->interval);
+        this->scan(this->directory, true);
+    }
+}
+
+void    ShaderWatcher::scan( const std::string& path, bool notify ) {
+    DIR*    dir = opendir(path.c_str());
+    if (!dir)
+        return;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name(entry->d_name);
+        if (name[0] == '.')
+            continue;
+        std::string file = path + "/" + name;
+        struct stat st;
+        if (stat(file.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode)) {
+            this->scan(file, notify);
+            continue;
+        }
+        if (name.size() < 5 || name.compare(name.size() - 5, 5, ".glsl") != 0)
+            continue;
+        auto it = this->mtimes.find(file);
+        if (it != this->mtimes.end() && it->second == st.st_mtime)
+            continue;
+        this->mtimes[file] = st.st_mtime;
+        if (notify) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->changes.insert(file);
+        }
+    }
+    closedir(dir);
+}
@@ -0,0 +1,116 @@
+#include "Simulation.hpp"
+
+Simulation::Simulation( Env* env, const Camera& camera, bool threaded, double rate ) :
+env(env), camera(camera), step(1.0 / rate), skipped(0.0), ticks(0), axes(0.0f), inputs(SIMULATION_INPUT_QUEUE), hasUnsent(false), running(threaded) {
+    this->start = std::chrono::steady_clock::now();
+    this->unsent = (tSimInput){ glm::vec3(0.0f), glm::vec2(0.0f) };
+    this->camera.speedmod = (this->env->getRaymarched() ? this->env->getRaymarched()->computeSpeedModifier(this->camera.getPosition()) : 1.0f);
+    this->snapshots[1] = (tSimSnapshot){
+        0.0,
+        this->camera.getPosition(),
+        this->camera.getPitch(),
+        this->camera.getYaw(),
+        this->camera.speedmod,
+        this->env->getDirectionalLight() ? this->env->getDirectionalLight()->getPosition() : glm::vec3(0.0f)
+    };
+    this->snapshots[0] = this->snapshots[1];
+    if (threaded)
+        this->thread = std::thread(&Simulation::run, this);
+}
+
+Simulation::~Simulation( void ) {
+    this->running = false;
+    if (this->thread.joinable())
+        this->thread.join();
+}
+
+/*  the simulation clock, seconds since the start minus the stalls skipped */
+double  Simulation::getTime( void ) const {
+    return (std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count() - this->skipped.load());
+}
+
+/*  the sun circles the scene in about 50 seconds */
+glm::vec3   Simulation::getSunPosition( double time ) {
+    return (glm::vec3(glm::sin(time * 0.125 + 2.) * 50., 20., glm::cos(time * 0.125 + 2.) * 50.));
+}
+
+/*  from the render thread, the inputs are only consumed by the next tick */
+void    Simulation::pushInput( const tSimInput& input ) {
+    if (this->hasUnsent) {
+        this->unsent.axes = input.axes;
+        this->unsent.look += input.look;
+    }
+    else
+        this->unsent = input;
+    this->hasUnsent = !this->inputs.push(this->unsent);
+}
+
+/*  without a thread, the render thread runs the ticks that are due */
+void    Simulation::update( void ) {
+    if (!this->thread.joinable())
+        this->advance();
+}
+
+void    Simulation::run( void ) {
+    while (this->running) {
+        this->advance();
+        std::this_thread::sleep_until(this->start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>((this->ticks + 1) * this->step + this->skipped.load())));
+    }
+}
+
+void    Simulation::advance( void ) {
+    double now = this->getTime();
+    double late = now - (this->ticks + SIMULATION_MAX_CATCHUP) * this->step;
+    if (late > 0.0) {
+        this->skipped.store(this->skipped.load() + late);
+        now -= late;
+    }
+    while ((this->ticks + 1) * this->step <= now)
+        this->tick();
+}
+
+void    Simulation::tick( void ) {
+    glm::vec2   look(0.0f);
+    tSimInput   input;
+    while (this->inputs.pop(input)) {
+        this->axes = input.axes;
+        look += input.look;
+    }
+    this->ticks++;
+    double time = this->ticks * this->step;
+
+    this->camera.speedmod = (this->env->getRaymarched() ? this->env->getRaymarched()->computeSpeedModifier(this->camera.getPosition()) : 1.0f);
+    this->camera.move(this->axes, look, this->step * 1000.0);
+    tSimSnapshot snapshot = {
+        time,
+        this->camera.getPosition(),
+        this->camera.getPitch(),
+        this->camera.getYaw(),
+        this->camera.speedmod,
+        Simulation::getSunPosition(time)
+    };
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->snapshots[0] = this->snapshots[1];
+    this->snapshots[1] = snapshot;
+}
+
+/*  the state one tick in the past, between the last two snapshots */
+tSimSnapshot    Simulation::getSnapshot( void ) {
+    tSimSnapshot previous, last;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        previous = this->snapshots[0];
+        last = this->snapshots[1];
+    }
+    float t = glm::clamp(static_cast<float>((this->getTime() - last.time) / this->step), 0.0f, 1.0f);
+    tSimSnapshot snapshot = {
+        glm::mix(previous.time, last.time, static_cast<double>(t)),
+        glm::mix(previous.cameraPosition, last.cameraPosition, t),
+        glm::mix(previous.pitch, last.pitch, t),
+        glm::mix(previous.yaw, last.yaw, t),
+        last.speedmod,
+        glm::mix(previous.lightPosition, last.lightPosition, t)
+    };
+    return (snapshot);
+}
@@ -0,0 +1,350 @@
+#include "SpatialIndex.hpp"
+
+SpatialIndex::SpatialIndex( float margin ) : root(SPATIAL_NONE), freeList(SPATIAL_NONE), count(0), margin(margin) {
+}
+
+SpatialIndex::~SpatialIndex( void ) {
+}
+
+tSpatialId  SpatialIndex::insert( const tBounds& bounds, uint32_t mask, const void* data ) {
+    uint32_t leaf = this->allocate();
+    tSpatialNode& node = this->nodes[leaf];
+    node.tight = bounds;
+    node.bounds = (tBounds){ bounds.min - this->margin, bounds.max + this->margin };
+    node.height = 0;
+    node.mask = mask;
+    node.data = data;
+    this->insertLeaf(leaf);
+    this->count++;
+    return (leaf);
+}
+
+void    SpatialIndex::remove( tSpatialId id ) {
+    if (id == SPATIAL_NONE)
+        return;
+    this->removeLeaf(id);
+    this->release(id);
+    this->count--;
+}
+
+/*  only reinserted when the object left its enlarged bounds, returns whether it was */
+bool    SpatialIndex::move( tSpatialId id, const tBounds& bounds ) {
+    tSpatialNode& node = this->nodes[id];
+    node.tight = bounds;
+    if (glm::all(glm::lessThanEqual(node.bounds.min, bounds.min)) && glm::all(glm::lessThanEqual(bounds.max, node.bounds.max)))
+        return (false);
+    this->removeLeaf(id);
+    this->nodes[id].bounds = (tBounds){ bounds.min - this->margin, bounds.max + this->margin };
+    this->insertLeaf(id);
+    return (true);
+}
+
+void    SpatialIndex::clear( void ) {
+    this->nodes.clear();
+    this->root = SPATIAL_NONE;
+    this->freeList = SPATIAL_NONE;
+    this->count = 0;
+}
+
+/*  below a node entirely inside the frustum, the leaves are taken without testing them */
+void    SpatialIndex::query( const tFrustum& frustum, std::vector<tSpatialId>& result, uint32_t mask ) const {
+    uint32_t    stack[SPATIAL_STACK];
+    bool        inside[SPATIAL_STACK];
+    size_t      top = 0;
+    if (this->root != SPATIAL_NONE) {
+        inside[top] = false;
+        stack[top++] = this->root;
+    }
+    while (top != 0) {
+        const tSpatialNode& node = this->nodes[stack[--top]];
+        bool                contained = inside[top];
+        if (!(node.mask & mask))
+            continue;
+        if (!contained) {
+            int side = classify(frustum, node.bounds);
+            if (side < 0)
+                continue;
+            contained = (side > 0);
+        }
+        if (node.height == 0) {
+            if (contained || intersects(frustum, node.tight))
+                result.push_back(stack[top]);
+            continue;
+        }
+        if (top + 2 > SPATIAL_STACK)
+            throw Exception::RuntimeError("spatial index query stack overflow");
+        inside[top] = contained;
+        stack[top++] = node.children[0];
+        inside[top] = contained;
+        stack[top++] = node.children[1];
+    }
+}
+
+void    SpatialIndex::query( const glm::vec3& center, float radius, std::vector<tSpatialId>& result, uint32_t mask ) const {
+    uint32_t    stack[SPATIAL_STACK];
+    size_t      top = 0;
+    if (this->root != SPATIAL_NONE)
+        stack[top++] = this->root;
+    while (top != 0) {
+        const tSpatialNode& node = this->nodes[stack[--top]];
+        if (!(node.mask & mask) || !intersects(center, radius, node.bounds))
+            continue;
+        if (node.height == 0) {
+            if (intersects(center, radius, node.tight))
+                result.push_back(stack[top]);
+            continue;
+        }
+        if (top + 2 > SPATIAL_STACK)
+            throw Exception::RuntimeError("spatial index query stack overflow");
+        stack[top++] = node.children[0];
+        stack[top++] = node.children[1];
+    }
+}
+
+/*  the closest object whose bounds the ray enters before maxDistance, distance is where it enters
+    (0 when the origin is inside). The subtrees farther than the closest hit so far are skipped.
+*/
+tSpatialId  SpatialIndex::raycast( const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance, uint32_t mask ) const {
+    glm::vec3   invDirection = 1.0f / direction;
+    tSpatialId  hit = SPATIAL_NONE;
+    uint32_t    stack[SPATIAL_STACK];
+    size_t      top = 0;
+    float       entry;
+    distance = maxDistance;
+    if (this->root != SPATIAL_NONE)
+        stack[top++] = this->root;
+    while (top != 0) {
+        const tSpatialNode& node = this->nodes[stack[--top]];
+        if (!(node.mask & mask) || !intersects(origin, invDirection, node.bounds, entry) || entry > distance)
+            continue;
+        if (node.height == 0) {
+            if (intersects(origin, invDirection, node.tight, entry) && entry <= distance) {
+                distance = entry;
+                hit = stack[top];
+            }
+            continue;
+        }
+        if (top + 2 > SPATIAL_STACK)
+            throw Exception::RuntimeError("spatial index query stack overflow");
+        stack[top++] = node.children[0];
+        stack[top++] = node.children[1];
+    }
+    return (hit);
+}
+
+/*  the free nodes are chained through their parent */
+uint32_t    SpatialIndex::allocate( void ) {
+    uint32_t node = this->freeList;
+    if (node != SPATIAL_NONE)
+        this->freeList = this->nodes[node].parent;
+    else {
+        node = this->nodes.size();
+        this->nodes.push_back(tSpatialNode());
+    }
+    tSpatialNode& n = this->nodes[node];
+    n.parent = SPATIAL_NONE;
+    n.children[0] = SPATIAL_NONE;
+    n.children[1] = SPATIAL_NONE;
+    n.height = 0;
+    n.mask = 0;
+    n.data = nullptr;
+    return (node);
+}
+
+void    SpatialIndex::release( uint32_t node ) {
+    this->nodes[node].parent = this->freeList;
+    this->nodes[node].height = -1;
+    this->freeList = node;
+}
+
+static float    area( const tBounds& bounds ) {
+    glm::vec3 d = bounds.max - bounds.min;
+    return (2.0f * (d.x * d.y + d.y * d.z + d.z * d.x));
+}
+
+/*  walks down to the sibling for which the sum of the areas of the nodes grows the least: below
+    a node, every node on the way grows by at least as much as the leaf adds to the node itself
+*/
+void    SpatialIndex::insertLeaf( uint32_t leaf ) {
+    if (this->root == SPATIAL_NONE) {
+        this->root = leaf;
+        this->nodes[leaf].parent = SPATIAL_NONE;
+        return;
+    }
+    tBounds     bounds = this->nodes[leaf].bounds;
+    uint32_t    sibling = this->root;
+    while (this->nodes[sibling].height != 0) {
+        const tSpatialNode& node = this->nodes[sibling];
+        float   combined = area(merge(node.bounds, bounds));
+        float   cost = 2.0f * combined;
+        float   inheritance = 2.0f * (combined - area(node.bounds));
+        float   costs[2];
+        for (size_t c = 0; c < 2; ++c) {
+            const tSpatialNode& child = this->nodes[node.children[c]];
+            costs[c] = area(merge(child.bounds, bounds)) + inheritance;
+            if (child.height != 0)
+                costs[c] -= area(child.bounds);
+        }
+        if (cost < costs[0] && cost < costs[1])
+            break;
+        sibling = node.children[costs[0] < costs[1] ? 0 : 1];
+    }
+    uint32_t    oldParent = this->nodes[sibling].parent;
+    uint32_t    newParent = this->allocate();
+    tSpatialNode& parent = this->nodes[newParent];
+    parent.parent = oldParent;
+    parent.children[0] = sibling;
+    parent.children[1] = leaf;
+    this->nodes[sibling].parent = newParent;
+    this->nodes[leaf].parent = newParent;
+    if (oldParent == SPATIAL_NONE)
+        this->root = newParent;
+    else
+        this->nodes[oldParent].children[this->nodes[oldParent].children[0] == sibling ? 0 : 1] = newParent;
+    this->refit(newParent);
+}
+
+/*  the sibling of the leaf takes the place of their parent */
+void    SpatialIndex::removeLeaf( uint32_t leaf ) {
+    if (leaf == this->root) {
+        this->root = SPATIAL_NONE;
+        return;
+    }
+    uint32_t parent = this->nodes[leaf].parent;
+    uint32_t grandParent = this->nodes[parent].parent;
+    uint32_t sibling = this->nodes[parent].children[this->nodes[parent].children[0] == leaf ? 1 : 0];
+    this->nodes[sibling].parent = grandParent;
+    this->release(parent);
+    if (grandParent == SPATIAL_NONE) {
+        this->root = sibling;
+        return;
+    }
+    this->nodes[grandParent].children[this->nodes[grandParent].children[0] == parent ? 0 : 1] = sibling;
+    this->refit(grandParent);
+}
+
+/*  rebalances and recomputes the nodes from this one up to the root */
+void    SpatialIndex::refit( uint32_t node ) {
+    while (node != SPATIAL_NONE) {
+        node = this->balance(node);
+        this->fit(node);
+        node = this->nodes[node].parent;
+    }
+}
+
+void    SpatialIndex::fit( uint32_t node ) {
+    tSpatialNode&       n = this->nodes[node];
+    const tSpatialNode& a = this->nodes[n.children[0]];
+    const tSpatialNode& b = this->nodes[n.children[1]];
+    n.bounds = merge(a.bounds, b.bounds);
+    n.height = 1 + std::max(a.height, b.height);
+    n.mask = a.mask | b.mask;
+}
+
+/*  When the heights of the children of a differ by more than one, the higher child takes the
+    place of a, which takes the lower of its grandchildren:
+            a                   c
+          /   \               /   \
+         b     c     ->      a     f    (when f is higher than g)
+              / \           / \
+             f   g         b   g
+    returns the node now in the place of a.
+*/
+uint32_t    SpatialIndex::balance( uint32_t a ) {
+    tSpatialNode& nodeA = this->nodes[a];
+    if (nodeA.height < 2)
+        return (a);
+    int difference = this->nodes[nodeA.children[1]].height - this->nodes[nodeA.children[0]].height;
+    if (difference >= -1 && difference <= 1)
+        return (a);
+    size_t      high = (difference > 1 ? 1 : 0);
+    uint32_t    c = nodeA.children[high];
+    tSpatialNode& nodeC = this->nodes[c];
+    uint32_t    f = nodeC.children[0];
+    uint32_t    g = nodeC.children[1];
+    if (this->nodes[g].height > this->nodes[f].height)
+        std::swap(f, g);
+    /* c takes the place of a */
+    nodeC.parent = nodeA.parent;
+    if (nodeC.parent == SPATIAL_NONE)
+        this->root = c;
+    else
+        this->nodes[nodeC.parent].children[this->nodes[nodeC.parent].children[0] == a ? 0 : 1] = c;
+    /* a keeps its lower child and takes g, c has a and f */
+    nodeA.parent = c;
+    nodeA.children[high] = g;
+    this->nodes[g].parent = a;
+    nodeC.children[0] = a;
+    nodeC.children[1] = f;
+    this->fit(a);
+    this->fit(c);
+    return (c);
+}
+
+tBounds     merge( const tBounds& a, const tBounds& b ) {
+    return ((tBounds){ glm::min(a.min, b.min), glm::max(a.max, b.max) });
+}
+
+/*  the bounds of the transformed box, from the center and the absolute value of the matrix */
+tBounds     transformBounds( const tBounds& bounds, const glm::mat4& transform ) {
+    glm::vec3 center = glm::vec3(transform * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+    glm::vec3 half = (bounds.max - bounds.min) * 0.5f;
+    glm::vec3 extent = glm::vec3(0.0f);
+    for (size_t c = 0; c < 3; ++c)
+        extent += glm::abs(glm::vec3(transform[c])) * half[c];
+    return ((tBounds){ center - extent, center + extent });
+}
+
+/*  the planes from the rows of the matrix (Gribb and Hartmann) */
+tFrustum    getFrustum( const glm::mat4& viewProjection ) {
+    tFrustum    frustum;
+    glm::vec4   rows[4];
+    for (size_t r = 0; r < 4; ++r)
+        rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+    for (size_t r = 0; r < 3; ++r) {
+        frustum.planes[r * 2] = rows[3] + rows[r];
+        frustum.planes[r * 2 + 1] = rows[3] - rows[r];
+    }
+    return (frustum);
+}
+
+/*  -1 when the box is entirely outside one of the planes, 1 when it is inside all of them, 0 otherwise */
+int         classify( const tFrustum& frustum, const tBounds& bounds ) {
+    int side = 1;
+    for (size_t p = 0; p < 6; ++p) {
+        const glm::vec4& plane = frustum.planes[p];
+        glm::vec3 farthest = glm::vec3(
+            plane.x > 0.0f ? bounds.max.x : bounds.min.x,
+            plane.y > 0.0f ? bounds.max.y : bounds.min.y,
+            plane.z > 0.0f ? bounds.max.z : bounds.min.z
+        );
+        glm::vec3 nearest = bounds.min + bounds.max - farthest;
+        if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f)
+            return (-1);
+        if (glm::dot(glm::vec3(plane), nearest) + plane.w < 0.0f)
+            side = 0;
+    }
+    return (side);
+}
+
+/*  conservative: false only when the box is entirely outside one of the planes */
+bool        intersects( const tFrustum& frustum, const tBounds& bounds ) {
+    return (classify(frustum, bounds) >= 0);
+}
+
+bool        intersects( const glm::vec3& center, float radius, const tBounds& bounds ) {
+    glm::vec3 d = center - glm::clamp(center, bounds.min, bounds.max);
+    return (glm::dot(d, d) <= radius * radius);
+}
+
+/*  slab test, distance is where the ray enters the box */
+bool        intersects( const glm::vec3& origin, const glm::vec3& invDirection, const tBounds& bounds, float& distance ) {
+    glm::vec3 t0 = (bounds.min - origin) * invDirection;
+    glm::vec3 t1 = (bounds.max - origin) * invDirection;
+    glm::vec3 near = glm::min(t0, t1);
+    glm::vec3 far = glm::max(t0, t1);
+    float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+    float exit = std::min(std::min(far.x, far.y), far.z);
+    distance = enter;
+    return (enter <= exit);
+}
@@ -0,0 +1,210 @@
+#include "TransformStore.hpp"
+
+std::vector<float>          TransformStore::components[9];
+std::vector<tTransformId>   TransformStore::parents;
+std::vector<glm::mat4>      TransformStore::locals;
+std::vector<glm::mat4>      TransformStore::worlds;
+std::vector<uint8_t>        TransformStore::dirty;
+std::vector<uint8_t>        TransformStore::changed;
+std::vector<uint8_t>        TransformStore::alive;
+std::vector<tTransformId>   TransformStore::dirtyList;
+std::vector<tTransformId>   TransformStore::freeList;
+std::vector<tTransformId>   TransformStore::order;
+bool                        TransformStore::sorted = true;
+size_t                      TransformStore::composed = 0;
+
+/*  the matrices are valid as soon as the transform is created, it is flagged as changed by the
+    next update (the names are reused, a new transform must not look like the old one)
+*/
+tTransformId    TransformStore::create( const glm::vec3& position, const glm::vec3& orientation, const glm::vec3& scale, tTransformId parent ) {
+    tTransformId id;
+    if (TransformStore::freeList.size() != 0) {
+        id = TransformStore::freeList.back();
+        TransformStore::freeList.pop_back();
+    }
+    else {
+        id = TransformStore::parents.size();
+        for (size_t c = 0; c < 9; ++c)
+            TransformStore::components[c].push_back(0.0f);
+        TransformStore::parents.push_back(TRANSFORM_NONE);
+        TransformStore::locals.push_back(glm::mat4(1.0f));
+        TransformStore::worlds.push_back(glm::mat4(1.0f));
+        TransformStore::dirty.push_back(0);
+        TransformStore::changed.push_back(0);
+        TransformStore::alive.push_back(0);
+    }
+    for (size_t c = 0; c < 3; ++c) {
+        TransformStore::components[c][id] = position[c];
+        TransformStore::components[3 + c][id] = orientation[c];
+        TransformStore::components[6 + c][id] = scale[c];
+    }
+    TransformStore::parents[id] = parent;
+    TransformStore::alive[id] = 1;
+    TransformStore::changed[id] = 0;
+    TransformStore::dirty[id] = 0;
+    TransformStore::compose(&id, 1);
+    TransformStore::worlds[id] = (parent != TRANSFORM_NONE ? TransformStore::worlds[parent] * TransformStore::locals[id] : TransformStore::locals[id]);
+    TransformStore::markDirty(id);
+    TransformStore::sorted = false;
+    return (id);
+}
+
+/*  the children of the transform become roots */
+void    TransformStore::destroy( tTransformId id ) {
+    if (id == TRANSFORM_NONE || !TransformStore::alive[id])
+        return;
+    for (size_t i = 0; i < TransformStore::parents.size(); ++i)
+        if (TransformStore::alive[i] && TransformStore::parents[i] == id)
+            TransformStore::setParent(i, TRANSFORM_NONE);
+    TransformStore::alive[id] = 0;
+    TransformStore::changed[id] = 0;
+    TransformStore::freeList.push_back(id);
+    TransformStore::sorted = false;
+}
+
+void    TransformStore::update( void ) {
+    if (!TransformStore::sorted)
+        TransformStore::sort();
+    std::fill(TransformStore::changed.begin(), TransformStore::changed.end(), 0);
+    /* the destroyed transforms may have been marked before */
+    TransformStore::dirtyList.erase(std::remove_if(TransformStore::dirtyList.begin(), TransformStore::dirtyList.end(), []( tTransformId id ) {
+        return (!TransformStore::alive[id]);
+    }), TransformStore::dirtyList.end());
+    TransformStore::compose(TransformStore::dirtyList.data(), TransformStore::dirtyList.size());
+    TransformStore::composed = TransformStore::dirtyList.size();
+    TransformStore::dirtyList.clear();
+    for (size_t i = 0; i < TransformStore::order.size(); ++i) {
+        tTransformId id = TransformStore::order[i];
+        tTransformId parent = TransformStore::parents[id];
+        if (!TransformStore::dirty[id] && (parent == TRANSFORM_NONE || !TransformStore::changed[parent]))
+            continue;
+        TransformStore::worlds[id] = (parent != TRANSFORM_NONE ? TransformStore::worlds[parent] * TransformStore::locals[id] : TransformStore::locals[id]);
+        TransformStore::dirty[id] = 0;
+        TransformStore::changed[id] = 1;
+    }
+}
+
+void    TransformStore::setPosition( tTransformId id, const glm::vec3& position ) {
+    for (size_t c = 0; c < 3; ++c)
+        TransformStore::components[c][id] = position[c];
+    TransformStore::markDirty(id);
+}
+
+void    TransformStore::setOrientation( tTransformId id, const glm::vec3& orientation ) {
+    for (size_t c = 0; c < 3; ++c)
+        TransformStore::components[3 + c][id] = orientation[c];
+    TransformStore::markDirty(id);
+}
+
+void    TransformStore::setScale( tTransformId id, const glm::vec3& scale ) {
+    for (size_t c = 0; c < 3; ++c)
+        TransformStore::components[6 + c][id] = scale[c];
+    TransformStore::markDirty(id);
+}
+
+void    TransformStore::setParent( tTransformId id, tTransformId parent ) {
+    for (tTransformId p = parent; p != TRANSFORM_NONE; p = TransformStore::parents[p])
+        if (p == id)
+            throw Exception::RuntimeError("transform hierarchy cycle");
+    TransformStore::parents[id] = parent;
+    TransformStore::markDirty(id);
+    TransformStore::sorted = false;
+}
+
+glm::vec3   TransformStore::getPosition( tTransformId id ) {
+    return (glm::vec3(TransformStore::components[0][id], TransformStore::components[1][id], TransformStore::components[2][id]));
+}
+
+glm::vec3   TransformStore::getOrientation( tTransformId id ) {
+    return (glm::vec3(TransformStore::components[3][id], TransformStore::components[4][id], TransformStore::components[5][id]));
+}
+
+glm::vec3   TransformStore::getScale( tTransformId id ) {
+    return (glm::vec3(TransformStore::components[6][id], TransformStore::components[7][id], TransformStore::components[8][id]));
+}
+
+void    TransformStore::markDirty( tTransformId id ) {
+    if (TransformStore::dirty[id])
+        return;
+    TransformStore::dirty[id] = 1;
+    TransformStore::dirtyList.push_back(id);
+}
+
+/*  T * Rz * Ry * Rx * S, what glm::translate, rotate (z, y, x) and scale give, written out:
+        col0 = ( cz*cy,             sz*cy,              -sy   ) * scale.x
+        col1 = ( cz*sy*sx - sz*cx,  sz*sy*sx + cz*cx,   cy*sx ) * scale.y
+        col2 = ( cz*sy*cx + sz*sx,  sz*sy*cx - cz*sx,   cy*cx ) * scale.z
+        col3 = position
+    with SSE the 9 terms of the rotation and scale are computed for four transforms at once.
+*/
+void    TransformStore::compose( const tTransformId* ids, size_t count ) {
+    std::vector<float>* t = TransformStore::components;
+    size_t i = 0;
+#if defined(__SSE__)
+    for (; i + 4 <= count; i += 4) {
+        float lanes[9][4];
+        for (size_t l = 0; l < 4; ++l) {
+            tTransformId id = ids[i + l];
+            for (size_t a = 0; a < 3; ++a) {
+                lanes[a][l] = std::cos(t[3 + a][id]);
+                lanes[3 + a][l] = std::sin(t[3 + a][id]);
+                lanes[6 + a][l] = t[6 + a][id];
+            }
+        }
+        __m128 cx = _mm_loadu_ps(lanes[0]), cy = _mm_loadu_ps(lanes[1]), cz = _mm_loadu_ps(lanes[2]);
+        __m128 sx = _mm_loadu_ps(lanes[3]), sy = _mm_loadu_ps(lanes[4]), sz = _mm_loadu_ps(lanes[5]);
+        __m128 kx = _mm_loadu_ps(lanes[6]), ky = _mm_loadu_ps(lanes[7]), kz = _mm_loadu_ps(lanes[8]);
+        __m128 czsy = _mm_mul_ps(cz, sy);
+        __m128 szsy = _mm_mul_ps(sz, sy);
+        __m128 m[9] = {
+            _mm_mul_ps(_mm_mul_ps(cz, cy), kx),
+            _mm_mul_ps(_mm_mul_ps(sz, cy), kx),
+            _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), sy), kx),
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(czsy, sx), _mm_mul_ps(sz, cx)), ky),
+            _mm_mul_ps(_mm_add_ps(_mm_mul_ps(szsy, sx), _mm_mul_ps(cz, cx)), ky),
+            _mm_mul_ps(_mm_mul_ps(cy, sx), ky),
+            _mm_mul_ps(_mm_add_ps(_mm_mul_ps(czsy, cx), _mm_mul_ps(sz, sx)), kz),
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(szsy, cx), _mm_mul_ps(cz, sx)), kz),
+            _mm_mul_ps(_mm_mul_ps(cy, cx), kz),
+        };
+        float out[9][4];
+        for (size_t k = 0; k < 9; ++k)
+            _mm_storeu_ps(out[k], m[k]);
+        for (size_t l = 0; l < 4; ++l) {
+            tTransformId id = ids[i + l];
+            glm::mat4& local = TransformStore::locals[id];
+            for (size_t k = 0; k < 9; ++k)
+                local[k / 3][k % 3] = out[k][l];
+            local[0][3] = local[1][3] = local[2][3] = 0.0f;
+            local[3] = glm::vec4(t[0][id], t[1][id], t[2][id], 1.0f);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        tTransformId id = ids[i];
+        float cx = std::cos(t[3][id]), cy = std::cos(t[4][id]), cz = std::cos(t[5][id]);
+        float sx = std::sin(t[3][id]), sy = std::sin(t[4][id]), sz = std::sin(t[5][id]);
+        glm::mat4& local = TransformStore::locals[id];
+        local[0] = glm::vec4(cz * cy, sz * cy, -sy, 0.0f) * t[6][id];
+        local[1] = glm::vec4(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0.0f) * t[7][id];
+        local[2] = glm::vec4(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0.0f) * t[8][id];
+        local[3] = glm::vec4(t[0][id], t[1][id], t[2][id], 1.0f);
+    }
+}
+
+/*  by depth in the hierarchy, parents before children */
+void    TransformStore::sort( void ) {
+    std::vector<size_t> depths(TransformStore::parents.size(), 0);
+    TransformStore::order.clear();
+    for (size_t i = 0; i < TransformStore::parents.size(); ++i) {
+        if (!TransformStore::alive[i])
+            continue;
+        for (tTransformId p = TransformStore::parents[i]; p != TRANSFORM_NONE; p = TransformStore::parents[p])
+            depths[i]++;
+        TransformStore::order.push_back(i);
+    }
+    std::stable_sort(TransformStore::order.begin(), TransformStore::order.end(), [&depths]( tTransformId a, tTransformId b ) {
+        return (depths[a] < depths[b]);
+    });
+    TransformStore::sorted = true;
+}
@@ -1,72 +1,166 @@
 #include "VideoCapture.hpp"
 
-VideoCapture::VideoCapture( const std::string source, int width, int height, int framerate, eCodec codec, float recordingTime ) {
-    /* source extension should be .mov */
+VideoCapture::VideoCapture( const std::string source, int width, int height, int framerate, eCodec codec, float recordingTime ) :
+encodeQueue(CAPTURE_QUEUE_SIZE + 1), freeQueue(CAPTURE_QUEUE_SIZE), vflip(true), recording(false) {
+    /* source extension should be .mov (.y4m for eCodec::y4m) */
     this->framerate = framerate;
     this->maxFrames = (int)(framerate * recordingTime);
     this->currentFrame = 0;
+    this->spareFrame = CAPTURE_QUEUE_SIZE;
     this->size = cv::Size(width, height);
+    this->yuv = (codec == eCodec::y4m);
 
-    this->data = (uint8_t*)malloc(this->size.width * this->size.height * 3);
+    if (this->yuv) {
+        if (width % 2 || height % 2)
+            throw Exception::InitError("I420 capture needs an even resolution");
+        this->rawWriter.open(source, std::ios::binary | std::ios::trunc);
+        if (!this->rawWriter.is_open()) {
+            std::cout  << "Could not open the output video for write: " << source << std::endl;
+            return;
+        }
+        /* 4:2:0 with the chroma sited at the center of the 2x2 blocks */
+        this->rawWriter << "YUV4MPEG2 W" << width << " H" << height << " F" << (int)std::round(framerate * 1000.0f) << ":1000 Ip A1:1 C420jpeg\n";
+    }
+    else {
+        this->videoWriter.open(source, VideoCapture::getCodecFourcc(codec), framerate, this->size, true);
+        if (!videoWriter.isOpened()) {
+            std::cout  << "Could not open the output video for write: " << source << std::endl;
+            return;
+        }
+        this->videoWriter.set(cv::VIDEOWRITER_PROP_QUALITY, 100.0);
+    }
 
-    this->videoWriter.open(source, VideoCapture::getCodecFourcc(codec), framerate, this->size, true);
-    if (!videoWriter.isOpened())
-        std::cout  << "Could not open the output video for write: " << source << std::endl;
-    this->videoWriter.set(cv::VIDEOWRITER_PROP_QUALITY, 100.0);
+    size_t frameSize = this->size.width * this->size.height * (this->yuv ? 3 : 6) / 2;
+    glGenBuffers(CAPTURE_PBO_COUNT, this->pbo);
+    for (size_t i = 0; i < CAPTURE_PBO_COUNT; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, nullptr, GL_STREAM_READ);
+        this->fences[i] = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    this->pboHead = 0;
+    this->pboPending = 0;
+    for (size_t i = 0; i < CAPTURE_QUEUE_SIZE; ++i) {
+        this->frames[i].resize(frameSize);
+        this->freeQueue.push(i);
+    }
+    this->recording = true;
+    this->encoder = std::thread(&VideoCapture::encode, this);
 }
 
 VideoCapture::~VideoCapture( void ) {
-    if (this->videoWriter.isOpened())
-        this->videoWriter.release();
+    this->finish();
 }
 
-cv::Mat correctGamma( cv::Mat& img, double gamma ) {
-    double inverse_gamma = 1.0 / gamma;
-
-    cv::Mat lut_matrix(1, 256, CV_8UC1);
-    uchar * ptr = lut_matrix.ptr();
-    for( int i = 0; i < 256; i++ )
-        ptr[i] = (int)( pow( (double) i / 255.0, inverse_gamma ) * 255.0 );
+/*  to call once the frame is rendered in the framebuffer, before swapping the buffers */
+void    VideoCapture::write( bool vflip, GLuint framebuffer ) {
+    if (!this->recording)
+        return ;
+    /* end capture when max recording time is reached */
+    if (this->currentFrame > this->maxFrames) {
+        this->finish();
+        std::cout << "> Capture completed" << std::endl;
+        return ;
+    }
+    this->vflip = vflip;
+    /* copy out the frames whose readback is done, the oldest one has to be when the ring is full */
+    while (this->pboPending != 0) {
+        size_t oldest = (this->pboHead + CAPTURE_PBO_COUNT - this->pboPending) % CAPTURE_PBO_COUNT;
+        bool full = (this->pboPending == CAPTURE_PBO_COUNT);
+        if (!full && glClientWaitSync(this->fences[oldest], 0, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+        this->copyOldest(full);
+    }
+    this->readback(framebuffer);
+    this->currentFrame++;
+}
 
-    cv::Mat result;
-    cv::LUT( img, lut_matrix, result );
-    return result;
+/*  glReadPixels into a PBO returns immediately, the transfer happens when the GPU gets there */
+void    VideoCapture::readback( GLuint framebuffer ) {
+    GlState::bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pbo[this->pboHead]);
+    if (this->yuv)
+        glReadPixels(0, 0, (GLsizei)this->size.width, (GLsizei)this->size.height * 3 / 2, GL_RED, GL_UNSIGNED_BYTE, 0);
+    else
+        glReadPixels(0, 0, (GLsizei)this->size.width, (GLsizei)this->size.height, GL_BGR, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    this->fences[this->pboHead] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    this->pboHead = (this->pboHead + 1) % CAPTURE_PBO_COUNT;
+    this->pboPending++;
 }
 
-cv::Mat sRGBtoLinear( cv::Mat& img ) {
-    // https://www.khronos.org/registry/OpenGL/extensions/ARB/ARB_framebuffer_sRGB.txt
-    cv::Mat lut_matrix(1, 256, CV_8UC1);
-    uchar * ptr = lut_matrix.ptr();
-    for( int i = 0; i < 256; i++ ) {
-        double cs = (double)i / 255.;
-        ptr[i] = (int)((cs <= 0.04045 ? cs / 12.92 : cv::pow((cs + 0.055)/1.055, 2.4) ) * 255.0);
+/*  copy the oldest PBO in a free frame and hand it to the encoder (waits for a free frame when
+    the encoder is behind). Only the encoder pushes to freeQueue, a frame that could not be
+    filled is kept as the spare and used first the next time.
+*/
+void    VideoCapture::copyOldest( bool wait ) {
+    size_t oldest = (this->pboHead + CAPTURE_PBO_COUNT - this->pboPending) % CAPTURE_PBO_COUNT;
+    size_t frame;
+    if (wait)
+        glClientWaitSync(this->fences[oldest], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(this->fences[oldest]);
+    this->fences[oldest] = nullptr;
+    if (this->spareFrame != CAPTURE_QUEUE_SIZE) {
+        frame = this->spareFrame;
+        this->spareFrame = CAPTURE_QUEUE_SIZE;
+    }
+    else {
+        while (!this->freeQueue.pop(frame))
+            std::this_thread::yield();
     }
-    cv::Mat res;
-    cv::LUT( img, lut_matrix, res );
-    return res;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pbo[oldest]);
+    void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, this->frames[frame].size(), GL_MAP_READ_BIT);
+    if (data) {
+        std::memcpy(this->frames[frame].data(), data, this->frames[frame].size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        this->encodeQueue.push(frame);
+    }
+    else
+        this->spareFrame = frame;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    this->pboPending--;
 }
 
-
-void    VideoCapture::write( bool vflip ) {
-    if (!this->videoWriter.isOpened())
+/*  flush the frames still in flight, let the encoder drain its queue and close the file */
+void    VideoCapture::finish( void ) {
+    if (!this->recording)
         return ;
-    /* end capture when max recording time is reached */
-    if (this->videoWriter.isOpened() && this->currentFrame > this->maxFrames) {
+    while (this->pboPending != 0)
+        this->copyOldest(true);
+    this->recording = false;
+    if (this->encoder.joinable())
+        this->encoder.join();
+    glDeleteBuffers(CAPTURE_PBO_COUNT, this->pbo);
+    if (this->yuv)
+        this->rawWriter.close();
+    else
         this->videoWriter.release();
-        std::cout << "> Capture completed" << std::endl;
-    }
-    /* capture frame from openGL */
-    if (this->videoWriter.isOpened()) {
-
-        glReadPixels(0, 0, (GLsizei)this->size.width, (GLsizei)this->size.height, GL_BGR, GL_UNSIGNED_BYTE, data);
-        cv::Mat tmp(this->size.height, this->size.width, CV_8UC3, data);
-        // this->frame = sRGBtoLinear(tmp);
-        this->frame = tmp;
+}
 
-        if (vflip)
-            cv::flip(this->frame, this->frame, 0);
-        this->videoWriter.write(this->frame);
-        this->currentFrame++;
+void    VideoCapture::encode( void ) {
+    size_t frame;
+    while (true) {
+        if (!this->encodeQueue.pop(frame)) {
+            /* everything was pushed before recording was cleared */
+            if (!this->recording && this->encodeQueue.empty())
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (this->yuv) {
+            /* the planes are already top-down */
+            this->rawWriter << "FRAME\n";
+            this->rawWriter.write(reinterpret_cast<const char*>(this->frames[frame].data()), this->frames[frame].size());
+        }
+        else {
+            cv::Mat image(this->size.height, this->size.width, CV_8UC3, this->frames[frame].data());
+            if (this->vflip)
+                cv::flip(image, image, 0);
+            this->videoWriter.write(image);
+        }
+        this->freeQueue.push(frame);
     }
 }
 
@@ -0,0 +1,92 @@
+#include "WorkerPool.hpp"
+
+WorkerPool::WorkerPool( size_t count ) : next(0), running(true) {
+    for (size_t i = 0; i < count; ++i)
+        this->threads.push_back(std::thread(&WorkerPool::work, this));
+}
+
+/*  the jobs still queued are run before the threads exit */
+WorkerPool::~WorkerPool( void ) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->running = false;
+    }
+    this->condition.notify_all();
+    for (size_t i = 0; i < this->threads.size(); ++i)
+        this->threads[i].join();
+}
+
+std::future<void>   WorkerPool::submit( const std::function<void(void)>& job ) {
+    std::shared_ptr<std::packaged_task<void(void)>> task = std::make_shared<std::packaged_task<void(void)>>(job);
+    std::future<void> result = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->tasks.push_back(task);
+    }
+    this->condition.notify_one();
+    return (result);
+}
+
+/*  the job must not be pending, its previous run is waited for first */
+void    WorkerPool::run( tWorkerJob& job ) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        job.pending = true;
+        job.error = nullptr;
+        this->jobs.push_back(&job);
+    }
+    this->condition.notify_one();
+}
+
+void    WorkerPool::wait( tWorkerJob& job ) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->finished.wait(lock, [&job]( void ) { return (!job.pending); });
+    if (job.error) {
+        std::exception_ptr error = job.error;
+        job.error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void    WorkerPool::work( void ) {
+    for (;;) {
+        std::shared_ptr<std::packaged_task<void(void)>> task;
+        tWorkerJob*                                     job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this]( void ) {
+                return (!this->running || !this->tasks.empty() || this->next < this->jobs.size());
+            });
+            if (this->next < this->jobs.size()) {
+                job = this->jobs[this->next++];
+                if (this->next == this->jobs.size()) {
+                    this->jobs.clear();
+                    this->next = 0;
+                }
+            }
+            else if (!this->tasks.empty()) {
+                task = this->tasks.front();
+                this->tasks.pop_front();
+            }
+            else
+                return;
+        }
+        if (task) {
+            (*task)();
+            continue;
+        }
+        std::exception_ptr error;
+        try {
+            job->function();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            job->pending = false;
+            job->error = error;
+        }
+        this->finished.notify_all();
+    }
+}
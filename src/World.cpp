@@ -0,0 +1,356 @@
+#include "World.hpp"
+#include "Env.hpp"
+
+World::World( Env* env ) : env(env), workers(2), memoryBudget(WORLD_MEMORY_BUDGET), residentBytes(0), reads(0), frame(0), raymarchedCount(0) {
+}
+
+World::~World( void ) {
+    for (auto it = this->cells.begin(); it != this->cells.end(); it++)
+        this->unload(it->second);
+    for (auto it = this->assets.begin(); it != this->assets.end(); it++) {
+        if (it->second.state == eAssetState::reading)
+            it->second.reading.wait();
+        delete it->second.data;
+        delete it->second.model;
+    }
+}
+
+/*  sorts a scene entry in its cell, nothing is loaded until the cell is requested */
+void    World::add( const tSceneEntry& entry ) {
+    glm::ivec2  coord = glm::ivec2(glm::floor(glm::vec2(entry.position.x, entry.position.z) / WORLD_CELL_SIZE));
+    int64_t     key = World::getKey(coord);
+    if (this->cells.find(key) == this->cells.end()) {
+        tWorldCell& cell = this->cells[key];
+        cell.coord = coord;
+        cell.state = eCellState::unloaded;
+        cell.priority = 0.0f;
+        glm::vec3 min = glm::vec3(coord.x, 0.0f, coord.y) * WORLD_CELL_SIZE;
+        this->cellIndex.insert((tBounds){ min, min + glm::vec3(WORLD_CELL_SIZE, 0.0f, WORLD_CELL_SIZE) }, 1, &cell);
+    }
+    tWorldCell& cell = this->cells[key];
+    cell.entries.push_back(entry);
+    tSceneEntry& added = cell.entries.back();
+    if (entry.type == eSceneEntry::model)
+        this->names[entry.name] = entry.paths[0];
+    if (entry.type == eSceneEntry::instance)
+        added.paths.push_back(this->names.at(entry.name));
+    if (entry.type == eSceneEntry::model || entry.type == eSceneEntry::instance) {
+        if (std::find(cell.assets.begin(), cell.assets.end(), added.paths[0]) == cell.assets.end())
+            cell.assets.push_back(added.paths[0]);
+        if (this->assets.find(added.paths[0]) == this->assets.end()) {
+            tWorldAsset& asset = this->assets[added.paths[0]];
+            asset.state = eAssetState::unloaded;
+            asset.data = nullptr;
+            asset.model = nullptr;
+            asset.bytes = 0;
+            asset.uploaded = 0;
+            asset.refs = 0;
+            asset.lastUsed = 0;
+        }
+    }
+    if (entry.type == eSceneEntry::raymarched) {
+        cell.objects.push_back(cell.entries.size() - 1);
+        this->raymarchedCount++;
+    }
+}
+
+/*  Called by the GL thread before the frame is recorded. When wait is set, the cells in range
+    are fully loaded before returning (the first frame, the offline renders).
+*/
+void    World::update( const glm::vec3& position, const glm::vec3& front, bool wait ) {
+    bool pending = true;
+    this->frame++;
+    while (pending) {
+        /* the cells in range, by priority */
+        tFrameVector<std::pair<float, int64_t>> order;
+        this->found.clear();
+        this->cellIndex.query(glm::vec3(position.x, 0.0f, position.z), WORLD_UNLOAD_RADIUS, this->found);
+        for (size_t i = 0; i < this->found.size(); ++i) {
+            int64_t     key = World::getKey(static_cast<const tWorldCell*>(this->cellIndex.getData(this->found[i]))->coord);
+            tWorldCell& cell = this->cells[key];
+            float       radius = (cell.state == eCellState::unloaded ? WORLD_LOAD_RADIUS : WORLD_UNLOAD_RADIUS);
+            cell.priority = World::getPriority(cell, position, front);
+            if (World::getDistance(cell, position) < radius)
+                order.push_back(std::make_pair(cell.priority, key));
+        }
+        std::sort(order.begin(), order.end());
+        /* as many as the memory budget allows, the sizes of the files never read count as zero */
+        tFrameSet<const tWorldAsset*>   counted;
+        tFrameSet<int64_t>              wanted;
+        size_t                          bytes = 0;
+        for (size_t i = 0; i < order.size(); ++i) {
+            tWorldCell& cell = this->cells[order[i].second];
+            size_t      cost = 0;
+            for (size_t j = 0; j < cell.assets.size(); ++j)
+                if (counted.find(&this->assets[cell.assets[j]]) == counted.end())
+                    cost += this->assets[cell.assets[j]].bytes;
+            if (wanted.size() != 0 && bytes + cost > this->memoryBudget)
+                break;
+            for (size_t j = 0; j < cell.assets.size(); ++j)
+                counted.insert(&this->assets[cell.assets[j]]);
+            bytes += cost;
+            wanted.insert(order[i].second);
+        }
+        tFrameVector<int64_t> dropped;
+        for (auto it = this->active.begin(); it != this->active.end(); it++)
+            if (wanted.find(*it) == wanted.end())
+                dropped.push_back(*it);
+        for (size_t i = 0; i < dropped.size(); ++i)
+            this->unload(this->cells[dropped[i]]);
+        /* request the wanted cells and read their files, the closest first */
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (wanted.find(order[i].second) == wanted.end())
+                continue;
+            tWorldCell& cell = this->cells[order[i].second];
+            if (cell.state == eCellState::unloaded)
+                this->request(cell);
+            for (size_t j = 0; j < cell.assets.size() && this->reads < WORLD_MAX_READS; ++j)
+                if (this->assets[cell.assets[j]].state == eAssetState::unloaded)
+                    this->read(cell.assets[j], this->assets[cell.assets[j]]);
+        }
+        this->upload(wait);
+        pending = false;
+        for (auto it = this->active.begin(); it != this->active.end(); it++) {
+            tWorldCell& cell = this->cells[*it];
+            if (cell.state != eCellState::loading)
+                continue;
+            bool ready = true;
+            for (size_t j = 0; j < cell.assets.size(); ++j) {
+                eAssetState state = this->assets[cell.assets[j]].state;
+                ready = ready && (state == eAssetState::resident || state == eAssetState::failed);
+            }
+            if (ready)
+                this->instantiate(cell);
+            pending = pending || !ready;
+        }
+        pending = pending && wait;
+    }
+    this->evict();
+    this->updateExhibits(position);
+}
+
+/*  the objects moved by the last TransformStore::update are moved in the index */
+void    World::updateBounds( void ) {
+    for (auto it = this->active.begin(); it != this->active.end(); it++) {
+        const tWorldCell& cell = this->cells.at(*it);
+        for (size_t i = 0; i < cell.models.size(); ++i)
+            if (TransformStore::isChanged(cell.models[i]->getTransformId()))
+                this->index.move(cell.models[i]->getSpatialId(), cell.models[i]->getBounds());
+        for (size_t i = 0; i < cell.surfaces.size(); ++i)
+            if (TransformStore::isChanged(cell.surfaces[i]->getTransformId()))
+                this->index.move(cell.surfaces[i]->getSpatialId(), cell.surfaces[i]->getBounds());
+    }
+}
+
+/*  the entry of the closest loaded object whose bounds the ray hits, nullptr if none */
+const tSceneEntry*  World::pick( const glm::vec3& origin, const glm::vec3& direction, float& distance ) const {
+    tSpatialId hit = this->index.raycast(origin, direction, WORLD_UNLOAD_RADIUS, distance);
+    return (hit != SPATIAL_NONE ? static_cast<const tSceneEntry*>(this->index.getData(hit)) : nullptr);
+}
+
+void    World::print( std::ostream& os ) const {
+    size_t loaded = 0, loading = 0, resident = 0, failed = 0;
+    for (auto it = this->cells.begin(); it != this->cells.end(); it++) {
+        loaded += (it->second.state == eCellState::loaded);
+        loading += (it->second.state == eCellState::loading);
+    }
+    for (auto it = this->assets.begin(); it != this->assets.end(); it++) {
+        resident += (it->second.state == eAssetState::resident);
+        failed += (it->second.state == eAssetState::failed);
+    }
+    os << "world: " << loaded << "/" << this->cells.size() << " cells loaded (" << loading << " loading), "
+       << resident << "/" << this->assets.size() << " models resident (" << failed << " failed), "
+       << (this->residentBytes >> 20) << "/" << (this->memoryBudget >> 20) << " MB, "
+       << this->index.getCount() << " objects indexed (height " << this->index.getHeight() << ")" << std::endl;
+}
+
+int64_t World::getKey( const glm::ivec2& coord ) {
+    return ((static_cast<int64_t>(coord.x) << 32) | static_cast<uint32_t>(coord.y));
+}
+
+/*  from the camera to the closest point of the cell, on the ground */
+float   World::getDistance( const tWorldCell& cell, const glm::vec3& position ) {
+    glm::vec2 min = glm::vec2(cell.coord) * WORLD_CELL_SIZE;
+    glm::vec2 p = glm::vec2(position.x, position.z);
+    return (glm::length(glm::max(glm::max(min - p, p - min - WORLD_CELL_SIZE), glm::vec2(0.0f))));
+}
+
+/*  the cells behind the camera count as up to twice as far as the ones in front */
+float   World::getPriority( const tWorldCell& cell, const glm::vec3& position, const glm::vec3& front ) {
+    glm::vec2 dir = (glm::vec2(cell.coord) + 0.5f) * WORLD_CELL_SIZE - glm::vec2(position.x, position.z);
+    glm::vec2 view = glm::vec2(front.x, front.z);
+    float facing = 1.0f;
+    if (glm::length(dir) > 0.0f && glm::length(view) > 0.0f)
+        facing = glm::dot(glm::normalize(dir), glm::normalize(view));
+    return (World::getDistance(cell, position) * (1.5f - 0.5f * facing));
+}
+
+void    World::request( tWorldCell& cell ) {
+    cell.state = eCellState::loading;
+    this->active.insert(World::getKey(cell.coord));
+    for (size_t i = 0; i < cell.assets.size(); ++i) {
+        this->assets[cell.assets[i]].refs++;
+        this->assets[cell.assets[i]].lastUsed = this->frame;
+    }
+}
+
+void    World::read( const std::string& file, tWorldAsset& asset ) {
+    tModelData* data = new tModelData();
+    asset.data = data;
+    asset.state = eAssetState::reading;
+    asset.reading = this->workers.submit([file, data]( void ) {
+        Model::read(file, *data);
+    });
+    this->reads++;
+}
+
+/*  the decoded files are uploaded on the GL thread up to WORLD_UPLOAD_BUDGET bytes per frame, an
+    image or a mesh at a time (see Model::upload), so that a large model is spread over several
+    frames. A step is never split: a single image or mesh over the budget still takes a frame.
+    A file that fails to read is reported once and not read again, its cells load without it.
+*/
+void    World::upload( bool wait ) {
+    size_t uploaded = 0;
+    for (auto it = this->assets.begin(); it != this->assets.end(); it++) {
+        tWorldAsset& asset = it->second;
+        if (asset.state == eAssetState::reading && (wait || asset.reading.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+            this->reads--;
+            asset.state = eAssetState::read;
+            try {
+                asset.reading.get();
+            }
+            catch (const std::exception& err) {
+                std::cout << err.what() << std::endl;
+                asset.state = eAssetState::failed;
+                delete asset.data;
+                asset.data = nullptr;
+            }
+        }
+        while (asset.state == eAssetState::read && (wait || uploaded < WORLD_UPLOAD_BUDGET)) {
+            size_t steps = Model::getUploadSteps(*asset.data);
+            if (!asset.model)
+                asset.model = new Model();
+            if (asset.uploaded < steps)
+                uploaded += asset.model->upload(*asset.data, asset.uploaded++);
+            if (asset.uploaded == steps) {
+                asset.bytes = asset.data->bytes;
+                asset.state = eAssetState::resident;
+                asset.uploaded = 0;
+                delete asset.data;
+                asset.data = nullptr;
+                this->residentBytes += asset.bytes;
+            }
+        }
+    }
+}
+
+/*  the models of the cell share the meshes and textures of the resident files */
+void    World::instantiate( tWorldCell& cell ) {
+    for (size_t i = 0; i < cell.entries.size(); ++i) {
+        const tSceneEntry& entry = cell.entries[i];
+        if (entry.type == eSceneEntry::model || entry.type == eSceneEntry::instance) {
+            Model* model = this->assets[entry.paths[0]].model;
+            if (!model)
+                continue;
+            cell.models.push_back( new Model(model->getMeshes(), model->getTextures(), entry.position, entry.orientation, entry.scale) );
+            this->env->getModels().push_back(cell.models.back());
+            cell.models.back()->setSpatialId(this->index.insert(cell.models.back()->getBounds(), WORLD_MODELS, &entry));
+        }
+        else if (entry.type == eSceneEntry::billboard) {
+            cell.models.push_back( new Model(entry.position, entry.orientation, entry.scale) );
+            this->env->getModels().push_back(cell.models.back());
+            cell.models.back()->setSpatialId(this->index.insert(cell.models.back()->getBounds(), WORLD_MODELS, &entry));
+        }
+        else if (entry.type == eSceneEntry::surface || entry.type == eSceneEntry::texturedSurface) {
+            cell.surfaces.push_back( new RaymarchedSurface(entry.position, entry.orientation, entry.scale, this->env->getSkyboxTexture(), this->env->getNoiseTexture()) );
+            if (entry.type == eSceneEntry::surface)
+                this->env->getRaymarchedSurfaces().push_back(cell.surfaces.back());
+            else
+                this->env->getTexturedSurfaces().push_back(cell.surfaces.back());
+            cell.surfaces.back()->setSpatialId(this->index.insert(cell.surfaces.back()->getBounds(), WORLD_SURFACES, &entry));
+        }
+        else if (entry.type == eSceneEntry::raymarched) {
+            float radius = entry.object.scale * entry.object.boundingSphereScale;
+            cell.exhibits.push_back(this->index.insert((tBounds){ entry.object.position - radius, entry.object.position + radius }, WORLD_EXHIBITS, &entry));
+        }
+    }
+    cell.state = eCellState::loaded;
+}
+
+template< typename T >
+static void removeAll( std::vector<T*>& list, const std::vector<T*>& removed ) {
+    std::unordered_set<T*> set(removed.begin(), removed.end());
+    list.erase(std::remove_if(list.begin(), list.end(), [&set]( T* t ) { return (set.find(t) != set.end()); }), list.end());
+}
+
+void    World::unload( tWorldCell& cell ) {
+    if (cell.state == eCellState::unloaded)
+        return;
+    removeAll(this->env->getModels(), cell.models);
+    removeAll(this->env->getRaymarchedSurfaces(), cell.surfaces);
+    removeAll(this->env->getTexturedSurfaces(), cell.surfaces);
+    for (size_t i = 0; i < cell.models.size(); ++i) {
+        this->index.remove(cell.models[i]->getSpatialId());
+        delete cell.models[i];
+    }
+    for (size_t i = 0; i < cell.surfaces.size(); ++i) {
+        this->index.remove(cell.surfaces[i]->getSpatialId());
+        delete cell.surfaces[i];
+    }
+    for (size_t i = 0; i < cell.exhibits.size(); ++i)
+        this->index.remove(cell.exhibits[i]);
+    cell.models.clear();
+    cell.surfaces.clear();
+    cell.exhibits.clear();
+    for (size_t i = 0; i < cell.assets.size(); ++i) {
+        this->assets[cell.assets[i]].refs--;
+        this->assets[cell.assets[i]].lastUsed = this->frame;
+    }
+    cell.state = eCellState::unloaded;
+    this->active.erase(World::getKey(cell.coord));
+}
+
+/*  the files no cell uses, least recently used first, while over budget */
+void    World::evict( void ) {
+    while (this->residentBytes > this->memoryBudget) {
+        tWorldAsset* oldest = nullptr;
+        for (auto it = this->assets.begin(); it != this->assets.end(); it++)
+            if (it->second.state == eAssetState::resident && it->second.refs == 0 && (!oldest || it->second.lastUsed < oldest->lastUsed))
+                oldest = &it->second;
+        if (!oldest)
+            return;
+        delete oldest->model;
+        oldest->model = nullptr;
+        oldest->state = eAssetState::unloaded;
+        this->residentBytes -= oldest->bytes;
+    }
+}
+
+/*  the raymarched objects of the loaded cells closest to the camera (within WORLD_UNLOAD_RADIUS),
+    in a stable order so that the Raymarched is only updated when the selection changes
+*/
+void    World::updateExhibits( const glm::vec3& position ) {
+    Raymarched* raymarched = this->env->getRaymarched();
+    if (!raymarched)
+        return;
+    tFrameVector<std::pair<float, const tSceneEntry*>> candidates;
+    this->found.clear();
+    this->index.query(position, WORLD_UNLOAD_RADIUS, this->found, WORLD_EXHIBITS);
+    for (size_t i = 0; i < this->found.size(); ++i) {
+        const tSceneEntry* entry = static_cast<const tSceneEntry*>(this->index.getData(this->found[i]));
+        candidates.push_back(std::make_pair(glm::length(entry->object.position - position), entry));
+    }
+    size_t count = std::min(candidates.size(), static_cast<size_t>(RAYMARCH_MAX_OBJECTS));
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+    tFrameVector<const tSceneEntry*> exhibits;
+    for (size_t i = 0; i < count; ++i)
+        exhibits.push_back(candidates[i].second);
+    std::sort(exhibits.begin(), exhibits.end());
+    if (exhibits.size() == this->exhibits.size() && std::equal(exhibits.begin(), exhibits.end(), this->exhibits.begin()))
+        return;
+    this->exhibits.assign(exhibits.begin(), exhibits.end());
+    std::vector<tObject> objects;
+    for (size_t i = 0; i < exhibits.size(); ++i)
+        objects.push_back(exhibits[i]->object);
+    raymarched->setObjects(objects);
+}
@@ -1,14 +1,55 @@
 #include "Renderer.hpp"
 #include "Env.hpp"
+#include "Scene.hpp"
 
-int main( void ) {
+/*  ./shaderPixel [--scene <file>]          interactive
+    ./shaderPixel [--scene <file>] <output.mov> <camera path> [width height [supersampling [framerate]]]
+                                            offline render to file (see tRenderToFile)
+                                            an .y4m output is raw I420 converted on the GPU,
+                                            e.g. ffmpeg -i out.y4m -c:v libx264 out.mp4
+    ./shaderPixel --generate <output.scene> <stands> <exhibits> [seed]
+                                            write a synthetic stress scene (see Scene::generate)
+    Bad arguments, a scene that fails to load or any other error is printed and exits with 1.
+*/
+int main( int argc, char** argv ) {
     try {
-        Env         environment;
-        Renderer    renderer(&environment);
+        std::string     scene = ENV_DEFAULT_SCENE;
+        tRenderToFile   renderToFile = { "", "", 3840, 2160, 1, 60.0f };
+        const char*     usage = "usage: ./shaderPixel [--scene file] [output.mov camera_path [width height [supersampling [framerate]]]]";
+        if (argc > 1 && std::string(argv[1]) == "--generate") {
+            if (argc < 5 || argc > 6)
+                throw Exception::InitError("usage: ./shaderPixel --generate output.scene stands exhibits [seed]");
+            Scene::generate(argv[2], std::stoul(argv[3]), std::stoul(argv[4]), (argc > 5 ? std::stoul(argv[5]) : 42));
+            return (0);
+        }
+        if (argc > 1 && std::string(argv[1]) == "--scene") {
+            if (argc < 3)
+                throw Exception::InitError(usage);
+            scene = argv[2];
+            argc -= 2;
+            argv += 2;
+        }
+        if (argc == 2 || argc == 4 || argc > 7)
+            throw Exception::InitError(usage);
+        if (argc > 2) {
+            renderToFile.output = argv[1];
+            renderToFile.cameraPath = argv[2];
+        }
+        if (argc > 4) {
+            renderToFile.width = std::stoul(argv[3]);
+            renderToFile.height = std::stoul(argv[4]);
+        }
+        if (argc > 5)
+            renderToFile.supersampling = std::max(std::stoul(argv[5]), 1UL);
+        if (argc > 6)
+            renderToFile.framerate = std::stof(argv[6]);
+        Env         environment(scene);
+        Renderer    renderer(&environment, (argc > 2 ? &renderToFile : nullptr));
         renderer.loop();
     }
     catch (const std::exception& err) {
-        std::cout << err.what() << std::endl;
+        std::cerr << err.what() << std::endl;
+        return (1);
     }
     return (0);
 }
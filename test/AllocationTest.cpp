@@ -0,0 +1,64 @@
+#include "Renderer.hpp"
+#include "test.hpp"
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+/*  Once the scene is loaded and the programs are ready, a frame of the renderer allocates
+    nothing. The global operator new is replaced here only, it counts the allocations of every
+    thread of the process while counting is set: the frame, the recording jobs of the workers,
+    the simulation and the streaming. Only the shader watcher is left out, it builds the paths
+    it polls. Renders the default scene in a hidden window, skipped without a display.
+*/
+#define WARMUP_FRAMES 120   // the lists, queues and frame arena reach their size
+#define STEADY_FRAMES 300
+
+static std::atomic<bool>    counting(false);
+static std::atomic<size_t>  allocations(0);
+static std::thread::id      ignored;        // the shader watcher
+
+void*   operator new( size_t size ) {
+    if (counting.load(std::memory_order_relaxed) && std::this_thread::get_id() != ignored)
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return (ptr);
+}
+
+void*   operator new[]( size_t size ) {
+    return (::operator new(size));
+}
+
+void    operator delete( void* ptr ) noexcept {
+    std::free(ptr);
+}
+
+void    operator delete[]( void* ptr ) noexcept {
+    std::free(ptr);
+}
+
+int     main( void ) {
+    if (!glfwInit()) {
+        std::cout << "AllocationTest: skipped, no display" << std::endl;
+        return (0);
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    Env         env;
+    Renderer    renderer(&env);
+    ignored = renderer.getShaderWatcher().getThreadId();
+
+    /* the first frame requests the raymarch variants of the objects */
+    renderer.renderFrame();
+    renderer.waitForShaders();
+    for (size_t i = 0; i < WARMUP_FRAMES; ++i)
+        renderer.renderFrame();
+    counting = true;
+    for (size_t i = 0; i < STEADY_FRAMES; ++i)
+        renderer.renderFrame();
+    counting = false;
+    std::cout << "AllocationTest: " << allocations << " allocations in " << STEADY_FRAMES << " frames" << std::endl;
+    CHECK(allocations == 0);
+    return (0);
+}
@@ -0,0 +1,89 @@
+#include "CommandBuffer.hpp"
+#include "test.hpp"
+
+#include <thread>
+#include <cstring>
+
+/*  recording without a GL context: the commands and their payload, the memory kept by reset,
+    and lists recorded on several threads at once.
+*/
+
+static void     record( CommandBuffer& commands, int draws ) {
+    for (int d = 0; d < draws; ++d) {
+        commands.bindTexture(1, GL_TEXTURE_2D, 10 + d);
+        commands.setUniform("texture_diffuse1", 1);
+        commands.setUniform("material.shininess", 32.0f);
+        commands.setUniform("material.diffuse", glm::vec3(0.5f, 0.25f, 1.0f));
+        commands.setUniform("model", glm::mat4(2.0f));
+        commands.bindVertexArray(20 + d);
+        commands.drawElements(36 * (d + 1));
+    }
+}
+
+static bool     equals( const CommandBuffer& a, const CommandBuffer& b ) {
+    if (a.getCommands().size() != b.getCommands().size())
+        return (false);
+    for (size_t c = 0; c < a.getCommands().size(); ++c) {
+        const tCommand& x = a.getCommands()[c];
+        const tCommand& y = b.getCommands()[c];
+        if (x.type != y.type || x.object != y.object || x.unit != y.unit || x.name != y.name || x.count != y.count)
+            return (false);
+    }
+    return (true);
+}
+
+int     main( void ) {
+    CommandBuffer   commands;
+    record(commands, 1);
+
+    const std::vector<tCommand>& list = commands.getCommands();
+    CHECK(list.size() == 7);
+    CHECK(list[0].type == eCommand::bindTexture && list[0].unit == 1 && list[0].target == GL_TEXTURE_2D && list[0].object == 10);
+    CHECK(list[1].type == eCommand::uniformInt && list[1].name == uniformId("texture_diffuse1"));
+    CHECK(list[5].type == eCommand::bindVertexArray && list[5].object == 20);
+    CHECK(list[6].type == eCommand::drawElements && list[6].count == 36);
+
+    /* the values are copied in the buffer */
+    int         i;
+    float       f;
+    glm::vec3   v;
+    glm::mat4   m;
+    std::memcpy(&i, commands.getData(list[1].data), sizeof(i));
+    std::memcpy(&f, commands.getData(list[2].data), sizeof(f));
+    std::memcpy(&v, commands.getData(list[3].data), sizeof(v));
+    std::memcpy(&m, commands.getData(list[4].data), sizeof(m));
+    CHECK(i == 1 && f == 32.0f);
+    CHECK(v == glm::vec3(0.5f, 0.25f, 1.0f) && m == glm::mat4(2.0f));
+    CHECK(list[2].type == eCommand::uniformFloat && list[3].type == eCommand::uniformVec3 && list[4].type == eCommand::uniformMat4);
+
+    /* the content of a buffer update is copied too, the source may change before the replay */
+    float       block[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+    commands.updateBuffer(GL_UNIFORM_BUFFER, 5, 16, block, sizeof(block));
+    block[0] = 0.0f;
+    const tCommand& update = commands.getCommands().back();
+    CHECK(update.type == eCommand::updateBuffer && update.object == 5 && update.offset == 16 && update.count == sizeof(block));
+    CHECK(static_cast<const float*>(commands.getData(update.data))[0] == 1.0f);
+
+    /* a list recorded again reuses its memory */
+    commands.reset();
+    CHECK(commands.getCommands().empty());
+    record(commands, 64);
+    const tCommand* first = commands.getCommands().data();
+    const void*     data = commands.getData(0);
+    commands.reset();
+    record(commands, 64);
+    CHECK(commands.getCommands().data() == first && commands.getData(0) == data);
+    CHECK(commands.getCommands().size() == 64 * 7);
+
+    /* each thread records its own list, as the workers of the renderer do */
+    CommandBuffer   lists[4];
+    std::thread     threads[4];
+    for (size_t t = 0; t < 4; ++t)
+        threads[t] = std::thread([&lists, t]( void ) { record(lists[t], 64); });
+    for (size_t t = 0; t < 4; ++t)
+        threads[t].join();
+    for (size_t t = 0; t < 4; ++t)
+        CHECK(equals(lists[t], commands));
+    std::cout << "CommandBufferTest: ok" << std::endl;
+    return (0);
+}
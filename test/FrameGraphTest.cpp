@@ -0,0 +1,96 @@
+#include "FrameGraph.hpp"
+#include "test.hpp"
+
+#include <sstream>
+#include <map>
+
+/*  the schedule of a small graph, compiled without a GL context: culling, aliasing of the
+    transient targets, clears and barriers, and the recompilation when a pass is disabled.
+*/
+
+/*  "  name: key [first, last]" lines of the dump, by resource name */
+static std::map<std::string, std::string>   getSlots( const FrameGraph& graph ) {
+    std::stringstream                   ss;
+    std::string                         line;
+    std::map<std::string, std::string>  slots;
+    graph.dump(ss);
+    while (std::getline(ss, line)) {
+        size_t colon = line.find(": ");
+        if (line.compare(0, 2, "  ") != 0 || colon == std::string::npos)
+            continue;
+        slots[line.substr(2, colon - 2)] = line.substr(colon + 2, line.find(" [") - colon - 2);
+    }
+    return (slots);
+}
+
+/*  the dump line of a pass */
+static std::string  getStep( const FrameGraph& graph, const std::string& pass ) {
+    std::stringstream   ss;
+    std::string         line;
+    graph.dump(ss);
+    while (std::getline(ss, line))
+        if (line.compare(0, pass.size() + 3, "  " + pass + " ") == 0)
+            return (line);
+    return ("");
+}
+
+int     main( void ) {
+    FrameGraph  graph;
+    auto        none = []( void ) {};
+
+    graph.addResource("shadowDepth", (tFrameResourceDesc){ 64, 64, 4, GL_DEPTH_COMPONENT24, false });
+    graph.addResource("sceneColor", (tFrameResourceDesc){ 64, 64, 1, GL_RGBA16F, true });
+    graph.addResource("sceneDepth", (tFrameResourceDesc){ 64, 64, 1, GL_DEPTH_COMPONENT24, true });
+    graph.addResource("blurA", (tFrameResourceDesc){ 64, 64, 1, GL_RGBA16F, true });
+    graph.addResource("blurB", (tFrameResourceDesc){ 64, 64, 1, GL_RGBA16F, true });
+    graph.addResource("debug", (tFrameResourceDesc){ 64, 64, 1, GL_RGBA16F, true });
+    graph.importResource("backbuffer", 0, 64, 64);
+
+    size_t shadows = graph.addPass((tFramePass){ "shadows", {}, { "shadowDepth" }, none });
+    size_t scene = graph.addPass((tFramePass){ "scene", { "shadowDepth" }, { "sceneColor", "sceneDepth" }, none });
+    size_t blurH = graph.addPass((tFramePass){ "blurH", { "sceneColor" }, { "blurA" }, none });
+    size_t blurV = graph.addPass((tFramePass){ "blurV", { "blurA" }, { "blurB" }, none });
+    size_t debug = graph.addPass((tFramePass){ "debug", { "sceneDepth" }, { "debug" }, none });
+    size_t screen = graph.addPass((tFramePass){ "screen", { "blurB" }, { "backbuffer" }, none });
+    graph.compile();
+
+    /* the debug output is never read */
+    CHECK(!graph.isCulled(shadows) && !graph.isCulled(scene) && !graph.isCulled(blurH));
+    CHECK(!graph.isCulled(blurV) && !graph.isCulled(screen));
+    CHECK(graph.isCulled(debug) && graph.isCulled("debug"));
+
+    std::map<std::string, std::string> slots = getSlots(graph);
+    CHECK(slots["debug"] == "unused");
+    CHECK(slots["backbuffer"] == "imported");
+    CHECK(slots["shadowDepth"] == "persistent:shadowDepth");
+    /* blurB starts after sceneColor is last read, blurA overlaps both */
+    CHECK(slots["blurB"] == slots["sceneColor"]);
+    CHECK(slots["blurA"] != slots["sceneColor"]);
+    CHECK(slots["sceneDepth"] != slots["sceneColor"]);
+
+    /* the transient targets are cleared on their first write, the persistent ones never */
+    CHECK(getStep(graph, "scene").find("clear(sceneColor) clear(sceneDepth)") != std::string::npos);
+    CHECK(getStep(graph, "shadows").find("clear(") == std::string::npos);
+    CHECK(getStep(graph, "screen").find("clear(") == std::string::npos);
+    /* a read after a write of the frame is ordered by a barrier */
+    CHECK(getStep(graph, "scene").find("barrier(shadowDepth)") != std::string::npos);
+    CHECK(getStep(graph, "blurV").find("barrier(blurA)") != std::string::npos);
+    CHECK(getStep(graph, "shadows").find("barrier(") == std::string::npos);
+
+    /* disabling the shadows keeps their persistent target, the scene samples what was cached */
+    graph.setEnabled(shadows, false);
+    graph.compile();
+    CHECK(graph.isCulled(shadows) && !graph.isCulled(scene));
+    CHECK(getSlots(graph)["shadowDepth"] == "persistent:shadowDepth");
+    CHECK(getStep(graph, "scene").find("barrier(") == std::string::npos);
+    CHECK(getStep(graph, "shadows") == "  shadows (culled)");
+
+    /* without the screen nothing is consumed */
+    graph.setEnabled(shadows, true);
+    graph.setEnabled(screen, false);
+    graph.compile();
+    for (size_t i = shadows; i <= screen; ++i)
+        CHECK(graph.isCulled(i));
+    std::cout << "FrameGraphTest: ok" << std::endl;
+    return (0);
+}
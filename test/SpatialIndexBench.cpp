@@ -0,0 +1,111 @@
+#include "SpatialIndex.hpp"
+#include "test.hpp"
+
+#include <chrono>
+#include <random>
+#include <string>
+
+/*  make bench, or ./test/SpatialIndexBench [objects]: times the spatial index against brute
+    force, not part of make test.
+*/
+
+/*  Random boxes of the size of the scene objects on a square sized for a constant density; the
+    index is built, moved and queried like the renderer does it, and every query is checked
+    against a loop over all the boxes. Returns false if a query found something else.
+*/
+static bool benchmark( size_t count, std::ostream& os ) {
+    typedef std::chrono::duration<double,std::milli> tMs;
+    typedef std::chrono::steady_clock::time_point tTime;
+    const size_t            queries = 1000;
+    const float             side = std::sqrt(static_cast<float>(count)) * 4.0f;
+    std::mt19937            rng(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<tBounds>    boxes(count);
+    std::vector<tSpatialId> ids(count);
+    std::vector<tSpatialId> result;
+    SpatialIndex            index;
+    size_t                  found[2][3] = { { 0 } };
+    double                  times[2][3] = { { 0.0 } };
+    auto                    random = [&]( void ) {
+        glm::vec3 position = glm::vec3(unit(rng) - 0.5f, unit(rng) * 0.01f, unit(rng) - 0.5f) * side;
+        glm::vec3 size = glm::vec3(0.5f) + glm::vec3(unit(rng), unit(rng), unit(rng)) * 2.5f;
+        return ((tBounds){ position, position + size });
+    };
+
+    for (size_t i = 0; i < count; ++i)
+        boxes[i] = random();
+    tTime start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+        ids[i] = index.insert(boxes[i], 1, &boxes[i]);
+    double build = tMs(std::chrono::steady_clock::now() - start).count();
+    /* a tenth of the objects move a little, a hundred times */
+    start = std::chrono::steady_clock::now();
+    size_t reinserted = 0;
+    for (size_t frame = 0; frame < 100; ++frame)
+        for (size_t i = frame % 10; i < count; i += 10) {
+            glm::vec3 offset = glm::vec3(unit(rng) - 0.5f, 0.0f, unit(rng) - 0.5f) * 0.2f;
+            boxes[i] = (tBounds){ boxes[i].min + offset, boxes[i].max + offset };
+            reinserted += index.move(ids[i], boxes[i]);
+        }
+    double moves = tMs(std::chrono::steady_clock::now() - start).count();
+
+    glm::mat4 projection = glm::perspective(glm::radians(75.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+    for (size_t q = 0; q < queries; ++q) {
+        glm::vec3 position = glm::vec3(unit(rng) - 0.5f, 0.01f, unit(rng) - 0.5f) * side + glm::vec3(0.0f, 2.0f, 0.0f);
+        float     yaw = unit(rng) * 6.2831853f;
+        glm::vec3 direction = glm::vec3(std::cos(yaw), -0.1f, std::sin(yaw));
+        tFrustum  frustum = getFrustum(projection * glm::lookAt(position, position + direction, glm::vec3(0.0f, 1.0f, 0.0f)));
+        float     distance;
+        for (size_t brute = 0; brute < 2; ++brute) {
+            start = std::chrono::steady_clock::now();
+            result.clear();
+            if (!brute)
+                index.query(frustum, result);
+            else
+                for (size_t i = 0; i < count; ++i)
+                    if (intersects(frustum, boxes[i]))
+                        result.push_back(i);
+            found[brute][0] += result.size();
+            tTime split = std::chrono::steady_clock::now();
+            times[brute][0] += tMs(split - start).count();
+            result.clear();
+            if (!brute)
+                index.query(position, 20.0f, result);
+            else
+                for (size_t i = 0; i < count; ++i)
+                    if (intersects(position, 20.0f, boxes[i]))
+                        result.push_back(i);
+            found[brute][1] += result.size();
+            start = std::chrono::steady_clock::now();
+            times[brute][1] += tMs(start - split).count();
+            glm::vec3 ray = glm::normalize(direction);
+            tSpatialId hit = SPATIAL_NONE;
+            if (!brute)
+                hit = index.raycast(position, ray, 200.0f, distance);
+            else {
+                distance = 200.0f;
+                float entry;
+                for (size_t i = 0; i < count; ++i)
+                    if (intersects(position, 1.0f / ray, boxes[i], entry) && entry <= distance) {
+                        distance = entry;
+                        hit = i;
+                    }
+            }
+            found[brute][2] += (hit != SPATIAL_NONE);
+            times[brute][2] += tMs(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    static const char* names[3] = { "frustum", "sphere ", "ray    " };
+    os << "spatial index: " << count << " objects, height " << index.getHeight() << ", built in " << build << " ms, "
+       << count * 10 << " moves in " << moves << " ms (" << reinserted << " reinserted)" << std::endl;
+    for (size_t k = 0; k < 3; ++k)
+        os << "  " << names[k] << " " << times[0][k] * 1000.0 / queries << " us/query, brute force " << times[1][k] * 1000.0 / queries
+           << " us (x" << times[1][k] / std::max(times[0][k], 1e-6) << "), " << found[0][k] << " results"
+           << (found[0][k] == found[1][k] ? "" : " MISMATCH with " + std::to_string(found[1][k])) << std::endl;
+    return (std::equal(found[0], found[0] + 3, found[1]));
+}
+
+int     main( int argc, char** argv ) {
+    CHECK(benchmark((argc > 1 ? std::stoul(argv[1]) : 10000), std::cout));
+    return (0);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+
+/*  the test programs exit with a non-zero status on the first failed check (see make test) */
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #cond << std::endl; \
+        std::exit(1); \
+    } \
+} while (0)